@@ -0,0 +1,1739 @@
+﻿#pragma once
+
+#include <iostream>
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "Laba2_Trace.h"
+#include "Laba2_Alloc.h"
+#include "Laba2_Bulk.h"
+#include "Laba2_Augment.h"
+#include "Laba2_Parallel.h"
+#include "Laba2_Frozen.h"
+#include "Laba2_Mapped.h"
+#include "Laba2_Prefetch.h"
+
+template <typename T, typename Trace = Silent, typename Alloc = HeapNodes, typename Augment = NoAugment>
+class AVLTree {
+private:
+    struct Node : Augment::Field {
+        using Link = typename Alloc::template Link<Node>;
+
+        T data;
+        // Right after data, so that for small T it lands in padding the
+        // links need anyway; AVL heights stay far below 127.
+        std::int8_t height;
+        Link left;
+        Link right;
+        Link parent;
+
+        template <typename... Args>
+        explicit Node(Args&&... args)
+            : data(std::forward<Args>(args)...), height(1), left(nullptr), right(nullptr), parent(nullptr) {
+        }
+    };
+
+    // AVL height stays below 1.45 * log2(n + 2), so this bounds the
+    // explicit path stacks for any n that fits in memory.
+    static constexpr int kMaxHeight = 96;
+
+    using NodePool = typename Alloc::template Pool<Node>;
+    static constexpr bool bulkClear = NodePool::bulkRelease && std::is_trivially_destructible<T>::value;
+
+    using Link = typename Node::Link;
+
+    Link root;
+    std::size_t nodeCount;
+    NodePool pool;
+    mutable std::conditional_t<Trace::counting, TreeStats, NoStats> counters;
+
+public:
+    AVLTree() : root(nullptr), nodeCount(0) {}
+    ~AVLTree() { clear(); }
+
+    template <typename It>
+    AVLTree(It first, It last, unsigned threads = 1) : root(nullptr), nodeCount(0) { assign(first, last, threads); }
+    template <typename It>
+    AVLTree(SortedUnique, It first, It last) : root(nullptr), nodeCount(0) { assign(sortedUnique, first, last); }
+
+    // Bytes allocated per element, before allocator overhead.
+    static constexpr std::size_t nodeBytes = sizeof(Node);
+
+    // Bidirectional in-order iterator; elements are keys, so it is always const.
+    class const_iterator {
+    public:
+        using iterator_category = std::bidirectional_iterator_tag;
+        using value_type = T;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const T*;
+        using reference = const T&;
+
+        const_iterator() : node(nullptr), tree(nullptr) {}
+
+        reference operator*() const { return node->data; }
+        pointer operator->() const { return &node->data; }
+
+        const_iterator& operator++() { node = nextNode(node); return *this; }
+        const_iterator operator++(int) { const_iterator old = *this; ++*this; return old; }
+        const_iterator& operator--() { node = node ? prevNode(node) : maxNode(tree->root); return *this; }
+        const_iterator operator--(int) { const_iterator old = *this; --*this; return old; }
+
+        bool operator==(const const_iterator& other) const { return node == other.node; }
+        bool operator!=(const const_iterator& other) const { return node != other.node; }
+
+    private:
+        friend class AVLTree;
+        const_iterator(const Node* node, const AVLTree* tree) : node(node), tree(tree) {}
+
+        const Node* node;
+        const AVLTree* tree;
+    };
+
+    using iterator = const_iterator;
+    using reverse_iterator = std::reverse_iterator<const_iterator>;
+    using const_reverse_iterator = reverse_iterator;
+
+private:
+   
+    std::size_t clear(Node* node);
+    int getHeight(Node* node) const;
+    int getBalanceFactor(Node* node) const;
+    void updateHeight(Node* node);
+    static std::size_t getSize(const Node* node);
+    void updateSize(Node* node);
+
+   
+    Node* rotateRight(Node* y);
+    Node* rotateLeft(Node* x);
+    Node* balance(Node* node);
+    void rebalance(Link* path[], int depth);
+    static constexpr std::size_t kBatchLanes = 16;
+    template <typename Key, typename F>
+    void lookupBatch(const Key* keys, std::size_t n, F done) const;
+    template <bool KeepRight, typename GoLeft>
+    const Node* bound(GoLeft goLeft) const;
+    template <typename Key>
+    Link* descend(const Key& key, Link* path[], int& depth, Node*& parent);
+    void attach(Link* link, Node* node, Node* parent, Link* path[], int depth);
+
+    template <typename... Args>
+    Node* createNode(Args&&... args);
+    template <typename It>
+    Node* build(It& it, std::size_t n);
+
+    // Join-based building blocks. Every subtree passed in or returned is a
+    // valid AVL tree; the parent of a returned root is left unspecified.
+    Node* link(Node* left, Node* node, Node* right);
+    Node* joinNodes(Node* left, Node* node, Node* right);
+    Node* joinRight(Node* left, Node* node, Node* right);
+    Node* joinLeft(Node* left, Node* node, Node* right);
+    Node* join2(Node* left, Node* right);
+    Node* splitLast(Node* node, Node*& last);
+    template <typename Key>
+    void splitNodes(Node* node, const Key& key, Node*& left, Node*& found, Node*& right);
+    Node* unite(Node* a, Node* b, Node** dups, std::size_t& dupCount, const ForkContext& fork);
+    Node* intersect(Node* a, Node* b, std::size_t& dropped, const ForkContext& fork);
+    Node* subtract(Node* a, Node* b, std::size_t& dropped, const ForkContext& fork);
+    template <typename Pred>
+    Node* filterNodes(Node* node, Pred& pred, std::size_t& dropped, const ForkContext& fork);
+    template <typename It>
+    Node* uniteSorted(Node* node, It first, It last, std::size_t& added);
+    template <typename It>
+    Node* subtractSorted(Node* node, It first, It last, std::size_t& removed);
+    template <typename It>
+    Node* build(It first, std::size_t n, const ForkContext& fork);
+    void dispose(Node* node, const ForkContext& fork);
+    std::size_t discard(Node* node, const ForkContext& fork);
+    Node* adoptFrom(AVLTree& other);
+    Node* transfer(Node* node, AVLTree& to);
+
+    void union_with(AVLTree& other, const ForkContext& fork);
+    void intersect_with(AVLTree& other, const ForkContext& fork);
+    void difference_with(AVLTree& other, const ForkContext& fork);
+    template <typename Pred>
+    void filter(Pred& pred, const ForkContext& fork);
+
+    static const Node* minNode(const Node* node);
+    static const Node* maxNode(const Node* node);
+    static const Node* nextNode(const Node* node);
+    static const Node* prevNode(const Node* node);
+    static int checkNode(const Node* node, const Node* parent, const Node*& prev, std::size_t& count);
+
+    void inorder(Node* node) const;
+    void preorder(Node* node) const;
+    void postorder(Node* node) const;
+
+    void printLevel(Node* node, int level, int spaces, bool left) const;
+
+public:
+    void insert(const T& value);
+    void insert(T&& value);
+    template <typename Key>
+    void remove(const Key& value);
+    template <typename Key>
+    bool search(const Key& value) const;
+
+    // emplace() builds the element first and drops it if an equivalent one
+    // exists; try_emplace() looks key up first and builds the element from
+    // args only when it is absent.
+    template <typename... Args>
+    std::pair<const_iterator, bool> emplace(Args&&... args);
+    template <typename Key, typename... Args>
+    std::pair<const_iterator, bool> try_emplace(const Key& key, Args&&... args);
+    bool isEmpty() const { return root == nullptr; }
+    std::size_t size() const { return nodeCount; }
+    void clear();
+
+    template <typename It>
+    void assign(It first, It last, unsigned threads = 1);
+    template <typename It>
+    void assign(SortedUnique, It first, It last);
+
+    // join() appends key and then every element of right, all of which must
+    // be greater than the elements here; right is left empty. split()
+    // keeps the elements < key, moves those > key into right (replacing its
+    // contents) and drops key itself, returning whether it was present. For
+    // both, right must be another tree (std::invalid_argument otherwise).
+    //
+    // join() is O(log n). split() is O(log n) only with SubtreeSize and a
+    // transferable pool (HeapNodes): without SubtreeSize it counts the
+    // smaller half to keep size() exact, O(min(|left|, |right|)), and other
+    // pools copy every moved element into right's pool.
+    void join(const T& key, AVLTree& right);
+    template <typename Key>
+    bool split(const Key& key, AVLTree& right);
+
+    // Set algebra in O(m log(n/m + 1)) for sizes m <= n. The nodes of other
+    // are spliced in or destroyed, so other is left empty, except by merge(),
+    // which like std::set::merge leaves there the elements already present.
+    void union_with(AVLTree& other) { union_with(other, ForkContext()); }
+    void intersect_with(AVLTree& other) { intersect_with(other, ForkContext()); }
+    void difference_with(AVLTree& other) { difference_with(other, ForkContext()); }
+    void merge(AVLTree& other);
+    // Keeps only the elements for which pred returns true.
+    template <typename Pred>
+    void filter(Pred pred) { filter(pred, ForkContext()); }
+
+    // Insert / remove a batch of m keys in one pass over the subtrees they
+    // fall into, O(m log(n/m + 1)) instead of m separate descents. The
+    // batch is sorted first; the SortedUnique forms take a strictly
+    // increasing random-access range as is. Return how many elements were
+    // actually inserted / removed. The sort stays on the calling thread
+    // unless threads asks for more (0: one per hardware thread).
+    template <typename It>
+    std::size_t insert_batch(It first, It last, unsigned threads = 1);
+    template <typename It>
+    std::size_t insert_batch(SortedUnique, It first, It last);
+    template <typename It>
+    std::size_t erase_batch(It first, It last, unsigned threads = 1);
+    template <typename It>
+    std::size_t erase_batch(SortedUnique, It first, It last);
+
+    // The same on a fork-join pool: independent subtrees larger than the
+    // policy's cutoff run in parallel, so pred has to be thread-safe. A
+    // pool that is not concurrent (SlabNodes) is locked around each node
+    // destroyed, and the parallel assign() builds its nodes serially.
+    void union_with(Parallel policy, AVLTree& other);
+    void intersect_with(Parallel policy, AVLTree& other);
+    void difference_with(Parallel policy, AVLTree& other);
+    template <typename Pred>
+    void filter(Parallel policy, Pred pred);
+    template <typename It>
+    void assign(Parallel policy, It first, It last);
+    template <typename It>
+    void assign(Parallel policy, SortedUnique, It first, It last);
+
+    const_iterator begin() const { return const_iterator(minNode(root), this); }
+    const_iterator end() const { return const_iterator(nullptr, this); }
+    const_reverse_iterator rbegin() const { return const_reverse_iterator(end()); }
+    const_reverse_iterator rend() const { return const_reverse_iterator(begin()); }
+
+    // Many independent lookups at once; out[i] answers keys[i]. Up to
+    // kBatchLanes descents are in flight together: each step moves one of
+    // them down a level and prefetches the node it lands on, then turns to
+    // the next, so the cache misses of different keys overlap.
+    template <typename Key>
+    void contains_batch(const Key* keys, std::size_t n, bool* out) const;
+    template <typename Key>
+    void find_batch(const Key* keys, std::size_t n, const_iterator* out) const;
+
+    template <typename Key>
+    const_iterator find(const Key& value) const;
+    template <typename Key>
+    const_iterator lower_bound(const Key& value) const;
+    template <typename Key>
+    const_iterator upper_bound(const Key& value) const;
+    // Largest element <= value / smallest >= value; end() when there is none.
+    template <typename Key>
+    const_iterator floor(const Key& value) const;
+    template <typename Key>
+    const_iterator ceiling(const Key& value) const { return lower_bound(value); }
+    // Largest element < value / smallest > value; end() when there is none.
+    template <typename Key>
+    const_iterator predecessor(const Key& value) const;
+    template <typename Key>
+    const_iterator successor(const Key& value) const { return upper_bound(value); }
+
+    // Order statistics; these need the SubtreeSize augmentation.
+    // rank() counts the elements < value, select() returns the k-th smallest
+    // (0-based, end() when k >= size()), count_range() counts [lo, hi].
+    template <typename Key>
+    std::size_t rank(const Key& value) const;
+    const_iterator select(std::size_t k) const;
+    template <typename Key>
+    std::size_t count_range(const Key& lo, const Key& hi) const;
+
+    // Read-only copy of the current contents in a cache-friendly layout.
+    FrozenSet<T> freeze() const { return FrozenSet<T>(sortedUnique, begin(), nodeCount); }
+
+    // Snapshot file of the current contents (trivially copyable T only),
+    // see MappedSet. open_mapped() serves reads from the file in place and
+    // builds the tree only on the first write.
+    void save(const std::string& path) const { MappedSet<T>::template write<Node>(path, root, nullptr, nodeCount); }
+    static MappedTree<AVLTree> open_mapped(const std::string& path, bool verify = true) {
+        return MappedTree<AVLTree>(MappedSet<T>(path, verify));
+    }
+
+    void displayInorder() const;
+    void displayPreorder() const;
+    void displayPostorder() const;
+    void displayTree() const;
+
+    int getTreeHeight() const { return getHeight(root); }
+    void displayBalanceInfo() const;
+    // Checks order, parent links, stored heights and balance, subtree sizes
+    // and size(), in O(n); for tests.
+    bool isValid() const;
+
+    // Counters of a tree with the Counting trace policy, plus its height.
+    TreeStats stats() const;
+    void resetStats() { counters = {}; }
+};
+
+
+template <typename T, typename Trace, typename Alloc, typename Augment>
+int AVLTree<T, Trace, Alloc, Augment>::getHeight(Node* node) const {
+    return node ? node->height : 0;
+}
+
+template <typename T, typename Trace, typename Alloc, typename Augment>
+int AVLTree<T, Trace, Alloc, Augment>::getBalanceFactor(Node* node) const {
+    return node ? getHeight(node->left) - getHeight(node->right) : 0;
+}
+
+template <typename T, typename Trace, typename Alloc, typename Augment>
+void AVLTree<T, Trace, Alloc, Augment>::updateHeight(Node* node) {
+    if (node) {
+        node->height = static_cast<std::int8_t>(std::max(getHeight(node->left), getHeight(node->right)) + 1);
+    }
+}
+
+
+template <typename T, typename Trace, typename Alloc, typename Augment>
+std::size_t AVLTree<T, Trace, Alloc, Augment>::getSize(const Node* node) {
+    if constexpr (Augment::enabled) {
+        return node ? node->size : 0;
+    }
+    else {
+        return 0;
+    }
+}
+
+template <typename T, typename Trace, typename Alloc, typename Augment>
+void AVLTree<T, Trace, Alloc, Augment>::updateSize(Node* node) {
+    if constexpr (Augment::enabled) {
+        node->size = getSize(node->left) + getSize(node->right) + 1;
+    }
+}
+
+
+template <typename T, typename Trace, typename Alloc, typename Augment>
+typename AVLTree<T, Trace, Alloc, Augment>::Node* AVLTree<T, Trace, Alloc, Augment>::rotateRight(Node* y) {
+    Node* x = y->left;
+    Node* T2 = x->right;
+
+    x->right = y;
+    y->left = T2;
+
+    if (T2) {
+        T2->parent = y;
+    }
+    x->parent = y->parent;
+    y->parent = x;
+
+    updateHeight(y);
+    updateHeight(x);
+    updateSize(y);
+    updateSize(x);
+
+    return x;
+}
+
+
+template <typename T, typename Trace, typename Alloc, typename Augment>
+typename AVLTree<T, Trace, Alloc, Augment>::Node* AVLTree<T, Trace, Alloc, Augment>::rotateLeft(Node* x) {
+    Node* y = x->right;
+    Node* T2 = y->left;
+
+
+    y->left = x;
+    x->right = T2;
+
+    if (T2) {
+        T2->parent = x;
+    }
+    y->parent = x->parent;
+    x->parent = y;
+
+    updateHeight(x);
+    updateHeight(y);
+    updateSize(x);
+    updateSize(y);
+
+    return y;
+}
+
+
+template <typename T, typename Trace, typename Alloc, typename Augment>
+typename AVLTree<T, Trace, Alloc, Augment>::Node* AVLTree<T, Trace, Alloc, Augment>::balance(Node* node) {
+    if (!node) return node;
+
+    updateHeight(node);
+    updateSize(node);
+    int balanceFactor = getBalanceFactor(node);
+
+    if (balanceFactor > 1 && getBalanceFactor(node->left) >= 0) {
+        if constexpr (Trace::enabled) {
+            std::cout << "  -> Right rotation at node " << node->data << std::endl;
+        }
+        if constexpr (Trace::counting) {
+            counters.rotationsLL++;
+        }
+        return rotateRight(node);
+    }
+
+  
+    if (balanceFactor > 1 && getBalanceFactor(node->left) < 0) {
+        if constexpr (Trace::enabled) {
+            std::cout << "  -> Left-Right rotation at node " << node->data << std::endl;
+        }
+        if constexpr (Trace::counting) {
+            counters.rotationsLR++;
+        }
+        node->left = rotateLeft(node->left);
+        return rotateRight(node);
+    }
+
+
+    if (balanceFactor < -1 && getBalanceFactor(node->right) <= 0) {
+        if constexpr (Trace::enabled) {
+            std::cout << "  -> Left rotation at node " << node->data << std::endl;
+        }
+        if constexpr (Trace::counting) {
+            counters.rotationsRR++;
+        }
+        return rotateLeft(node);
+    }
+
+  
+    if (balanceFactor < -1 && getBalanceFactor(node->right) > 0) {
+        if constexpr (Trace::enabled) {
+            std::cout << "  -> Right-Left rotation at node " << node->data << std::endl;
+        }
+        if constexpr (Trace::counting) {
+            counters.rotationsRL++;
+        }
+        node->right = rotateRight(node->right);
+        return rotateLeft(node);
+    }
+
+    return node;
+}
+
+
+template <typename T, typename Trace, typename Alloc, typename Augment>
+void AVLTree<T, Trace, Alloc, Augment>::rebalance(Link* path[], int depth) {
+    while (depth > 0) {
+        Link* link = path[--depth];
+        int oldHeight = (*link)->height;
+        *link = balance(*link);
+        if ((*link)->height == oldHeight) {
+            break;
+        }
+    }
+
+    if constexpr (Augment::enabled) {
+        while (depth > 0) {
+            updateSize(*path[--depth]);
+        }
+    }
+}
+
+template <typename T, typename Trace, typename Alloc, typename Augment>
+template <typename Key>
+typename AVLTree<T, Trace, Alloc, Augment>::Link* AVLTree<T, Trace, Alloc, Augment>::descend(const Key& key, Link* path[], int& depth, Node*& parent) {
+    Link* link = &root;
+    parent = nullptr;
+    std::size_t nodes = 0;
+    std::size_t compares = 0;
+    while (*link) {
+        Node* node = *link;
+        nodes++;
+        if (key < node->data) {
+            compares += 1;
+            path[depth++] = link;
+            link = &node->left;
+        }
+        else if (node->data < key) {
+            compares += 2;
+            path[depth++] = link;
+            link = &node->right;
+        }
+        else {
+            compares += 2;
+            break;
+        }
+        parent = node;
+    }
+    if constexpr (Trace::counting) {
+        counters.descent(nodes, compares);
+    }
+    return link;
+}
+
+template <typename T, typename Trace, typename Alloc, typename Augment>
+void AVLTree<T, Trace, Alloc, Augment>::attach(Link* link, Node* node, Node* parent, Link* path[], int depth) {
+    *link = node;
+    node->parent = parent;
+    nodeCount++;
+    rebalance(path, depth);
+}
+
+template <typename T, typename Trace, typename Alloc, typename Augment>
+template <typename... Args>
+std::pair<typename AVLTree<T, Trace, Alloc, Augment>::const_iterator, bool> AVLTree<T, Trace, Alloc, Augment>::emplace(Args&&... args) {
+    Node* node = createNode(std::forward<Args>(args)...);
+
+    Link* path[kMaxHeight];
+    int depth = 0;
+    Node* parent;
+    Link* link = descend(node->data, path, depth, parent);
+    if (*link) {
+        pool.destroy(node);
+        return { const_iterator(*link, this), false };
+    }
+
+    attach(link, node, parent, path, depth);
+    return { const_iterator(node, this), true };
+}
+
+template <typename T, typename Trace, typename Alloc, typename Augment>
+template <typename Key, typename... Args>
+std::pair<typename AVLTree<T, Trace, Alloc, Augment>::const_iterator, bool> AVLTree<T, Trace, Alloc, Augment>::try_emplace(const Key& key, Args&&... args) {
+    Link* path[kMaxHeight];
+    int depth = 0;
+    Node* parent;
+    Link* link = descend(key, path, depth, parent);
+    if (*link) {
+        return { const_iterator(*link, this), false };
+    }
+
+    Node* node = createNode(std::forward<Args>(args)...);
+    attach(link, node, parent, path, depth);
+    return { const_iterator(node, this), true };
+}
+
+template <typename T, typename Trace, typename Alloc, typename Augment>
+void AVLTree<T, Trace, Alloc, Augment>::insert(const T& value) {
+    if constexpr (Trace::enabled) {
+        std::cout << "Вставка " << value << ":" << std::endl;
+    }
+
+    try_emplace(value, value);
+
+    if constexpr (Trace::enabled) {
+        displayBalanceInfo();
+    }
+}
+
+template <typename T, typename Trace, typename Alloc, typename Augment>
+void AVLTree<T, Trace, Alloc, Augment>::insert(T&& value) {
+    if constexpr (Trace::enabled) {
+        std::cout << "Вставка " << value << ":" << std::endl;
+    }
+
+    try_emplace(value, std::move(value));
+
+    if constexpr (Trace::enabled) {
+        displayBalanceInfo();
+    }
+}
+
+
+template <typename T, typename Trace, typename Alloc, typename Augment>
+template <typename... Args>
+typename AVLTree<T, Trace, Alloc, Augment>::Node* AVLTree<T, Trace, Alloc, Augment>::createNode(Args&&... args) {
+    Node* node = pool.create(std::forward<Args>(args)...);
+    if constexpr (Trace::counting) {
+        counters.nodesAllocated++;
+    }
+    return node;
+}
+
+// Builds a perfectly balanced subtree from the next n sorted values of it.
+template <typename T, typename Trace, typename Alloc, typename Augment>
+template <typename It>
+typename AVLTree<T, Trace, Alloc, Augment>::Node* AVLTree<T, Trace, Alloc, Augment>::build(It& it, std::size_t n) {
+    if (n == 0) {
+        return nullptr;
+    }
+
+    std::size_t leftSize = (n - 1) / 2;
+    Node* left = build(it, leftSize);
+    Node* node = createNode(*it);
+    ++it;
+    Node* right = build(it, n - 1 - leftSize);
+
+    node->left = left;
+    node->right = right;
+    if (left) {
+        left->parent = node;
+    }
+    if (right) {
+        right->parent = node;
+    }
+    updateHeight(node);
+    updateSize(node);
+    return node;
+}
+
+template <typename T, typename Trace, typename Alloc, typename Augment>
+template <typename It>
+void AVLTree<T, Trace, Alloc, Augment>::assign(It first, It last, unsigned threads) {
+    std::vector<T> values(first, last);
+    sortUnique(values, threads);
+    assign(sortedUnique, std::make_move_iterator(values.begin()), std::make_move_iterator(values.end()));
+}
+
+template <typename T, typename Trace, typename Alloc, typename Augment>
+template <typename It>
+void AVLTree<T, Trace, Alloc, Augment>::assign(SortedUnique, It first, It last) {
+    clear();
+    std::size_t n = static_cast<std::size_t>(std::distance(first, last));
+    root = build(first, n);
+    nodeCount = n;
+}
+
+template <typename T, typename Trace, typename Alloc, typename Augment>
+typename AVLTree<T, Trace, Alloc, Augment>::Node* AVLTree<T, Trace, Alloc, Augment>::link(Node* left, Node* node, Node* right) {
+    node->left = left;
+    node->right = right;
+    if (left) {
+        left->parent = node;
+    }
+    if (right) {
+        right->parent = node;
+    }
+    updateHeight(node);
+    updateSize(node);
+    return node;
+}
+
+template <typename T, typename Trace, typename Alloc, typename Augment>
+typename AVLTree<T, Trace, Alloc, Augment>::Node* AVLTree<T, Trace, Alloc, Augment>::joinRight(Node* left, Node* node, Node* right) {
+    Node* inner = left->right;
+
+    if (getHeight(inner) <= getHeight(right) + 1) {
+        link(inner, node, right);
+        if (node->height <= getHeight(left->left) + 1) {
+            return link(left->left, left, node);
+        }
+        link(left->left, left, rotateRight(node));
+        return rotateLeft(left);
+    }
+
+    Node* joined = joinRight(inner, node, right);
+    link(left->left, left, joined);
+    if (joined->height <= getHeight(left->left) + 1) {
+        return left;
+    }
+    return rotateLeft(left);
+}
+
+template <typename T, typename Trace, typename Alloc, typename Augment>
+typename AVLTree<T, Trace, Alloc, Augment>::Node* AVLTree<T, Trace, Alloc, Augment>::joinLeft(Node* left, Node* node, Node* right) {
+    Node* inner = right->left;
+
+    if (getHeight(inner) <= getHeight(left) + 1) {
+        link(left, node, inner);
+        if (node->height <= getHeight(right->right) + 1) {
+            return link(node, right, right->right);
+        }
+        link(rotateLeft(node), right, right->right);
+        return rotateRight(right);
+    }
+
+    Node* joined = joinLeft(left, node, inner);
+    link(joined, right, right->right);
+    if (joined->height <= getHeight(right->right) + 1) {
+        return right;
+    }
+    return rotateRight(right);
+}
+
+// Joins left, node and right, where left < node < right; O(|h(left) - h(right)|).
+template <typename T, typename Trace, typename Alloc, typename Augment>
+typename AVLTree<T, Trace, Alloc, Augment>::Node* AVLTree<T, Trace, Alloc, Augment>::joinNodes(Node* left, Node* node, Node* right) {
+    Node* joined;
+    if (getHeight(left) > getHeight(right) + 1) {
+        joined = joinRight(left, node, right);
+    }
+    else if (getHeight(right) > getHeight(left) + 1) {
+        joined = joinLeft(left, node, right);
+    }
+    else {
+        joined = link(left, node, right);
+    }
+    joined->parent = nullptr;
+    return joined;
+}
+
+// Removes the largest node of a non-empty subtree into last.
+template <typename T, typename Trace, typename Alloc, typename Augment>
+typename AVLTree<T, Trace, Alloc, Augment>::Node* AVLTree<T, Trace, Alloc, Augment>::splitLast(Node* node, Node*& last) {
+    if (!node->right) {
+        last = node;
+        if (node->left) {
+            node->left->parent = nullptr;
+        }
+        return node->left;
+    }
+    Node* rest = splitLast(node->right, last);
+    return joinNodes(node->left, node, rest);
+}
+
+template <typename T, typename Trace, typename Alloc, typename Augment>
+typename AVLTree<T, Trace, Alloc, Augment>::Node* AVLTree<T, Trace, Alloc, Augment>::join2(Node* left, Node* right) {
+    if (!left) {
+        return right;
+    }
+    Node* last;
+    Node* rest = splitLast(left, last);
+    return joinNodes(rest, last, right);
+}
+
+template <typename T, typename Trace, typename Alloc, typename Augment>
+template <typename Key>
+void AVLTree<T, Trace, Alloc, Augment>::splitNodes(Node* node, const Key& key, Node*& left, Node*& found, Node*& right) {
+    if (!node) {
+        left = found = right = nullptr;
+        return;
+    }
+
+    Node* l = node->left;
+    Node* r = node->right;
+    if (key < node->data) {
+        Node* rest;
+        splitNodes(l, key, left, found, rest);
+        right = joinNodes(rest, node, r);
+    }
+    else if (node->data < key) {
+        Node* rest;
+        splitNodes(r, key, rest, found, right);
+        left = joinNodes(l, node, rest);
+    }
+    else {
+        if (l) {
+            l->parent = nullptr;
+        }
+        if (r) {
+            r->parent = nullptr;
+        }
+        left = l;
+        right = r;
+        found = node;
+    }
+}
+
+// Union of a and b keeping the nodes of a for equal elements. The nodes of
+// b that lose are joined into *dups, or destroyed when dups is null.
+template <typename T, typename Trace, typename Alloc, typename Augment>
+typename AVLTree<T, Trace, Alloc, Augment>::Node* AVLTree<T, Trace, Alloc, Augment>::unite(Node* a, Node* b, Node** dups, std::size_t& dupCount, const ForkContext& fork) {
+    if (!a || !b) {
+        if (dups) {
+            *dups = nullptr;
+        }
+        return a ? a : b;
+    }
+
+    int height = std::min(a->height, b->height);
+    Node* bl = b->left;
+    Node* br = b->right;
+    Node* al, * found, * ar;
+    splitNodes(a, b->data, al, found, ar);
+
+    Node* left = nullptr, * right = nullptr;
+    Node* dupsLeft, * dupsRight;
+    std::size_t dupsRightCount = 0;
+    fork.invoke(height,
+        [&] { left = unite(al, bl, dups ? &dupsLeft : nullptr, dupCount, fork); },
+        [&] { right = unite(ar, br, dups ? &dupsRight : nullptr, dupsRightCount, fork); });
+    dupCount += dupsRightCount;
+
+    if (!found) {
+        if (dups) {
+            *dups = join2(dupsLeft, dupsRight);
+        }
+        return joinNodes(left, b, right);
+    }
+
+    dupCount++;
+    if (dups) {
+        *dups = joinNodes(dupsLeft, b, dupsRight);
+    }
+    else {
+        dispose(b, fork);
+    }
+    return joinNodes(left, found, right);
+}
+
+template <typename T, typename Trace, typename Alloc, typename Augment>
+typename AVLTree<T, Trace, Alloc, Augment>::Node* AVLTree<T, Trace, Alloc, Augment>::intersect(Node* a, Node* b, std::size_t& dropped, const ForkContext& fork) {
+    if (!a || !b) {
+        dropped += discard(a, fork) + discard(b, fork);
+        return nullptr;
+    }
+
+    int height = std::min(a->height, b->height);
+    Node* bl = b->left;
+    Node* br = b->right;
+    Node* al, * found, * ar;
+    splitNodes(a, b->data, al, found, ar);
+
+    Node* left = nullptr, * right = nullptr;
+    std::size_t droppedRight = 0;
+    fork.invoke(height,
+        [&] { left = intersect(al, bl, dropped, fork); },
+        [&] { right = intersect(ar, br, droppedRight, fork); });
+    dispose(b, fork);
+    dropped += droppedRight + 1;
+
+    if (found) {
+        return joinNodes(left, found, right);
+    }
+    return join2(left, right);
+}
+
+template <typename T, typename Trace, typename Alloc, typename Augment>
+typename AVLTree<T, Trace, Alloc, Augment>::Node* AVLTree<T, Trace, Alloc, Augment>::subtract(Node* a, Node* b, std::size_t& dropped, const ForkContext& fork) {
+    if (!a || !b) {
+        dropped += discard(b, fork);
+        return a;
+    }
+
+    int height = std::min(a->height, b->height);
+    Node* bl = b->left;
+    Node* br = b->right;
+    Node* al, * found, * ar;
+    splitNodes(a, b->data, al, found, ar);
+
+    Node* left = nullptr, * right = nullptr;
+    std::size_t droppedRight = 0;
+    fork.invoke(height,
+        [&] { left = subtract(al, bl, dropped, fork); },
+        [&] { right = subtract(ar, br, droppedRight, fork); });
+    dispose(b, fork);
+    dropped += droppedRight + 1;
+    if (found) {
+        dispose(found, fork);
+        dropped++;
+    }
+    return join2(left, right);
+}
+
+template <typename T, typename Trace, typename Alloc, typename Augment>
+template <typename Pred>
+typename AVLTree<T, Trace, Alloc, Augment>::Node* AVLTree<T, Trace, Alloc, Augment>::filterNodes(Node* node, Pred& pred, std::size_t& dropped, const ForkContext& fork) {
+    if (!node) {
+        return nullptr;
+    }
+
+    Node* l = node->left;
+    Node* r = node->right;
+    Node* left = nullptr, * right = nullptr;
+    std::size_t droppedRight = 0;
+    fork.invoke(node->height,
+        [&] { left = filterNodes(l, pred, dropped, fork); },
+        [&] { right = filterNodes(r, pred, droppedRight, fork); });
+    dropped += droppedRight;
+
+    if (pred(static_cast<const T&>(node->data))) {
+        return joinNodes(left, node, right);
+    }
+    dispose(node, fork);
+    dropped++;
+    return join2(left, right);
+}
+
+// Builds the same shape as build(it, n) from a random-access range,
+// creating the two halves in parallel.
+template <typename T, typename Trace, typename Alloc, typename Augment>
+template <typename It>
+typename AVLTree<T, Trace, Alloc, Augment>::Node* AVLTree<T, Trace, Alloc, Augment>::build(It first, std::size_t n, const ForkContext& fork) {
+    if (n == 0) {
+        return nullptr;
+    }
+
+    std::size_t leftSize = (n - 1) / 2;
+    Node* left = nullptr, * right = nullptr;
+    fork.invoke(log2Floor(n),
+        [&] { left = build(first, leftSize, fork); },
+        [&] { right = build(first + (leftSize + 1), n - 1 - leftSize, fork); });
+    Node* node = pool.create(first[leftSize]);
+    return link(left, node, right);
+}
+
+template <typename T, typename Trace, typename Alloc, typename Augment>
+void AVLTree<T, Trace, Alloc, Augment>::dispose(Node* node, const ForkContext& fork) {
+    fork.locked([&] { pool.destroy(node); });
+}
+
+template <typename T, typename Trace, typename Alloc, typename Augment>
+std::size_t AVLTree<T, Trace, Alloc, Augment>::discard(Node* node, const ForkContext& fork) {
+    std::size_t count = 0;
+    if (node) {
+        fork.locked([&] { count = clear(node); });
+    }
+    return count;
+}
+
+// Takes the nodes of other, leaving it empty.
+template <typename T, typename Trace, typename Alloc, typename Augment>
+typename AVLTree<T, Trace, Alloc, Augment>::Node* AVLTree<T, Trace, Alloc, Augment>::adoptFrom(AVLTree& other) {
+    pool.adopt(other.pool);
+    Node* nodes = other.root;
+    other.root = nullptr;
+    other.nodeCount = 0;
+    return nodes;
+}
+
+// Rebuilds a subtree of this pool in the pool of to, keeping its shape.
+template <typename T, typename Trace, typename Alloc, typename Augment>
+typename AVLTree<T, Trace, Alloc, Augment>::Node* AVLTree<T, Trace, Alloc, Augment>::transfer(Node* node, AVLTree& to) {
+    if (!node) {
+        return nullptr;
+    }
+    Node* left = transfer(node->left, to);
+    Node* right = transfer(node->right, to);
+    Node* copy = to.createNode(std::move(node->data));
+    pool.destroy(node);
+    return link(left, copy, right);
+}
+
+template <typename T, typename Trace, typename Alloc, typename Augment>
+void AVLTree<T, Trace, Alloc, Augment>::join(const T& key, AVLTree& right) {
+    if (&right == this) {
+        throw std::invalid_argument("AVLTree::join: right must be another tree");
+    }
+    std::size_t count = right.nodeCount;
+    Node* nodes = adoptFrom(right);
+    root = joinNodes(root, createNode(key), nodes);
+    nodeCount += count + 1;
+}
+
+template <typename T, typename Trace, typename Alloc, typename Augment>
+template <typename Key>
+bool AVLTree<T, Trace, Alloc, Augment>::split(const Key& key, AVLTree& right) {
+    if (&right == this) {
+        throw std::invalid_argument("AVLTree::split: right must be another tree");
+    }
+    right.clear();
+
+    Node* left, * found, * rest;
+    splitNodes(root, key, left, found, rest);
+    if (found) {
+        pool.destroy(found);
+    }
+
+    if constexpr (!NodePool::transferable) {
+        rest = transfer(rest, right);
+    }
+    if (left) {
+        left->parent = nullptr;
+    }
+    if (rest) {
+        rest->parent = nullptr;
+    }
+
+    std::size_t total = nodeCount - (found ? 1 : 0);
+    root = left;
+    right.root = rest;
+    if constexpr (Augment::enabled) {
+        nodeCount = getSize(left);
+        right.nodeCount = getSize(rest);
+    }
+    else {
+        // Walk both halves in step until the smaller one runs out.
+        const Node* l = minNode(left);
+        const Node* r = minNode(rest);
+        std::size_t steps = 0;
+        while (l && r) {
+            l = nextNode(l);
+            r = nextNode(r);
+            steps++;
+        }
+        nodeCount = l ? total - steps : steps;
+        right.nodeCount = total - nodeCount;
+    }
+    return found != nullptr;
+}
+
+template <typename T, typename Trace, typename Alloc, typename Augment>
+void AVLTree<T, Trace, Alloc, Augment>::union_with(AVLTree& other, const ForkContext& fork) {
+    if (&other == this) {
+        return;
+    }
+    std::size_t count = other.nodeCount;
+    std::size_t dupCount = 0;
+    root = unite(root, adoptFrom(other), nullptr, dupCount, fork);
+    if (root) {
+        root->parent = nullptr;
+    }
+    nodeCount += count - dupCount;
+}
+
+template <typename T, typename Trace, typename Alloc, typename Augment>
+void AVLTree<T, Trace, Alloc, Augment>::intersect_with(AVLTree& other, const ForkContext& fork) {
+    if (&other == this) {
+        return;
+    }
+    std::size_t count = other.nodeCount;
+    std::size_t dropped = 0;
+    root = intersect(root, adoptFrom(other), dropped, fork);
+    if (root) {
+        root->parent = nullptr;
+    }
+    nodeCount = nodeCount + count - dropped;
+}
+
+template <typename T, typename Trace, typename Alloc, typename Augment>
+void AVLTree<T, Trace, Alloc, Augment>::difference_with(AVLTree& other, const ForkContext& fork) {
+    if (&other == this) {
+        clear();
+        return;
+    }
+    std::size_t count = other.nodeCount;
+    std::size_t dropped = 0;
+    root = subtract(root, adoptFrom(other), dropped, fork);
+    if (root) {
+        root->parent = nullptr;
+    }
+    nodeCount = nodeCount + count - dropped;
+}
+
+template <typename T, typename Trace, typename Alloc, typename Augment>
+template <typename Pred>
+void AVLTree<T, Trace, Alloc, Augment>::filter(Pred& pred, const ForkContext& fork) {
+    std::size_t dropped = 0;
+    root = filterNodes(root, pred, dropped, fork);
+    if (root) {
+        root->parent = nullptr;
+    }
+    nodeCount -= dropped;
+}
+
+// Like unite() with a sorted range in place of the second tree: the range
+// is split at each node by binary search, and only the keys that are new
+// get nodes.
+template <typename T, typename Trace, typename Alloc, typename Augment>
+template <typename It>
+typename AVLTree<T, Trace, Alloc, Augment>::Node* AVLTree<T, Trace, Alloc, Augment>::uniteSorted(Node* node, It first, It last, std::size_t& added) {
+    if (first == last) {
+        return node;
+    }
+    if (!node) {
+        std::size_t n = static_cast<std::size_t>(last - first);
+        added += n;
+        return build(first, n);
+    }
+
+    It mid = std::lower_bound(first, last, node->data);
+    bool found = mid != last && !(node->data < *mid);
+    Node* left = uniteSorted(node->left, first, mid, added);
+    Node* right = uniteSorted(node->right, found ? mid + 1 : mid, last, added);
+    return joinNodes(left, node, right);
+}
+
+template <typename T, typename Trace, typename Alloc, typename Augment>
+template <typename It>
+typename AVLTree<T, Trace, Alloc, Augment>::Node* AVLTree<T, Trace, Alloc, Augment>::subtractSorted(Node* node, It first, It last, std::size_t& removed) {
+    if (!node || first == last) {
+        return node;
+    }
+
+    It mid = std::lower_bound(first, last, node->data);
+    bool found = mid != last && !(node->data < *mid);
+    Node* left = subtractSorted(node->left, first, mid, removed);
+    Node* right = subtractSorted(node->right, found ? mid + 1 : mid, last, removed);
+    if (found) {
+        pool.destroy(node);
+        removed++;
+        return join2(left, right);
+    }
+    return joinNodes(left, node, right);
+}
+
+template <typename T, typename Trace, typename Alloc, typename Augment>
+template <typename It>
+std::size_t AVLTree<T, Trace, Alloc, Augment>::insert_batch(It first, It last, unsigned threads) {
+    std::vector<T> values(first, last);
+    sortUnique(values, threads);
+    return insert_batch(sortedUnique, std::make_move_iterator(values.begin()), std::make_move_iterator(values.end()));
+}
+
+template <typename T, typename Trace, typename Alloc, typename Augment>
+template <typename It>
+std::size_t AVLTree<T, Trace, Alloc, Augment>::insert_batch(SortedUnique, It first, It last) {
+    std::size_t added = 0;
+    root = uniteSorted(static_cast<Node*>(root), first, last, added);
+    if (root) {
+        root->parent = nullptr;
+    }
+    nodeCount += added;
+    return added;
+}
+
+template <typename T, typename Trace, typename Alloc, typename Augment>
+template <typename It>
+std::size_t AVLTree<T, Trace, Alloc, Augment>::erase_batch(It first, It last, unsigned threads) {
+    std::vector<T> values(first, last);
+    sortUnique(values, threads);
+    return erase_batch(sortedUnique, values.begin(), values.end());
+}
+
+template <typename T, typename Trace, typename Alloc, typename Augment>
+template <typename It>
+std::size_t AVLTree<T, Trace, Alloc, Augment>::erase_batch(SortedUnique, It first, It last) {
+    std::size_t removed = 0;
+    root = subtractSorted(static_cast<Node*>(root), first, last, removed);
+    if (root) {
+        root->parent = nullptr;
+    }
+    nodeCount -= removed;
+    return removed;
+}
+
+template <typename T, typename Trace, typename Alloc, typename Augment>
+void AVLTree<T, Trace, Alloc, Augment>::union_with(Parallel policy, AVLTree& other) {
+    std::mutex lock;
+    union_with(other, ForkContext(policy, NodePool::concurrent ? nullptr : &lock));
+}
+
+template <typename T, typename Trace, typename Alloc, typename Augment>
+void AVLTree<T, Trace, Alloc, Augment>::intersect_with(Parallel policy, AVLTree& other) {
+    std::mutex lock;
+    intersect_with(other, ForkContext(policy, NodePool::concurrent ? nullptr : &lock));
+}
+
+template <typename T, typename Trace, typename Alloc, typename Augment>
+void AVLTree<T, Trace, Alloc, Augment>::difference_with(Parallel policy, AVLTree& other) {
+    std::mutex lock;
+    difference_with(other, ForkContext(policy, NodePool::concurrent ? nullptr : &lock));
+}
+
+template <typename T, typename Trace, typename Alloc, typename Augment>
+template <typename Pred>
+void AVLTree<T, Trace, Alloc, Augment>::filter(Parallel policy, Pred pred) {
+    std::mutex lock;
+    filter(pred, ForkContext(policy, NodePool::concurrent ? nullptr : &lock));
+}
+
+template <typename T, typename Trace, typename Alloc, typename Augment>
+template <typename It>
+void AVLTree<T, Trace, Alloc, Augment>::assign(Parallel policy, It first, It last) {
+    std::vector<T> values(first, last);
+    sortUnique(values, policy);
+    assign(policy, sortedUnique, std::make_move_iterator(values.begin()), std::make_move_iterator(values.end()));
+}
+
+template <typename T, typename Trace, typename Alloc, typename Augment>
+template <typename It>
+void AVLTree<T, Trace, Alloc, Augment>::assign(Parallel policy, SortedUnique, It first, It last) {
+    clear();
+    std::size_t n = static_cast<std::size_t>(std::distance(first, last));
+    if constexpr (NodePool::concurrent) {
+        // Nodes are created on several threads, so they are counted here.
+        root = build(first, n, ForkContext(policy, nullptr));
+        if constexpr (Trace::counting) {
+            counters.nodesAllocated += n;
+        }
+    }
+    else {
+        root = build(first, n);
+    }
+    if (root) {
+        root->parent = nullptr;
+    }
+    nodeCount = n;
+}
+
+template <typename T, typename Trace, typename Alloc, typename Augment>
+void AVLTree<T, Trace, Alloc, Augment>::merge(AVLTree& other) {
+    if (&other == this) {
+        return;
+    }
+    std::size_t count = other.nodeCount;
+    std::size_t dupCount = 0;
+    Node* dups;
+    root = unite(root, adoptFrom(other), &dups, dupCount, ForkContext());
+    nodeCount += count - dupCount;
+
+    if constexpr (!NodePool::transferable) {
+        dups = transfer(dups, other);
+    }
+    if (dups) {
+        dups->parent = nullptr;
+    }
+    other.root = dups;
+    other.nodeCount = dupCount;
+}
+
+
+template <typename T, typename Trace, typename Alloc, typename Augment>
+template <typename Key>
+void AVLTree<T, Trace, Alloc, Augment>::remove(const Key& value) {
+    if constexpr (Trace::enabled) {
+        std::cout << "\nУдаление " << value << ":" << std::endl;
+    }
+
+    Link* path[kMaxHeight];
+    int depth = 0;
+    Node* parent;
+    Link* link = descend(value, path, depth, parent);
+
+    Node* node = *link;
+    if (node) {
+        if (!node->left || !node->right) {
+            Node* child = node->left ? node->left : node->right;
+            if (child) {
+                child->parent = node->parent;
+            }
+            *link = child;
+            pool.destroy(node);
+        }
+        else {
+            // The successor's node takes the place of the removed one rather
+            // than handing over its element, so every other element keeps its
+            // address (AVLMap values may be referenced from outside).
+            int top = depth;
+            path[depth++] = link;
+            Link* minLink = &node->right;
+            while ((*minLink)->left) {
+                path[depth++] = minLink;
+                minLink = &(*minLink)->left;
+            }
+            Node* next = *minLink;
+            if (next->right) {
+                next->right->parent = next->parent;
+            }
+            *minLink = next->right;
+
+            static_cast<typename Augment::Field&>(*next) = static_cast<const typename Augment::Field&>(*node);
+            next->height = node->height;
+            next->left = node->left;
+            next->right = node->right;
+            next->parent = node->parent;
+            if (next->left) {
+                next->left->parent = next;
+            }
+            if (next->right) {
+                next->right->parent = next;
+            }
+            *link = next;
+            if (depth > top + 1) {
+                path[top + 1] = &next->right;
+            }
+            pool.destroy(node);
+        }
+        nodeCount--;
+        rebalance(path, depth);
+    }
+
+    if constexpr (Trace::enabled) {
+        displayBalanceInfo();
+    }
+}
+
+template <typename T, typename Trace, typename Alloc, typename Augment>
+template <typename Key>
+bool AVLTree<T, Trace, Alloc, Augment>::search(const Key& value) const {
+    Node* node = root;
+    std::size_t nodes = 0;
+    std::size_t compares = 0;
+    while (node) {
+        nodes++;
+        if (value < node->data) {
+            compares += 1;
+            node = node->left;
+        }
+        else if (node->data < value) {
+            compares += 2;
+            node = node->right;
+        }
+        else {
+            compares += 2;
+            break;
+        }
+    }
+    if constexpr (Trace::counting) {
+        counters.descent(nodes, compares);
+    }
+    return node != nullptr;
+}
+
+
+template <typename T, typename Trace, typename Alloc, typename Augment>
+const typename AVLTree<T, Trace, Alloc, Augment>::Node* AVLTree<T, Trace, Alloc, Augment>::minNode(const Node* node) {
+    while (node && node->left) {
+        node = node->left;
+    }
+    return node;
+}
+
+template <typename T, typename Trace, typename Alloc, typename Augment>
+const typename AVLTree<T, Trace, Alloc, Augment>::Node* AVLTree<T, Trace, Alloc, Augment>::maxNode(const Node* node) {
+    while (node && node->right) {
+        node = node->right;
+    }
+    return node;
+}
+
+template <typename T, typename Trace, typename Alloc, typename Augment>
+const typename AVLTree<T, Trace, Alloc, Augment>::Node* AVLTree<T, Trace, Alloc, Augment>::nextNode(const Node* node) {
+    if (node->right) {
+        return minNode(node->right);
+    }
+    while (node->parent && node == node->parent->right) {
+        node = node->parent;
+    }
+    return node->parent;
+}
+
+template <typename T, typename Trace, typename Alloc, typename Augment>
+const typename AVLTree<T, Trace, Alloc, Augment>::Node* AVLTree<T, Trace, Alloc, Augment>::prevNode(const Node* node) {
+    if (node->left) {
+        return maxNode(node->left);
+    }
+    while (node->parent && node == node->parent->left) {
+        node = node->parent;
+    }
+    return node->parent;
+}
+
+
+// Returns the subtree's height, or -1 if anything in it is off. prev is the
+// last node visited in order.
+template <typename T, typename Trace, typename Alloc, typename Augment>
+int AVLTree<T, Trace, Alloc, Augment>::checkNode(const Node* node, const Node* parent, const Node*& prev, std::size_t& count) {
+    if (!node) {
+        return 0;
+    }
+    if (node->parent != parent) {
+        return -1;
+    }
+    int left = checkNode(node->left, node, prev, count);
+    if (left < 0 || (prev && !(prev->data < node->data))) {
+        return -1;
+    }
+    prev = node;
+    count++;
+    int right = checkNode(node->right, node, prev, count);
+    if (right < 0 || node->height != std::max(left, right) + 1 || left - right > 1 || right - left > 1) {
+        return -1;
+    }
+    if (Augment::enabled && getSize(node) != getSize(node->left) + getSize(node->right) + 1) {
+        return -1;
+    }
+    return node->height;
+}
+
+template <typename T, typename Trace, typename Alloc, typename Augment>
+bool AVLTree<T, Trace, Alloc, Augment>::isValid() const {
+    const Node* prev = nullptr;
+    std::size_t count = 0;
+    return checkNode(root, nullptr, prev, count) >= 0 && count == nodeCount;
+}
+
+// A lane holds one lookup in progress. A lane that finishes takes the next
+// key, so short and long descents share the lanes without waiting.
+template <typename T, typename Trace, typename Alloc, typename Augment>
+template <typename Key, typename F>
+void AVLTree<T, Trace, Alloc, Augment>::lookupBatch(const Key* keys, std::size_t n, F done) const {
+    const Node* top = root;
+    if (top == nullptr) {
+        for (std::size_t i = 0; i < n; i++) {
+            done(i, nullptr);
+        }
+        if constexpr (Trace::counting) {
+            for (std::size_t i = 0; i < n; i++) {
+                counters.descent(0, 0);
+            }
+        }
+        return;
+    }
+
+    struct Lane {
+        const Node* node;
+        std::size_t index;
+        std::size_t nodes;
+        std::size_t compares;
+    };
+    Lane lanes[kBatchLanes];
+    std::size_t active = 0;
+    std::size_t next = 0;
+    while (active < kBatchLanes && next < n) {
+        lanes[active++] = { top, next++, 0, 0 };
+    }
+
+    while (active > 0) {
+        for (std::size_t j = 0; j < active;) {
+            Lane& lane = lanes[j];
+            const Node* node = lane.node;
+            const Key& key = keys[lane.index];
+
+            bool less = key < node->data;
+            bool greater = !less && node->data < key;
+            lane.nodes++;
+            lane.compares += less ? 1 : 2;
+            if (less || greater) {
+                node = less ? node->left : node->right;
+                if (node != nullptr) {
+                    prefetchRead(node);
+                    lane.node = node;
+                    j++;
+                    continue;
+                }
+                done(lane.index, nullptr);
+            }
+            else {
+                done(lane.index, node);
+            }
+            if constexpr (Trace::counting) {
+                counters.descent(lane.nodes, lane.compares);
+            }
+
+            if (next < n) {
+                lane = { top, next++, 0, 0 };
+                j++;
+            }
+            else {
+                lane = lanes[--active];
+            }
+        }
+    }
+}
+
+template <typename T, typename Trace, typename Alloc, typename Augment>
+template <typename Key>
+void AVLTree<T, Trace, Alloc, Augment>::contains_batch(const Key* keys, std::size_t n, bool* out) const {
+    lookupBatch(keys, n, [out](std::size_t i, const Node* node) { out[i] = node != nullptr; });
+}
+
+template <typename T, typename Trace, typename Alloc, typename Augment>
+template <typename Key>
+void AVLTree<T, Trace, Alloc, Augment>::find_batch(const Key* keys, std::size_t n, const_iterator* out) const {
+    lookupBatch(keys, n, [this, out](std::size_t i, const Node* node) { out[i] = const_iterator(node, this); });
+}
+
+template <typename T, typename Trace, typename Alloc, typename Augment>
+template <typename Key>
+typename AVLTree<T, Trace, Alloc, Augment>::const_iterator AVLTree<T, Trace, Alloc, Augment>::find(const Key& value) const {
+    const_iterator it = lower_bound(value);
+    return it != end() && !(value < *it) ? it : end();
+}
+
+// The four bound lookups differ only in which way the search goes at a
+// node and on which side the candidate is kept; goLeft(node) picks the
+// way, and the node is remembered when the search leaves it to the left
+// (or to the right, with KeepRight).
+template <typename T, typename Trace, typename Alloc, typename Augment>
+template <bool KeepRight, typename GoLeft>
+const typename AVLTree<T, Trace, Alloc, Augment>::Node* AVLTree<T, Trace, Alloc, Augment>::bound(GoLeft goLeft) const {
+    const Node* node = root;
+    const Node* result = nullptr;
+    std::size_t nodes = 0;
+    while (node) {
+        nodes++;
+        if (goLeft(node)) {
+            if (!KeepRight) {
+                result = node;
+            }
+            node = node->left;
+        }
+        else {
+            if (KeepRight) {
+                result = node;
+            }
+            node = node->right;
+        }
+    }
+    if constexpr (Trace::counting) {
+        counters.descent(nodes, nodes);
+    }
+    return result;
+}
+
+template <typename T, typename Trace, typename Alloc, typename Augment>
+template <typename Key>
+typename AVLTree<T, Trace, Alloc, Augment>::const_iterator AVLTree<T, Trace, Alloc, Augment>::lower_bound(const Key& value) const {
+    return const_iterator(bound<false>([&value](const Node* node) { return !(node->data < value); }), this);
+}
+
+template <typename T, typename Trace, typename Alloc, typename Augment>
+template <typename Key>
+typename AVLTree<T, Trace, Alloc, Augment>::const_iterator AVLTree<T, Trace, Alloc, Augment>::upper_bound(const Key& value) const {
+    return const_iterator(bound<false>([&value](const Node* node) { return value < node->data; }), this);
+}
+
+template <typename T, typename Trace, typename Alloc, typename Augment>
+template <typename Key>
+typename AVLTree<T, Trace, Alloc, Augment>::const_iterator AVLTree<T, Trace, Alloc, Augment>::floor(const Key& value) const {
+    return const_iterator(bound<true>([&value](const Node* node) { return value < node->data; }), this);
+}
+
+template <typename T, typename Trace, typename Alloc, typename Augment>
+template <typename Key>
+typename AVLTree<T, Trace, Alloc, Augment>::const_iterator AVLTree<T, Trace, Alloc, Augment>::predecessor(const Key& value) const {
+    return const_iterator(bound<true>([&value](const Node* node) { return !(node->data < value); }), this);
+}
+
+template <typename T, typename Trace, typename Alloc, typename Augment>
+template <typename Key>
+std::size_t AVLTree<T, Trace, Alloc, Augment>::rank(const Key& value) const {
+    static_assert(Augment::enabled, "rank() needs the SubtreeSize augmentation");
+    std::size_t result = 0;
+    std::size_t nodes = 0;
+    const Node* node = root;
+    while (node) {
+        nodes++;
+        if (node->data < value) {
+            result += getSize(node->left) + 1;
+            node = node->right;
+        }
+        else {
+            node = node->left;
+        }
+    }
+    if constexpr (Trace::counting) {
+        counters.descent(nodes, nodes);
+    }
+    return result;
+}
+
+template <typename T, typename Trace, typename Alloc, typename Augment>
+typename AVLTree<T, Trace, Alloc, Augment>::const_iterator AVLTree<T, Trace, Alloc, Augment>::select(std::size_t k) const {
+    static_assert(Augment::enabled, "select() needs the SubtreeSize augmentation");
+    const Node* node = root;
+    while (node) {
+        std::size_t leftSize = getSize(node->left);
+        if (k < leftSize) {
+            node = node->left;
+        }
+        else if (k > leftSize) {
+            k -= leftSize + 1;
+            node = node->right;
+        }
+        else {
+            break;
+        }
+    }
+    return const_iterator(node, this);
+}
+
+template <typename T, typename Trace, typename Alloc, typename Augment>
+template <typename Key>
+std::size_t AVLTree<T, Trace, Alloc, Augment>::count_range(const Key& lo, const Key& hi) const {
+    static_assert(Augment::enabled, "count_range() needs the SubtreeSize augmentation");
+    if (hi < lo) {
+        return 0;
+    }
+
+    std::size_t notAbove = 0;
+    std::size_t nodes = 0;
+    const Node* node = root;
+    while (node) {
+        nodes++;
+        if (hi < node->data) {
+            node = node->left;
+        }
+        else {
+            notAbove += getSize(node->left) + 1;
+            node = node->right;
+        }
+    }
+    if constexpr (Trace::counting) {
+        counters.descent(nodes, nodes);
+    }
+    return notAbove - rank(lo);
+}
+
+
+template <typename T, typename Trace, typename Alloc, typename Augment>
+void AVLTree<T, Trace, Alloc, Augment>::inorder(Node* node) const {
+    Node* stack[kMaxHeight];
+    int top = 0;
+    while (node || top > 0) {
+        while (node) {
+            stack[top++] = node;
+            node = node->left;
+        }
+        node = stack[--top];
+        std::cout << node->data << "(" << getBalanceFactor(node) << ") ";
+        node = node->right;
+    }
+}
+
+template <typename T, typename Trace, typename Alloc, typename Augment>
+void AVLTree<T, Trace, Alloc, Augment>::preorder(Node* node) const {
+    Node* stack[kMaxHeight + 1];
+    int top = 0;
+    if (node) {
+        stack[top++] = node;
+    }
+    while (top > 0) {
+        node = stack[--top];
+        std::cout << node->data << "(" << getBalanceFactor(node) << ") ";
+        if (node->right) {
+            stack[top++] = node->right;
+        }
+        if (node->left) {
+            stack[top++] = node->left;
+        }
+    }
+}
+
+template <typename T, typename Trace, typename Alloc, typename Augment>
+void AVLTree<T, Trace, Alloc, Augment>::postorder(Node* node) const {
+    Node* stack[kMaxHeight];
+    int top = 0;
+    Node* last = nullptr;
+    while (node || top > 0) {
+        while (node) {
+            stack[top++] = node;
+            node = node->left;
+        }
+        Node* peek = stack[top - 1];
+        if (peek->right && peek->right != last) {
+            node = peek->right;
+        }
+        else {
+            std::cout << peek->data << "(" << getBalanceFactor(peek) << ") ";
+            last = peek;
+            top--;
+        }
+    }
+}
+
+template <typename T, typename Trace, typename Alloc, typename Augment>
+void AVLTree<T, Trace, Alloc, Augment>::displayInorder() const {
+    std::cout << "Inorder (с баланс-факторами): ";
+    inorder(root);
+    std::cout << std::endl;
+}
+
+template <typename T, typename Trace, typename Alloc, typename Augment>
+void AVLTree<T, Trace, Alloc, Augment>::displayPreorder() const {
+    std::cout << "Preorder (с баланс-факторами): ";
+    preorder(root);
+    std::cout << std::endl;
+}
+
+template <typename T, typename Trace, typename Alloc, typename Augment>
+void AVLTree<T, Trace, Alloc, Augment>::displayPostorder() const {
+    std::cout << "Postorder (с баланс-факторами): ";
+    postorder(root);
+    std::cout << std::endl;
+}
+
+
+
+template <typename T, typename Trace, typename Alloc, typename Augment>
+void AVLTree<T, Trace, Alloc, Augment>::displayTree() const {
+    std::cout << "\nAVL Дерево (вертикальный вид):\n";
+    std::cout << "===============================\n";
+    printLevel(root, 0, 0, true);
+    std::cout << "===============================\n";
+}
+
+template <typename T, typename Trace, typename Alloc, typename Augment>
+void AVLTree<T, Trace, Alloc, Augment>::printLevel(Node* node, int level, int spaces, bool left) const {
+    if (!node) {
+        return;
+    }
+
+    printLevel(node->right, level + 1, spaces + 6, false);
+
+
+    std::cout << std::string(spaces, ' ');
+    if (level > 0) {
+        std::cout << (left ? "└── " : "┌── ");
+    }
+    std::cout << node->data << "[h=" << getHeight(node) << "]" << std::endl;
+  
+    printLevel(node->left, level + 1, spaces + 6, true);
+}
+
+
+template <typename T, typename Trace, typename Alloc, typename Augment>
+TreeStats AVLTree<T, Trace, Alloc, Augment>::stats() const {
+    static_assert(Trace::counting, "stats() needs the Counting trace policy");
+    TreeStats result = counters;
+    result.height = getHeight(root);
+    return result;
+}
+
+template <typename T, typename Trace, typename Alloc, typename Augment>
+void AVLTree<T, Trace, Alloc, Augment>::displayBalanceInfo() const {
+    std::cout << "Высота дерева: " << getTreeHeight() << std::endl;
+}
+
+
+template <typename T, typename Trace, typename Alloc, typename Augment>
+std::size_t AVLTree<T, Trace, Alloc, Augment>::clear(Node* node) {
+    std::size_t count = 0;
+    while (node) {
+        if (node->left) {
+            Node* left = node->left;
+            node->left = left->right;
+            left->right = node;
+            node = left;
+        }
+        else {
+            Node* right = node->right;
+            pool.destroy(node);
+            node = right;
+            count++;
+        }
+    }
+    return count;
+}
+
+template <typename T, typename Trace, typename Alloc, typename Augment>
+void AVLTree<T, Trace, Alloc, Augment>::clear() {
+    if constexpr (bulkClear) {
+        pool.releaseAll();
+    }
+    else {
+        clear(root);
+    }
+    root = nullptr;
+    nodeCount = 0;
+}
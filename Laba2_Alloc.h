@@ -0,0 +1,554 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <new>
+#include <utility>
+#include <vector>
+
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
+
+// Node allocation policies for BST, AVLTree and RBTree.
+//
+// A policy provides a nested Pool<Node> with create(args...) and
+// destroy(node). When Pool::bulkRelease is true, releaseAll() drops every
+// node at once without visiting it; the trees use that for clear() and
+// their destructors when the nodes are trivially destructible.
+//
+// adopt(other) takes over every node of another pool of the same type, so
+// a tree can splice in the nodes of another tree and destroy them later.
+// When Pool::transferable is true nodes need no adopting at all: any pool
+// may destroy a node created by any other. Pool::concurrent says create()
+// and destroy() may be called from several threads at once.
+//
+// A policy also names the link types stored inside the nodes. Link<Node>
+// converts to and from Node* and is dereferenced like one; TaggedLink<Node>
+// is a link with one spare bit for a flag (get/set, tag/setTag).
+
+// Pointer links. Nodes are at least pointer-aligned, so the low bit of an
+// address is always zero and can hold the tag.
+template <typename Node>
+class TaggedPointer {
+public:
+    TaggedPointer() : bits(0) {}
+
+    Node* get() const { return reinterpret_cast<Node*>(bits & ~kTagBit); }
+    unsigned tag() const { return static_cast<unsigned>(bits & kTagBit); }
+    void set(Node* node) { bits = reinterpret_cast<std::uintptr_t>(node) | (bits & kTagBit); }
+    void setTag(unsigned tag) { bits = (bits & ~kTagBit) | tag; }
+
+private:
+    static constexpr std::uintptr_t kTagBit = 1;
+    std::uintptr_t bits;
+};
+
+// One operator new / delete per node.
+struct HeapNodes {
+    template <typename Node>
+    using Link = Node*;
+    template <typename Node>
+    using TaggedLink = TaggedPointer<Node>;
+
+    template <typename Node>
+    class Pool {
+    public:
+        static constexpr bool bulkRelease = false;
+        static constexpr bool transferable = true;
+        static constexpr bool concurrent = true;
+
+        template <typename... Args>
+        Node* create(Args&&... args) {
+            return new Node(std::forward<Args>(args)...);
+        }
+
+        void destroy(Node* node) {
+            delete node;
+        }
+
+        void releaseAll() {}
+
+        void adopt(Pool&) {}
+    };
+};
+
+// Nodes carved out of fixed-size slabs with an intrusive free list.
+// With HugePages the slabs are 2 MiB multiples mapped with MAP_HUGETLB,
+// falling back to transparent huge pages when none are reserved.
+template <std::size_t SlabBytes = 64 * 1024, bool HugePages = false>
+struct SlabNodes {
+    template <typename Node>
+    using Link = Node*;
+    template <typename Node>
+    using TaggedLink = TaggedPointer<Node>;
+
+    template <typename Node>
+    class Pool {
+    public:
+        static constexpr bool bulkRelease = true;
+        static constexpr bool transferable = false;
+        static constexpr bool concurrent = false;
+
+        Pool() : slabs(nullptr), nextSlab(nullptr), cur(nullptr), end(nullptr), freeList(nullptr) {}
+        ~Pool();
+
+        Pool(const Pool&) = delete;
+        Pool& operator=(const Pool&) = delete;
+
+        template <typename... Args>
+        Node* create(Args&&... args) {
+            return new (allocate()) Node(std::forward<Args>(args)...);
+        }
+
+        void destroy(Node* node) {
+            node->~Node();
+            Slot* slot = reinterpret_cast<Slot*>(node);
+            slot->next = freeList;
+            freeList = slot;
+        }
+
+        // Forgets every node; the slabs are kept and refilled from the start.
+        void releaseAll() {
+            freeList = nullptr;
+            nextSlab = slabs;
+            cur = end = nullptr;
+        }
+
+        void adopt(Pool& other);
+
+    private:
+        union Slot {
+            Slot* next;
+            alignas(Node) unsigned char storage[sizeof(Node)];
+        };
+
+        struct Slab {
+            Slab* next;
+            std::size_t bytes;
+            bool mapped;
+        };
+
+        static constexpr std::size_t kHugePage = std::size_t(2) << 20;
+        static constexpr std::size_t kFirstSlot = (sizeof(Slab) + alignof(Slot) - 1) / alignof(Slot) * alignof(Slot);
+        static constexpr std::size_t kMinBytes = SlabBytes > kFirstSlot + sizeof(Slot) ? SlabBytes : kFirstSlot + sizeof(Slot);
+        static constexpr std::size_t kSlabBytes = HugePages ? (kMinBytes + kHugePage - 1) / kHugePage * kHugePage : kMinBytes;
+
+        static_assert(alignof(Slot) <= alignof(std::max_align_t), "over-aligned nodes are not supported");
+
+        Slab* slabs;
+        Slab* nextSlab;
+        Slot* cur;
+        Slot* end;
+        Slot* freeList;
+
+        void* allocate();
+        void useSlab(Slab* slab);
+        static Slab* mapSlab();
+        static void unmapSlab(Slab* slab);
+    };
+};
+
+
+template <std::size_t SlabBytes, bool HugePages>
+template <typename Node>
+SlabNodes<SlabBytes, HugePages>::Pool<Node>::~Pool() {
+    while (slabs) {
+        Slab* next = slabs->next;
+        unmapSlab(slabs);
+        slabs = next;
+    }
+}
+
+// Moves the slabs in use by other to the front of this pool's list, and
+// its free slots onto this free list; slabs other holds only for reuse
+// after releaseAll() are returned to the system.
+template <std::size_t SlabBytes, bool HugePages>
+template <typename Node>
+void SlabNodes<SlabBytes, HugePages>::Pool<Node>::adopt(Pool& other) {
+    if (&other == this) {
+        return;
+    }
+
+    while (other.freeList) {
+        Slot* slot = other.freeList;
+        other.freeList = slot->next;
+        slot->next = freeList;
+        freeList = slot;
+    }
+    for (Slot* slot = other.cur; slot != other.end; ++slot) {
+        slot->next = freeList;
+        freeList = slot;
+    }
+
+    Slab** tail = &other.slabs;
+    while (*tail != other.nextSlab) {
+        tail = &(*tail)->next;
+    }
+    while (other.nextSlab) {
+        Slab* next = other.nextSlab->next;
+        unmapSlab(other.nextSlab);
+        other.nextSlab = next;
+    }
+    *tail = nullptr;
+
+    if (other.slabs) {
+        *tail = slabs;
+        slabs = other.slabs;
+    }
+    other.slabs = nullptr;
+    other.cur = other.end = nullptr;
+}
+
+template <std::size_t SlabBytes, bool HugePages>
+template <typename Node>
+void* SlabNodes<SlabBytes, HugePages>::Pool<Node>::allocate() {
+    if (freeList) {
+        Slot* slot = freeList;
+        freeList = slot->next;
+        return slot;
+    }
+
+    if (cur == end) {
+        if (nextSlab) {
+            useSlab(nextSlab);
+            nextSlab = nextSlab->next;
+        }
+        else {
+            Slab* slab = mapSlab();
+            slab->next = slabs;
+            slabs = slab;
+            useSlab(slab);
+        }
+    }
+    return cur++;
+}
+
+template <std::size_t SlabBytes, bool HugePages>
+template <typename Node>
+void SlabNodes<SlabBytes, HugePages>::Pool<Node>::useSlab(Slab* slab) {
+    char* base = reinterpret_cast<char*>(slab);
+    cur = reinterpret_cast<Slot*>(base + kFirstSlot);
+    end = cur + (slab->bytes - kFirstSlot) / sizeof(Slot);
+}
+
+template <std::size_t SlabBytes, bool HugePages>
+template <typename Node>
+typename SlabNodes<SlabBytes, HugePages>::template Pool<Node>::Slab*
+SlabNodes<SlabBytes, HugePages>::Pool<Node>::mapSlab() {
+    void* memory = nullptr;
+    bool mapped = false;
+
+#ifdef __linux__
+    if constexpr (HugePages) {
+        memory = mmap(nullptr, kSlabBytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (memory == MAP_FAILED) {
+            memory = mmap(nullptr, kSlabBytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (memory == MAP_FAILED) {
+                throw std::bad_alloc();
+            }
+            madvise(memory, kSlabBytes, MADV_HUGEPAGE);
+        }
+        mapped = true;
+    }
+#endif
+
+    if (!mapped) {
+        memory = ::operator new(kSlabBytes);
+    }
+
+    Slab* slab = static_cast<Slab*>(memory);
+    slab->next = nullptr;
+    slab->bytes = kSlabBytes;
+    slab->mapped = mapped;
+    return slab;
+}
+
+template <std::size_t SlabBytes, bool HugePages>
+template <typename Node>
+void SlabNodes<SlabBytes, HugePages>::Pool<Node>::unmapSlab(Slab* slab) {
+#ifdef __linux__
+    if (slab->mapped) {
+        munmap(slab, slab->bytes);
+        return;
+    }
+#endif
+    ::operator delete(slab);
+}
+
+
+#ifdef __linux__
+constexpr std::size_t kIndexedMaxNodes = (std::size_t(1) << 31) - 1;
+#else
+constexpr std::size_t kIndexedMaxNodes = std::size_t(1) << 22;
+#endif
+
+// Nodes addressed by 32-bit slot indices instead of pointers, halving the
+// links on 64-bit targets.
+//
+// All nodes of one node type share a process-wide arena. The arena reserves
+// room for MaxNodes slots up front (address space only on Linux, memory
+// elsewhere) and commits it as pools ask for chunks, so a node never moves
+// and an index turns into an address with one multiply-add. Slot 0 is never
+// handed out: index 0 is the null link. A pool takes whole chunks of
+// ChunkNodes slots, which keeps each tree's nodes close together.
+template <std::size_t ChunkNodes = 4096, std::size_t MaxNodes = kIndexedMaxNodes>
+struct IndexedNodes {
+    static_assert(MaxNodes < (std::size_t(1) << 31), "tagged links keep 31 bits for the index");
+
+    // Bytes in chunks currently owned by pools, over all node types.
+    static std::size_t heldBytes() { return held.load(std::memory_order_relaxed); }
+
+    template <typename Node>
+    class Arena {
+    public:
+        static Arena& instance() {
+            static Arena arena;
+            return arena;
+        }
+
+        static Node* at(std::uint32_t index) { return index ? base + index : nullptr; }
+        static std::uint32_t indexOf(const Node* node) { return node ? static_cast<std::uint32_t>(node - base) : 0; }
+
+        // First slot of an unused chunk; chunks given back are reused first.
+        std::uint32_t takeChunk();
+        void giveBack(const std::uint32_t* chunks, std::size_t count);
+
+    private:
+        static constexpr std::size_t kCommitBytes = std::size_t(64) << 10;
+
+        Arena();
+        ~Arena();
+
+        static inline Node* base = nullptr;
+
+        std::mutex lock;
+        std::vector<std::uint32_t> spare;
+        std::size_t chunkCount = 0;
+        std::size_t committedBytes = 0;
+    };
+
+    template <typename Node>
+    class Link {
+    public:
+        Link() = default;
+        Link(std::nullptr_t) : index(0) {}
+        Link(Node* node) : index(Arena<Node>::indexOf(node)) {}
+
+        operator Node*() const { return Arena<Node>::at(index); }
+        Node* operator->() const { return Arena<Node>::at(index); }
+        Node& operator*() const { return *Arena<Node>::at(index); }
+
+    private:
+        std::uint32_t index;
+    };
+
+    template <typename Node>
+    class TaggedLink {
+    public:
+        TaggedLink() : bits(0) {}
+
+        Node* get() const { return Arena<Node>::at(bits >> 1); }
+        unsigned tag() const { return bits & 1u; }
+        void set(Node* node) { bits = (Arena<Node>::indexOf(node) << 1) | (bits & 1u); }
+        void setTag(unsigned tag) { bits = (bits & ~1u) | tag; }
+
+    private:
+        std::uint32_t bits;
+    };
+
+    template <typename Node>
+    class Pool {
+    public:
+        static constexpr bool bulkRelease = true;
+        static constexpr bool transferable = false;
+        static constexpr bool concurrent = false;
+
+        Pool() : arena(Arena<Node>::instance()), nextChunk(0), cur(0), end(0), freeList(0) {}
+        ~Pool() { arena.giveBack(chunks.data(), chunks.size()); }
+
+        Pool(const Pool&) = delete;
+        Pool& operator=(const Pool&) = delete;
+
+        template <typename... Args>
+        Node* create(Args&&... args) {
+            return new (allocate()) Node(std::forward<Args>(args)...);
+        }
+
+        void destroy(Node* node) {
+            node->~Node();
+            std::memcpy(static_cast<void*>(node), &freeList, sizeof(freeList));
+            freeList = Arena<Node>::indexOf(node);
+        }
+
+        // Forgets every node; the chunks are kept and refilled from the start.
+        void releaseAll() {
+            freeList = 0;
+            nextChunk = 0;
+            cur = end = 0;
+        }
+
+        void adopt(Pool& other);
+
+    private:
+        static_assert(sizeof(Node) >= sizeof(std::uint32_t), "free slots hold the next free index");
+
+        Arena<Node>& arena;
+        std::vector<std::uint32_t> chunks;  // first slots; [0, nextChunk) in use, the rest kept for reuse
+        std::size_t nextChunk;
+        std::uint32_t cur;
+        std::uint32_t end;
+        std::uint32_t freeList;
+
+        void* allocate();
+        void pushFree(std::uint32_t index);
+    };
+
+private:
+    static inline std::atomic<std::size_t> held{ 0 };
+};
+
+
+template <std::size_t ChunkNodes, std::size_t MaxNodes>
+template <typename Node>
+IndexedNodes<ChunkNodes, MaxNodes>::Arena<Node>::Arena() {
+    std::size_t bytes = (MaxNodes + 1) * sizeof(Node);
+#ifdef __linux__
+    void* memory = mmap(nullptr, bytes, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (memory == MAP_FAILED) {
+        throw std::bad_alloc();
+    }
+#else
+    void* memory = ::operator new(bytes);
+#endif
+    base = static_cast<Node*>(memory);
+}
+
+template <std::size_t ChunkNodes, std::size_t MaxNodes>
+template <typename Node>
+IndexedNodes<ChunkNodes, MaxNodes>::Arena<Node>::~Arena() {
+#ifdef __linux__
+    munmap(base, (MaxNodes + 1) * sizeof(Node));
+#else
+    ::operator delete(base);
+#endif
+}
+
+template <std::size_t ChunkNodes, std::size_t MaxNodes>
+template <typename Node>
+std::uint32_t IndexedNodes<ChunkNodes, MaxNodes>::Arena<Node>::takeChunk() {
+    std::lock_guard<std::mutex> guard(lock);
+    if (!spare.empty()) {
+        std::uint32_t first = spare.back();
+        spare.pop_back();
+        held.fetch_add(ChunkNodes * sizeof(Node), std::memory_order_relaxed);
+        return first;
+    }
+
+    if ((chunkCount + 1) * ChunkNodes > MaxNodes) {
+        throw std::bad_alloc();
+    }
+    std::size_t first = 1 + chunkCount * ChunkNodes;
+    std::size_t needed = (first + ChunkNodes) * sizeof(Node);
+#ifdef __linux__
+    if (needed > committedBytes) {
+        std::size_t grown = (needed + kCommitBytes - 1) / kCommitBytes * kCommitBytes;
+        if (mprotect(base, grown, PROT_READ | PROT_WRITE) != 0) {
+            throw std::bad_alloc();
+        }
+        committedBytes = grown;
+    }
+#endif
+    chunkCount++;
+    held.fetch_add(ChunkNodes * sizeof(Node), std::memory_order_relaxed);
+    return static_cast<std::uint32_t>(first);
+}
+
+template <std::size_t ChunkNodes, std::size_t MaxNodes>
+template <typename Node>
+void IndexedNodes<ChunkNodes, MaxNodes>::Arena<Node>::giveBack(const std::uint32_t* chunks, std::size_t count) {
+    std::lock_guard<std::mutex> guard(lock);
+    held.fetch_sub(count * ChunkNodes * sizeof(Node), std::memory_order_relaxed);
+    spare.insert(spare.end(), chunks, chunks + count);
+}
+
+template <std::size_t ChunkNodes, std::size_t MaxNodes>
+template <typename Node>
+void IndexedNodes<ChunkNodes, MaxNodes>::Pool<Node>::pushFree(std::uint32_t index) {
+    std::memcpy(static_cast<void*>(Arena<Node>::at(index)), &freeList, sizeof(freeList));
+    freeList = index;
+}
+
+template <std::size_t ChunkNodes, std::size_t MaxNodes>
+template <typename Node>
+void* IndexedNodes<ChunkNodes, MaxNodes>::Pool<Node>::allocate() {
+    if (freeList) {
+        Node* slot = Arena<Node>::at(freeList);
+        std::memcpy(&freeList, static_cast<const void*>(slot), sizeof(freeList));
+        return slot;
+    }
+
+    if (cur == end) {
+        if (nextChunk == chunks.size()) {
+            chunks.reserve(chunks.size() + 1);
+            chunks.push_back(arena.takeChunk());
+        }
+        cur = chunks[nextChunk++];
+        end = cur + static_cast<std::uint32_t>(ChunkNodes);
+    }
+    return Arena<Node>::at(cur++);
+}
+
+// Same contract as SlabNodes::Pool::adopt(): other's chunks in use join
+// ours, its free slots join our free list, its spare chunks go back to the
+// arena.
+template <std::size_t ChunkNodes, std::size_t MaxNodes>
+template <typename Node>
+void IndexedNodes<ChunkNodes, MaxNodes>::Pool<Node>::adopt(Pool& other) {
+    if (&other == this) {
+        return;
+    }
+
+    while (other.freeList) {
+        std::uint32_t index = other.freeList;
+        std::memcpy(&other.freeList, static_cast<const void*>(Arena<Node>::at(index)), sizeof(other.freeList));
+        pushFree(index);
+    }
+    for (; other.cur != other.end; other.cur++) {
+        pushFree(other.cur);
+    }
+
+    arena.giveBack(other.chunks.data() + other.nextChunk, other.chunks.size() - other.nextChunk);
+    chunks.insert(chunks.begin() + nextChunk, other.chunks.begin(), other.chunks.begin() + other.nextChunk);
+    nextChunk += other.nextChunk;
+
+    other.chunks.clear();
+    other.nextChunk = 0;
+    other.cur = other.end = 0;
+}
+
+
+// Frees every node of a binary tree through pool.destroy() in O(n) without
+// a stack: rotates left children up until the node has none, then frees it
+// and moves right, so even a degenerate tree needs no extra memory.
+// child(node, dir) and setChild(node, dir, next) read and write the links,
+// dir 0 being the left one.
+template <typename Pool, typename Node, typename Child, typename SetChild>
+void destroyNodes(Pool& pool, Node* node, Child child, SetChild setChild) {
+    while (node != nullptr) {
+        Node* left = child(node, 0);
+        if (left != nullptr) {
+            setChild(node, 0, child(left, 1));
+            setChild(left, 1, node);
+            node = left;
+        }
+        else {
+            Node* right = child(node, 1);
+            pool.destroy(node);
+            node = right;
+        }
+    }
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <cstddef>
+
+// Node augmentation policies for AVLTree and RBTree. Each policy's Field is
+// a base of the tree's Node. SubtreeSize keeps the size of every subtree,
+// which makes rank(), select() and count_range() O(log n); NoAugment adds
+// nothing to the node.
+struct NoAugment {
+    static constexpr bool enabled = false;
+    struct Field {};
+};
+
+struct SubtreeSize {
+    static constexpr bool enabled = true;
+    struct Field {
+        std::size_t size = 1;
+    };
+};
@@ -0,0 +1,608 @@
+﻿#pragma once
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <cmath>
+#include <cstddef>
+#include <iterator>
+#include <type_traits>
+#include <utility>
+#include <stdexcept>
+
+#include "Laba2_Alloc.h"
+#include "Laba2_Bulk.h"
+#include "Laba2_Display.h"
+#include "Laba2_Frozen.h"
+#include "Laba2_Prefetch.h"
+
+template <typename T, typename Alloc = HeapNodes>
+class BST {
+private:
+    struct Node {
+        T data;
+        Node* left;
+        Node* right;
+
+        Node(const T& value) : data(value), left(nullptr), right(nullptr) {}
+        Node(T&& value) : data(std::move(value)), left(nullptr), right(nullptr) {}
+    };
+
+    using NodePool = typename Alloc::template Pool<Node>;
+    static constexpr bool bulkClear = NodePool::bulkRelease && std::is_trivially_destructible<T>::value;
+
+    Node* root;
+    std::size_t nodeCount;
+    NodePool pool;
+
+    // Rebalancing mode: alpha is 0 when it is off. maxCount is the largest
+    // size since the last full rebuild.
+    double alpha;
+    double logInvAlpha;
+    std::size_t maxCount;
+
+public:
+    BST() : root(nullptr), nodeCount(0), alpha(0.0), logInvAlpha(0.0), maxCount(0) {}
+    ~BST() { clear(); }
+
+    template <typename It>
+    BST(It first, It last, unsigned threads = 1) : BST() { assign(first, last, threads); }
+    template <typename It>
+    BST(SortedUnique, It first, It last) : BST() { assign(sortedUnique, first, last); }
+
+    // Bytes allocated per element, before allocator overhead.
+    static constexpr std::size_t nodeBytes = sizeof(Node);
+
+private:
+   
+    static constexpr std::size_t kBatchLanes = 16;
+
+    static std::size_t countNodes(const Node* node);
+    static std::size_t flatten(Node** link);
+    static void compress(Node** link, std::size_t count);
+    static void rebuild(Node** link);
+    void rebuildScapegoat(const T& value);
+    template <typename It>
+    Node* build(It& it, std::size_t n);
+    template <typename Key, typename F>
+    void lookupBatch(const Key* keys, std::size_t n, F done) const;
+    void inorder(Node* node) const;
+    void preorder(Node* node) const;
+    void postorder(Node* node) const;
+
+    
+    int getHeight(Node* node) const;
+    void collectLevelData(Node* node, int level, std::vector<std::vector<std::string>>& levels, int pos, int width) const;
+
+public:
+   
+    void insert(const T& value);
+    void remove(const T& value);
+    bool search(const T& value) const;
+
+    // Many independent lookups at once; out[i] answers keys[i]. Up to
+    // kBatchLanes descents are in flight together: each step moves one of
+    // them down a level and prefetches the node it lands on, then turns to
+    // the next, so the cache misses of different keys overlap.
+    void contains_batch(const T* keys, std::size_t n, bool* out) const;
+    // Pointers to the matching elements, nullptr for keys not present.
+    void find_batch(const T* keys, std::size_t n, const T** out) const;
+    void clear();
+    std::size_t size() const { return nodeCount; }
+    int getTreeHeight() const { return getHeight(root); }
+
+    // Scapegoat mode (Galperin, Rivest): an insert that lands deeper than
+    // log(n) / log(1 / alpha) rebuilds the subtree of the lowest ancestor
+    // whose one child holds more than alpha of its nodes, and removes
+    // rebuild the whole tree once it has shrunk below alpha of its largest
+    // size. Operations are then O(log n) amortized with nothing stored in
+    // the nodes. alpha must be in [0.55, 1); smaller is more balanced and
+    // rebuilds more often. Enabling the mode rebuilds the tree first.
+    void enableRebalance(double alpha = 0.7);
+    void disableRebalance() { alpha = 0.0; }
+    // Rebuilds the tree perfectly balanced, in place (Day-Stout-Warren).
+    void rebalance();
+
+    template <typename It>
+    void assign(It first, It last, unsigned threads = 1);
+    template <typename It>
+    void assign(SortedUnique, It first, It last);
+    // Read-only copy of the current contents in a cache-friendly layout.
+    FrozenSet<T> freeze() const;
+
+    void displayInorder() const;
+    void displayPreorder() const;
+    void displayPostorder() const;
+
+    
+    void displayTree() const;
+    
+};
+
+
+template <typename T, typename Alloc>
+void BST<T, Alloc>::insert(const T& value) {
+    Node** link = &root;
+    std::size_t depth = 0;
+    while (*link != nullptr) {
+        Node* node = *link;
+        if (value < node->data) {
+            link = &node->left;
+        }
+        else if (value > node->data) {
+            link = &node->right;
+        }
+        else {
+            return;
+        }
+        depth++;
+    }
+    *link = pool.create(value);
+    nodeCount++;
+
+    if (alpha > 0.0) {
+        if (nodeCount > maxCount) {
+            maxCount = nodeCount;
+        }
+        if (depth > std::log(static_cast<double>(nodeCount)) / logInvAlpha) {
+            rebuildScapegoat(value);
+        }
+    }
+}
+
+
+template <typename T, typename Alloc>
+bool BST<T, Alloc>::search(const T& value) const {
+    Node* node = root;
+    while (node != nullptr) {
+        if (value < node->data) {
+            node = node->left;
+        }
+        else if (value > node->data) {
+            node = node->right;
+        }
+        else {
+            return true;
+        }
+    }
+    return false;
+}
+
+
+// A lane holds one lookup in progress. A lane that finishes takes the next
+// key, so short and long descents share the lanes without waiting.
+template <typename T, typename Alloc>
+template <typename Key, typename F>
+void BST<T, Alloc>::lookupBatch(const Key* keys, std::size_t n, F done) const {
+    const Node* top = root;
+    if (top == nullptr) {
+        for (std::size_t i = 0; i < n; i++) {
+            done(i, nullptr);
+        }
+        return;
+    }
+
+    struct Lane {
+        const Node* node;
+        std::size_t index;
+    };
+    Lane lanes[kBatchLanes];
+    std::size_t active = 0;
+    std::size_t next = 0;
+    while (active < kBatchLanes && next < n) {
+        lanes[active++] = { top, next++ };
+    }
+
+    while (active > 0) {
+        for (std::size_t j = 0; j < active;) {
+            Lane& lane = lanes[j];
+            const Node* node = lane.node;
+            const Key& key = keys[lane.index];
+
+            bool less = key < node->data;
+            if (less || key > node->data) {
+                node = less ? node->left : node->right;
+                if (node != nullptr) {
+                    prefetchRead(node);
+                    lane.node = node;
+                    j++;
+                    continue;
+                }
+                done(lane.index, nullptr);
+            }
+            else {
+                done(lane.index, node);
+            }
+
+            if (next < n) {
+                lane = { top, next++ };
+                j++;
+            }
+            else {
+                lane = lanes[--active];
+            }
+        }
+    }
+}
+
+template <typename T, typename Alloc>
+void BST<T, Alloc>::contains_batch(const T* keys, std::size_t n, bool* out) const {
+    lookupBatch(keys, n, [out](std::size_t i, const Node* node) { out[i] = node != nullptr; });
+}
+
+template <typename T, typename Alloc>
+void BST<T, Alloc>::find_batch(const T* keys, std::size_t n, const T** out) const {
+    lookupBatch(keys, n, [out](std::size_t i, const Node* node) { out[i] = node ? &node->data : nullptr; });
+}
+
+
+template <typename T, typename Alloc>
+FrozenSet<T> BST<T, Alloc>::freeze() const {
+    std::vector<T> values;
+    std::vector<const Node*> path;
+    const Node* node = root;
+    while (node != nullptr || !path.empty()) {
+        if (node != nullptr) {
+            path.push_back(node);
+            node = node->left;
+        }
+        else {
+            node = path.back();
+            path.pop_back();
+            values.push_back(node->data);
+            node = node->right;
+        }
+    }
+    return FrozenSet<T>(sortedUnique, std::make_move_iterator(values.begin()), values.size());
+}
+
+
+// Builds a perfectly balanced subtree from the next n sorted values of it.
+template <typename T, typename Alloc>
+template <typename It>
+typename BST<T, Alloc>::Node* BST<T, Alloc>::build(It& it, std::size_t n) {
+    if (n == 0) {
+        return nullptr;
+    }
+
+    std::size_t leftSize = (n - 1) / 2;
+    Node* left = build(it, leftSize);
+    Node* node = pool.create(*it);
+    ++it;
+    node->left = left;
+    node->right = build(it, n - 1 - leftSize);
+    return node;
+}
+
+template <typename T, typename Alloc>
+template <typename It>
+void BST<T, Alloc>::assign(It first, It last, unsigned threads) {
+    std::vector<T> values(first, last);
+    sortUnique(values, threads);
+    assign(sortedUnique, std::make_move_iterator(values.begin()), std::make_move_iterator(values.end()));
+}
+
+template <typename T, typename Alloc>
+template <typename It>
+void BST<T, Alloc>::assign(SortedUnique, It first, It last) {
+    clear();
+    nodeCount = static_cast<std::size_t>(std::distance(first, last));
+    maxCount = nodeCount;
+    root = build(first, nodeCount);
+}
+
+
+template <typename T, typename Alloc>
+void BST<T, Alloc>::remove(const T& value) {
+    Node** link = &root;
+    while (*link != nullptr) {
+        Node* node = *link;
+        if (value < node->data) {
+            link = &node->left;
+        }
+        else if (value > node->data) {
+            link = &node->right;
+        }
+        else {
+            break;
+        }
+    }
+
+    Node* node = *link;
+    if (node == nullptr) {
+        return;
+    }
+
+    if (node->left == nullptr) {
+        *link = node->right;
+        pool.destroy(node);
+    }
+    else if (node->right == nullptr) {
+        *link = node->left;
+        pool.destroy(node);
+    }
+    else {
+        Node** minLink = &node->right;
+        while ((*minLink)->left != nullptr) {
+            minLink = &(*minLink)->left;
+        }
+        Node* temp = *minLink;
+        node->data = std::move(temp->data);
+        *minLink = temp->right;
+        pool.destroy(temp);
+    }
+    nodeCount--;
+
+    if (alpha > 0.0 && nodeCount < alpha * maxCount) {
+        rebalance();
+    }
+}
+
+
+template <typename T, typename Alloc>
+void BST<T, Alloc>::inorder(Node* node) const {
+    std::vector<Node*> stack;
+    while (node != nullptr || !stack.empty()) {
+        while (node != nullptr) {
+            stack.push_back(node);
+            node = node->left;
+        }
+        node = stack.back();
+        stack.pop_back();
+        std::cout << node->data << " ";
+        node = node->right;
+    }
+}
+
+template <typename T, typename Alloc>
+void BST<T, Alloc>::preorder(Node* node) const {
+    std::vector<Node*> stack;
+    if (node != nullptr) {
+        stack.push_back(node);
+    }
+    while (!stack.empty()) {
+        node = stack.back();
+        stack.pop_back();
+        std::cout << node->data << " ";
+        if (node->right != nullptr) {
+            stack.push_back(node->right);
+        }
+        if (node->left != nullptr) {
+            stack.push_back(node->left);
+        }
+    }
+}
+
+template <typename T, typename Alloc>
+void BST<T, Alloc>::postorder(Node* node) const {
+    std::vector<Node*> stack;
+    Node* last = nullptr;
+    while (node != nullptr || !stack.empty()) {
+        while (node != nullptr) {
+            stack.push_back(node);
+            node = node->left;
+        }
+        Node* top = stack.back();
+        if (top->right != nullptr && top->right != last) {
+            node = top->right;
+        }
+        else {
+            std::cout << top->data << " ";
+            last = top;
+            stack.pop_back();
+        }
+    }
+}
+
+template <typename T, typename Alloc>
+void BST<T, Alloc>::displayInorder() const {
+    std::cout << "Inorder traversal: ";
+    inorder(root);
+    std::cout << std::endl;
+}
+
+template <typename T, typename Alloc>
+void BST<T, Alloc>::displayPreorder() const {
+    std::cout << "Preorder traversal: ";
+    preorder(root);
+    std::cout << std::endl;
+}
+
+template <typename T, typename Alloc>
+void BST<T, Alloc>::displayPostorder() const {
+    std::cout << "Postorder traversal: ";
+    postorder(root);
+    std::cout << std::endl;
+}
+
+
+template <typename T, typename Alloc>
+void BST<T, Alloc>::clear() {
+    if constexpr (bulkClear) {
+        pool.releaseAll();
+    }
+    else {
+        destroyNodes(pool, root,
+            [](Node* node, int dir) { return dir ? node->right : node->left; },
+            [](Node* node, int dir, Node* child) { (dir ? node->right : node->left) = child; });
+    }
+    root = nullptr;
+    nodeCount = 0;
+    maxCount = 0;
+}
+
+
+template <typename T, typename Alloc>
+void BST<T, Alloc>::enableRebalance(double alpha) {
+    if (!(alpha >= 0.55 && alpha < 1.0)) {
+        throw std::invalid_argument("BST::enableRebalance: alpha must be in [0.55, 1)");
+    }
+    this->alpha = alpha;
+    logInvAlpha = std::log(1.0 / alpha);
+    rebalance();
+}
+
+template <typename T, typename Alloc>
+void BST<T, Alloc>::rebalance() {
+    rebuild(&root);
+    maxCount = nodeCount;
+}
+
+template <typename T, typename Alloc>
+std::size_t BST<T, Alloc>::countNodes(const Node* node) {
+    std::size_t count = 0;
+    std::vector<const Node*> stack;
+    while (node != nullptr || !stack.empty()) {
+        if (node == nullptr) {
+            node = stack.back();
+            stack.pop_back();
+        }
+        count++;
+        if (node->right != nullptr) {
+            stack.push_back(node->right);
+        }
+        node = node->left;
+    }
+    return count;
+}
+
+// Turns the subtree at link into a "vine" of right links in sorted order by
+// rotating left children up, and returns its size.
+template <typename T, typename Alloc>
+std::size_t BST<T, Alloc>::flatten(Node** link) {
+    std::size_t count = 0;
+    while (*link != nullptr) {
+        Node* node = *link;
+        if (node->left != nullptr) {
+            Node* left = node->left;
+            node->left = left->right;
+            left->right = node;
+            *link = left;
+        }
+        else {
+            count++;
+            link = &node->right;
+        }
+    }
+    return count;
+}
+
+// Rotates every second node of the vine's first 2 * count nodes left, so
+// they become left children of the nodes after them.
+template <typename T, typename Alloc>
+void BST<T, Alloc>::compress(Node** link, std::size_t count) {
+    for (std::size_t i = 0; i < count; i++) {
+        Node* node = *link;
+        Node* up = node->right;
+        node->right = up->left;
+        up->left = node;
+        *link = up;
+        link = &up->right;
+    }
+}
+
+// Day-Stout-Warren: flatten, fill the bottom level with the spare nodes,
+// then halve the vine until it is a complete tree. No memory is allocated.
+template <typename T, typename Alloc>
+void BST<T, Alloc>::rebuild(Node** link) {
+    std::size_t n = flatten(link);
+    std::size_t full = 1;
+    while (full <= n) {
+        full = 2 * full + 1;
+    }
+    full /= 2;
+    compress(link, n - full);
+    while (full > 1) {
+        full /= 2;
+        compress(link, full);
+    }
+}
+
+// value was just inserted too deep. Walks back up its path, summing subtree
+// sizes, and rebuilds below the first ancestor that is out of balance.
+template <typename T, typename Alloc>
+void BST<T, Alloc>::rebuildScapegoat(const T& value) {
+    std::vector<Node**> path;
+    Node** link = &root;
+    while (*link != nullptr) {
+        path.push_back(link);
+        Node* node = *link;
+        if (value < node->data) {
+            link = &node->left;
+        }
+        else if (value > node->data) {
+            link = &node->right;
+        }
+        else {
+            break;
+        }
+    }
+
+    std::size_t size = 1;
+    for (std::size_t i = path.size() - 1; i-- > 0;) {
+        Node* parent = *path[i];
+        Node* child = *path[i + 1];
+        std::size_t parentSize = size + 1 + countNodes(parent->left == child ? parent->right : parent->left);
+        if (size > alpha * parentSize) {
+            rebuild(path[i]);
+            return;
+        }
+        size = parentSize;
+    }
+}
+
+
+template <typename T, typename Alloc>
+int BST<T, Alloc>::getHeight(Node* node) const {
+    std::vector<Node*> level;
+    std::vector<Node*> next;
+    if (node != nullptr) {
+        level.push_back(node);
+    }
+    int height = 0;
+    while (!level.empty()) {
+        height++;
+        next.clear();
+        for (Node* n : level) {
+            if (n->left != nullptr) {
+                next.push_back(n->left);
+            }
+            if (n->right != nullptr) {
+                next.push_back(n->right);
+            }
+        }
+        level.swap(next);
+    }
+    return height;
+}
+
+
+template <typename T, typename Alloc>
+void BST<T, Alloc>::displayTree() const {
+    std::cout << "\nДерево (вертикальный вид):\n";
+    std::cout << "==========================\n";
+    printSideways(root, 0, 0, true);
+    std::cout << "==========================\n";
+}
+
+template <typename T, typename Alloc>
+void BST<T, Alloc>::collectLevelData(Node* node, int level,
+    std::vector<std::vector<std::string>>& levels,
+    int pos, int width) const {
+    if (node == nullptr || level >= levels.size()) {
+        return;
+    }
+
+    
+    std::string value = std::to_string(node->data);
+    if (value.length() == 1) value = " " + value;
+    levels[level][pos] = value;
+
+    
+    if (node->left != nullptr) {
+        collectLevelData(node->left, level + 1, levels, pos - width / 2 - 1, width / 2);
+    }
+    if (node->right != nullptr) {
+        collectLevelData(node->right, level + 1, levels, pos + width / 2 + 1, width / 2);
+    }
+}
@@ -0,0 +1,514 @@
+#include "Laba2_BST.h"
+#include "Laba2_AVL.h"
+#include "Laba2_RBT.h"
+#include "Laba2_ConcurrentRBT.h"
+#include "Laba2_TopDownRBT.h"
+#include "Laba2_WAVL.h"
+#include "Laba2_Splay.h"
+#include "Laba2_PerfCounters.h"
+
+#include <set>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <new>
+#include <random>
+#include <sstream>
+
+// Benchmark driver for BST / AVLTree / RBTree / TopDownRBTree / WAVLTree /
+// SplayTree with std::set as the baseline.
+//
+//   Laba2_Bench [--sizes 1000,10000,...] [--engines bst,avl,rbt,avl-slab,...,set]
+//               [--workloads uniform,zipf,sorted,reverse,mixed,ttl]
+//               [--ops N] [--seed S] [--out results.json] [--full] [--counters]
+//
+// Results go to stdout (or --out) as JSON, progress goes to stderr.
+// --counters adds hardware event counts per operation to every phase
+// (Linux perf_event_open, see Laba2_PerfCounters.h). Latency samples are
+// not taken then, so their clock reads do not show up in the counts.
+
+namespace {
+
+using Key = std::uint64_t;
+using Clock = std::chrono::steady_clock;
+
+// Live heap bytes, tracked through the global operator new below.
+std::size_t g_liveBytes = 0;
+
+constexpr std::size_t kHeader = alignof(std::max_align_t);
+
+void* countedAlloc(std::size_t size) {
+    void* p = std::malloc(size + kHeader);
+    if (!p) {
+        throw std::bad_alloc();
+    }
+    *static_cast<std::size_t*>(p) = size;
+    g_liveBytes += size;
+    return static_cast<char*>(p) + kHeader;
+}
+
+void countedFree(void* ptr) {
+    if (!ptr) {
+        return;
+    }
+    void* p = static_cast<char*>(ptr) - kHeader;
+    g_liveBytes -= *static_cast<std::size_t*>(p);
+    std::free(p);
+}
+
+// Bijective 64-bit mix, so mix(0..n-1) gives n distinct keys in random order.
+Key mix(Key x) {
+    x += 0x9e3779b97f4a7c15ULL;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+
+// Zipfian ranks in [0, n), Gray et al. "Quickly generating billion-record
+// synthetic databases" (the YCSB generator).
+class Zipf {
+public:
+    Zipf(std::uint64_t n, double theta) : n(n), theta(theta) {
+        double zeta2 = 0.0;
+        zetan = 0.0;
+        for (std::uint64_t i = 1; i <= n; i++) {
+            zetan += 1.0 / std::pow(static_cast<double>(i), theta);
+            if (i == 2) {
+                zeta2 = zetan;
+            }
+        }
+        if (n < 2) {
+            zeta2 = zetan;
+        }
+        alpha = 1.0 / (1.0 - theta);
+        eta = (1.0 - std::pow(2.0 / n, 1.0 - theta)) / (1.0 - zeta2 / zetan);
+    }
+
+    template <typename Rng>
+    std::uint64_t operator()(Rng& rng) {
+        double u = std::uniform_real_distribution<double>(0.0, 1.0)(rng);
+        double uz = u * zetan;
+        if (uz < 1.0) return 0;
+        if (uz < 1.0 + std::pow(0.5, theta)) return 1 < n ? 1 : 0;
+        std::uint64_t r = static_cast<std::uint64_t>(n * std::pow(eta * u - eta + 1.0, alpha));
+        return r < n ? r : n - 1;
+    }
+
+private:
+    std::uint64_t n;
+    double theta;
+    double zetan;
+    double alpha;
+    double eta;
+};
+
+struct PhaseResult {
+    std::string name;
+    std::uint64_t ops = 0;
+    double seconds = 0.0;
+    double p50 = 0.0;
+    double p99 = 0.0;
+    // Hardware event totals by PerfCounters::Event; empty when not measured.
+    std::vector<double> counters;
+};
+
+// Runs op(i) for i in [0, ops), timing every stride-th call on its own to
+// collect latency samples without timing the whole loop call by call.
+// With perf the loop runs untimed inside the hardware counters instead.
+template <typename Op>
+PhaseResult runPhase(const std::string& name, std::uint64_t ops, PerfCounters* perf, Op op) {
+    const std::uint64_t kSamples = 100000;
+    std::uint64_t stride = ops / kSamples + 1;
+    std::vector<double> samples;
+    samples.reserve(static_cast<std::size_t>(ops / stride + 1));
+
+    if (perf) {
+        perf->start();
+    }
+    Clock::time_point start = Clock::now();
+    for (std::uint64_t i = 0; i < ops; i++) {
+        if (!perf && i % stride == 0) {
+            Clock::time_point t0 = Clock::now();
+            op(i);
+            Clock::time_point t1 = Clock::now();
+            samples.push_back(std::chrono::duration<double, std::nano>(t1 - t0).count());
+        }
+        else {
+            op(i);
+        }
+    }
+    Clock::time_point stop = Clock::now();
+    if (perf) {
+        perf->stop();
+    }
+
+    PhaseResult result;
+    result.name = name;
+    result.ops = ops;
+    result.seconds = std::chrono::duration<double>(stop - start).count();
+    if (perf) {
+        for (int e = 0; e < PerfCounters::EVENT_COUNT; e++) {
+            result.counters.push_back(perf->value(static_cast<PerfCounters::Event>(e)));
+        }
+    }
+    if (!samples.empty()) {
+        std::size_t p50 = samples.size() / 2;
+        std::size_t p99 = std::min(samples.size() - 1, samples.size() * 99 / 100);
+        std::nth_element(samples.begin(), samples.begin() + p50, samples.end());
+        result.p50 = samples[p50];
+        std::nth_element(samples.begin(), samples.begin() + p99, samples.end());
+        result.p99 = samples[p99];
+    }
+    return result;
+}
+
+// Uniform adapters over the engines under test.
+template <typename Tree>
+struct TreeEngine {
+    Tree tree;
+    void insert(Key k) { tree.insert(k); }
+    // Not const: a splay tree restructures itself on lookups.
+    bool search(Key k) { return tree.search(k); }
+    void remove(Key k) { tree.remove(k); }
+};
+
+// BST with scapegoat rebalancing turned on.
+struct ScapegoatEngine : TreeEngine<BST<Key>> {
+    ScapegoatEngine() { tree.enableRebalance(); }
+};
+
+struct SetEngine {
+    std::set<Key> tree;
+    void insert(Key k) { tree.insert(k); }
+    bool search(Key k) const { return tree.count(k) != 0; }
+    void remove(Key k) { tree.erase(k); }
+};
+
+struct Config {
+    std::vector<std::uint64_t> sizes{ 1000, 10000, 100000, 1000000 };
+    std::vector<std::string> engines{ "bst", "bst-scapegoat", "avl", "rbt", "bst-slab", "avl-slab", "rbt-slab", "avl-indexed", "rbt-indexed", "rbt-topdown", "rbt-topdown-indexed", "wavl", "wavl-indexed", "splay", "splay-every8", "splay-depth16", "rbt-concurrent", "set" };
+    std::vector<std::string> workloads{ "uniform", "zipf", "sorted", "reverse", "mixed", "ttl" };
+    std::uint64_t ops = 0;
+    std::uint64_t seed = 42;
+    std::string out;
+    bool counters = false;
+};
+
+// The plain BST (without scapegoat mode) turns into a list on sorted input,
+// so loads are O(n^2). Past this size the run is reported as skipped.
+const std::uint64_t kDegenerateLimit = 10000;
+
+struct RunResult {
+    std::vector<PhaseResult> phases;
+    double bytesPerKey = 0.0;
+    std::uint64_t hits = 0;
+};
+
+template <typename Engine>
+RunResult runWorkload(const std::string& workload, std::uint64_t n, std::uint64_t ops, std::uint64_t seed, PerfCounters* perf) {
+    RunResult result;
+    std::mt19937_64 rng(seed);
+    // IndexedNodes keeps its nodes outside operator new.
+    auto liveBytes = [] { return g_liveBytes + IndexedNodes<>::heldBytes(); };
+    std::size_t baseBytes = liveBytes();
+    Engine* engine = new Engine();
+    std::size_t engineBytes = liveBytes() - baseBytes;
+
+    if (workload == "sorted") {
+        result.phases.push_back(runPhase("load", n, perf, [&](std::uint64_t i) { engine->insert(i); }));
+    }
+    else if (workload == "reverse") {
+        result.phases.push_back(runPhase("load", n, perf, [&](std::uint64_t i) { engine->insert(n - 1 - i); }));
+    }
+    else {
+        result.phases.push_back(runPhase("load", n, perf, [&](std::uint64_t i) { engine->insert(mix(i)); }));
+    }
+    result.bytesPerKey = static_cast<double>(liveBytes() - baseBytes - engineBytes) / n;
+
+    bool scrambled = workload != "sorted" && workload != "reverse";
+    auto keyOf = [&](std::uint64_t i) { return scrambled ? mix(i) : i; };
+
+    std::uint64_t hits = 0;
+    if (workload == "zipf") {
+        Zipf zipf(n, 0.99);
+        std::vector<std::uint64_t> ranks(static_cast<std::size_t>(ops));
+        for (std::uint64_t& r : ranks) {
+            r = zipf(rng);
+        }
+        // Rank r maps to key mix(r), so hot keys are spread over the key space.
+        result.phases.push_back(runPhase("lookup", ops, perf, [&](std::uint64_t i) {
+            hits += engine->search(keyOf(ranks[i]));
+        }));
+    }
+    else if (workload == "mixed") {
+        // 50% search, 25% insert, 25% remove over a key space of 2n.
+        std::vector<std::uint64_t> draws(static_cast<std::size_t>(ops));
+        for (std::uint64_t& d : draws) {
+            d = rng();
+        }
+        result.phases.push_back(runPhase("mixed", ops, perf, [&](std::uint64_t i) {
+            std::uint64_t d = draws[i];
+            Key k = mix((d >> 2) % (2 * n));
+            switch (d & 3) {
+            case 0:
+                engine->insert(k);
+                break;
+            case 1:
+                engine->remove(k);
+                break;
+            default:
+                hits += engine->search(k);
+                break;
+            }
+        }));
+    }
+    else if (workload == "ttl") {
+        // Expiry churn: every op inserts the newest key and removes the
+        // oldest, so the tree keeps n keys and half the ops are deletes.
+        result.phases.push_back(runPhase("churn", ops, perf, [&](std::uint64_t i) {
+            engine->insert(mix(n + i));
+            engine->remove(mix(i));
+        }));
+    }
+    else {
+        std::vector<std::uint64_t> picks(static_cast<std::size_t>(ops));
+        for (std::uint64_t& p : picks) {
+            p = rng() % n;
+        }
+        result.phases.push_back(runPhase("lookup", ops, perf, [&](std::uint64_t i) {
+            hits += engine->search(keyOf(picks[i]));
+        }));
+    }
+    result.hits = hits;
+
+    delete engine;
+    return result;
+}
+
+std::vector<std::string> splitList(const std::string& s) {
+    std::vector<std::string> items;
+    std::stringstream ss(s);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+        if (!item.empty()) {
+            items.push_back(item);
+        }
+    }
+    return items;
+}
+
+void usage() {
+    std::cerr << "usage: Laba2_Bench [--sizes N,N,...] [--engines bst,bst-scapegoat,avl,rbt,bst-slab,avl-slab,rbt-slab,\n"
+        << "                   avl-indexed,rbt-indexed,rbt-topdown,rbt-topdown-indexed,wavl,wavl-indexed,\n"
+        << "                   splay,splay-every8,splay-depth16,rbt-concurrent,set]\n"
+        << "                   [--workloads uniform,zipf,sorted,reverse,mixed,ttl]\n"
+        << "                   [--ops N] [--seed S] [--out FILE] [--full] [--counters]\n";
+}
+
+bool parseArgs(int argc, char** argv, Config& config) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--full") {
+            config.sizes = { 1000, 10000, 100000, 1000000, 10000000, 100000000 };
+        }
+        else if (arg == "--counters") {
+            config.counters = true;
+        }
+        else if (arg == "--sizes" && hasValue) {
+            config.sizes.clear();
+            for (const std::string& s : splitList(argv[++i])) {
+                config.sizes.push_back(std::strtoull(s.c_str(), nullptr, 10));
+            }
+        }
+        else if (arg == "--engines" && hasValue) {
+            config.engines = splitList(argv[++i]);
+        }
+        else if (arg == "--workloads" && hasValue) {
+            config.workloads = splitList(argv[++i]);
+        }
+        else if (arg == "--ops" && hasValue) {
+            config.ops = std::strtoull(argv[++i], nullptr, 10);
+        }
+        else if (arg == "--seed" && hasValue) {
+            config.seed = std::strtoull(argv[++i], nullptr, 10);
+        }
+        else if (arg == "--out" && hasValue) {
+            config.out = argv[++i];
+        }
+        else {
+            usage();
+            return false;
+        }
+    }
+    return true;
+}
+
+void writePhase(std::ostream& json, const PhaseResult& phase) {
+    json << "\"" << phase.name << "\": {"
+        << "\"ops\": " << phase.ops
+        << ", \"seconds\": " << phase.seconds
+        << ", \"ops_per_sec\": " << (phase.seconds > 0 ? phase.ops / phase.seconds : 0.0)
+        << ", \"p50_ns\": " << phase.p50
+        << ", \"p99_ns\": " << phase.p99;
+    if (!phase.counters.empty()) {
+        json << ", \"per_op\": {";
+        bool first = true;
+        for (int e = 0; e < PerfCounters::EVENT_COUNT; e++) {
+            if (phase.counters[e] < 0 || phase.ops == 0) {
+                continue;
+            }
+            json << (first ? "" : ", ") << "\"" << PerfCounters::name(static_cast<PerfCounters::Event>(e))
+                << "\": " << phase.counters[e] / phase.ops;
+            first = false;
+        }
+        json << "}";
+    }
+    json << "}";
+}
+
+} // namespace
+
+void* operator new(std::size_t size) { return countedAlloc(size); }
+void* operator new[](std::size_t size) { return countedAlloc(size); }
+void operator delete(void* ptr) noexcept { countedFree(ptr); }
+void operator delete[](void* ptr) noexcept { countedFree(ptr); }
+void operator delete(void* ptr, std::size_t) noexcept { countedFree(ptr); }
+void operator delete[](void* ptr, std::size_t) noexcept { countedFree(ptr); }
+
+int main(int argc, char** argv) {
+    Config config;
+    if (!parseArgs(argc, argv, config)) {
+        return 2;
+    }
+
+    std::ofstream file;
+    if (!config.out.empty()) {
+        file.open(config.out);
+        if (!file) {
+            std::cerr << "cannot open " << config.out << std::endl;
+            return 1;
+        }
+    }
+    std::ostream json(config.out.empty() ? std::cout.rdbuf() : file.rdbuf());
+    json.precision(6);
+
+    std::unique_ptr<PerfCounters> perf;
+    if (config.counters) {
+        perf.reset(new PerfCounters());
+        if (!perf->available()) {
+            std::cerr << "hardware counters unavailable (perf_event_open failed), running without them" << std::endl;
+            perf.reset();
+        }
+    }
+
+    json << "{\n  \"benchmark\": \"laba2-trees\",\n  \"seed\": " << config.seed
+        << ",\n  \"node_bytes\": {\"bst\": " << BST<Key>::nodeBytes << ", \"avl\": " << AVLTree<Key>::nodeBytes
+        << ", \"rbt\": " << RBTree<Key>::nodeBytes << ", \"avl-indexed\": " << AVLTree<Key, Silent, IndexedNodes<>>::nodeBytes
+        << ", \"rbt-indexed\": " << RBTree<Key, Silent, IndexedNodes<>>::nodeBytes
+        << ", \"rbt-topdown\": " << TopDownRBTree<Key>::nodeBytes
+        << ", \"rbt-topdown-indexed\": " << TopDownRBTree<Key, IndexedNodes<>>::nodeBytes
+        << ", \"wavl\": " << WAVLTree<Key>::nodeBytes
+        << ", \"wavl-indexed\": " << WAVLTree<Key, Silent, IndexedNodes<>>::nodeBytes
+        << ", \"splay\": " << SplayTree<Key>::nodeBytes << "},\n  \"results\": [";
+    bool first = true;
+    for (std::uint64_t n : config.sizes) {
+        if (n == 0) {
+            continue;
+        }
+        std::uint64_t ops = config.ops ? config.ops : n;
+        for (const std::string& workload : config.workloads) {
+            for (const std::string& engine : config.engines) {
+                std::cerr << engine << " " << workload << " n=" << n << std::endl;
+
+                json << (first ? "\n" : ",\n") << "    {\"engine\": \"" << engine
+                    << "\", \"workload\": \"" << workload << "\", \"keys\": " << n;
+                first = false;
+
+                bool degenerate = workload == "sorted" || workload == "reverse";
+                if ((engine == "bst" || engine == "bst-slab") && degenerate && n > kDegenerateLimit) {
+                    json << ", \"skipped\": \"degenerate BST above " << kDegenerateLimit << " keys\"}";
+                    continue;
+                }
+
+                RunResult result;
+                if (engine == "bst") {
+                    result = runWorkload<TreeEngine<BST<Key>>>(workload, n, ops, config.seed, perf.get());
+                }
+                else if (engine == "bst-scapegoat") {
+                    result = runWorkload<ScapegoatEngine>(workload, n, ops, config.seed, perf.get());
+                }
+                else if (engine == "avl") {
+                    result = runWorkload<TreeEngine<AVLTree<Key>>>(workload, n, ops, config.seed, perf.get());
+                }
+                else if (engine == "rbt") {
+                    result = runWorkload<TreeEngine<RBTree<Key>>>(workload, n, ops, config.seed, perf.get());
+                }
+                else if (engine == "bst-slab") {
+                    result = runWorkload<TreeEngine<BST<Key, SlabNodes<>>>>(workload, n, ops, config.seed, perf.get());
+                }
+                else if (engine == "avl-slab") {
+                    result = runWorkload<TreeEngine<AVLTree<Key, Silent, SlabNodes<>>>>(workload, n, ops, config.seed, perf.get());
+                }
+                else if (engine == "rbt-slab") {
+                    result = runWorkload<TreeEngine<RBTree<Key, Silent, SlabNodes<>>>>(workload, n, ops, config.seed, perf.get());
+                }
+                else if (engine == "avl-indexed") {
+                    result = runWorkload<TreeEngine<AVLTree<Key, Silent, IndexedNodes<>>>>(workload, n, ops, config.seed, perf.get());
+                }
+                else if (engine == "rbt-indexed") {
+                    result = runWorkload<TreeEngine<RBTree<Key, Silent, IndexedNodes<>>>>(workload, n, ops, config.seed, perf.get());
+                }
+                else if (engine == "rbt-topdown") {
+                    result = runWorkload<TreeEngine<TopDownRBTree<Key>>>(workload, n, ops, config.seed, perf.get());
+                }
+                else if (engine == "rbt-topdown-indexed") {
+                    result = runWorkload<TreeEngine<TopDownRBTree<Key, IndexedNodes<>>>>(workload, n, ops, config.seed, perf.get());
+                }
+                else if (engine == "wavl") {
+                    result = runWorkload<TreeEngine<WAVLTree<Key>>>(workload, n, ops, config.seed, perf.get());
+                }
+                else if (engine == "wavl-indexed") {
+                    result = runWorkload<TreeEngine<WAVLTree<Key, Silent, IndexedNodes<>>>>(workload, n, ops, config.seed, perf.get());
+                }
+                else if (engine == "splay") {
+                    result = runWorkload<TreeEngine<SplayTree<Key>>>(workload, n, ops, config.seed, perf.get());
+                }
+                else if (engine == "splay-every8") {
+                    result = runWorkload<TreeEngine<SplayTree<Key, SplayEveryNth<8>>>>(workload, n, ops, config.seed, perf.get());
+                }
+                else if (engine == "splay-depth16") {
+                    result = runWorkload<TreeEngine<SplayTree<Key, SplayDeeperThan<16>>>>(workload, n, ops, config.seed, perf.get());
+                }
+                else if (engine == "rbt-concurrent") {
+                    result = runWorkload<TreeEngine<ConcurrentRBTree<Key>>>(workload, n, ops, config.seed, perf.get());
+                }
+                else if (engine == "set") {
+                    result = runWorkload<SetEngine>(workload, n, ops, config.seed, perf.get());
+                }
+                else {
+                    json << ", \"skipped\": \"unknown engine\"}";
+                    continue;
+                }
+
+                json << ", \"bytes_per_key\": " << result.bytesPerKey
+                    << ", \"hits\": " << result.hits << ", \"phases\": {";
+                for (std::size_t i = 0; i < result.phases.size(); i++) {
+                    json << (i ? ", " : "");
+                    writePhase(json, result.phases[i]);
+                }
+                json << "}}";
+                json.flush();
+            }
+        }
+    }
+    json << "\n  ]\n}\n";
+
+    return 0;
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+#include "Laba2_Parallel.h"
+
+// Tag for the range constructors and assign(): the input is already sorted
+// in ascending order and free of duplicates, so the tree is built in O(n).
+struct SortedUnique {};
+constexpr SortedUnique sortedUnique{};
+
+// Below this many elements sorting on one thread is faster than splitting.
+constexpr std::size_t kParallelSortCutoff = std::size_t(1) << 16;
+
+// Drops all but the first of each run of equal elements in a sorted vector.
+template <typename T>
+void dropDuplicates(std::vector<T>& values) {
+    values.erase(std::unique(values.begin(), values.end(),
+        [](const T& a, const T& b) { return !(a < b); }), values.end());
+}
+
+// Sorts and deduplicates values. By default the sort runs on the calling
+// thread; with threads > 1 (0 means std::thread::hardware_concurrency())
+// each thread sorts one chunk, then neighbouring chunks are merged
+// pairwise in parallel.
+template <typename T>
+void sortUnique(std::vector<T>& values, unsigned threads = 1) {
+    if (threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    std::size_t chunks = std::min<std::size_t>(threads, values.size() / kParallelSortCutoff);
+
+    if (chunks <= 1) {
+        std::sort(values.begin(), values.end());
+    }
+    else {
+        std::vector<std::size_t> bounds(chunks + 1);
+        for (std::size_t i = 0; i <= chunks; i++) {
+            bounds[i] = values.size() * i / chunks;
+        }
+
+        std::vector<std::thread> workers;
+        for (std::size_t i = 0; i < chunks; i++) {
+            workers.emplace_back([&values, &bounds, i] {
+                std::sort(values.begin() + bounds[i], values.begin() + bounds[i + 1]);
+            });
+        }
+        for (std::thread& worker : workers) {
+            worker.join();
+        }
+
+        for (std::size_t width = 1; width < chunks; width *= 2) {
+            workers.clear();
+            for (std::size_t i = 0; i + width < chunks; i += 2 * width) {
+                std::size_t mid = bounds[i + width];
+                std::size_t hi = bounds[std::min(i + 2 * width, chunks)];
+                workers.emplace_back([&values, &bounds, i, mid, hi] {
+                    std::inplace_merge(values.begin() + bounds[i], values.begin() + mid, values.begin() + hi);
+                });
+            }
+            for (std::thread& worker : workers) {
+                worker.join();
+            }
+        }
+    }
+
+    dropDuplicates(values);
+}
+
+// Merge sort of [first, last) on pool: the halves of a range longer than
+// cutoff are sorted as a fork, then merged.
+template <typename It>
+void sortOnPool(ForkJoinPool& pool, std::size_t cutoff, It first, It last) {
+    std::size_t n = static_cast<std::size_t>(last - first);
+    if (n <= cutoff || n < 2) {
+        std::sort(first, last);
+        return;
+    }
+    It mid = first + n / 2;
+    pool.invoke([&] { sortOnPool(pool, cutoff, first, mid); }, [&] { sortOnPool(pool, cutoff, mid, last); });
+    std::inplace_merge(first, mid, last);
+}
+
+// The same on the policy's fork-join pool, for the Parallel tree operations.
+template <typename T>
+void sortUnique(std::vector<T>& values, const Parallel& policy) {
+    sortOnPool(policy.resolve(), policy.cutoff, values.begin(), values.end());
+    dropDuplicates(values);
+}
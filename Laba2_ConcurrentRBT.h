@@ -0,0 +1,563 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "Laba2_RBT.h"
+#include "Laba2_Epoch.h"
+
+// Red-black tree for many readers and occasional writers.
+//
+// Writers take a mutex and run the usual insert / delete fix-ups over the
+// parent-linked nodes. Readers take no lock: they descend optimistically
+// and validate against a tree-wide version that every writer makes odd
+// while it relinks nodes, retrying when a write overlapped. After
+// kOptimisticAttempts failures a reader falls back to the writer mutex, so
+// it cannot starve. Removed nodes are retired to an epoch domain, so an
+// optimistic reader never touches freed memory.
+//
+// Child links are atomics readers load with acquire; parent and color
+// belong to the writer alone. Elements are never modified after a node is
+// published.
+template <typename T>
+class ConcurrentRBTree {
+private:
+    struct Node {
+        T data;
+        Color color;
+        std::atomic<Node*> left;
+        std::atomic<Node*> right;
+        Node* parent;
+
+        template <typename... Args>
+        explicit Node(Args&&... args)
+            : data(std::forward<Args>(args)...), color(RED), left(nullptr), right(nullptr), parent(nullptr) {
+        }
+    };
+
+    // RB height stays below 2 * log2(n + 1); a longer walk means the reader
+    // raced with a rotation and has to retry.
+    static constexpr int kMaxHeight = 128;
+    static constexpr int kOptimisticAttempts = 8;
+    static constexpr std::size_t kScanChunk = 64;
+
+    std::atomic<Node*> root;
+    Node* TNULL;
+    std::atomic<std::size_t> nodeCount;
+    std::atomic<std::uint64_t> version;
+    mutable std::mutex writeLock;
+    EpochDomain epochs;
+
+public:
+    ConcurrentRBTree();
+    ~ConcurrentRBTree();
+
+    ConcurrentRBTree(const ConcurrentRBTree&) = delete;
+    ConcurrentRBTree& operator=(const ConcurrentRBTree&) = delete;
+
+    // Writers; each returns whether the tree changed.
+    bool insert(const T& value);
+    template <typename Key>
+    bool remove(const Key& value);
+
+    // Readers, safe to run concurrently with each other and with writers.
+    template <typename Key>
+    bool search(const Key& value) const;
+    template <typename Key>
+    bool contains(const Key& value) const { return search(value); }
+
+    // Calls fn on every element in [lo, hi] in ascending order. Elements are
+    // read in consistent chunks of kScanChunk and fn runs outside them, so a
+    // long scan does not hold writers off; it sees each element that stays
+    // in the range for the whole scan exactly once.
+    template <typename Key, typename F>
+    void for_range(const Key& lo, const Key& hi, F fn) const;
+
+    std::size_t size() const { return nodeCount.load(std::memory_order_relaxed); }
+    bool isEmpty() const { return size() == 0; }
+
+private:
+    static Node* load(const std::atomic<Node*>& link) { return link.load(std::memory_order_acquire); }
+    static Node* peek(const std::atomic<Node*>& link) { return link.load(std::memory_order_relaxed); }
+    static void store(std::atomic<Node*>& link, Node* node) { link.store(node, std::memory_order_release); }
+
+    std::uint64_t beginRead() const;
+    bool validate(std::uint64_t seen) const;
+    void beginWrite();
+    void endWrite();
+
+    template <typename Key>
+    bool lookup(const Key& key, bool& found) const;
+    template <typename Key>
+    bool collect(const Key& lo, const Key& hi, const T* after, std::vector<T>& chunk, bool& more) const;
+    template <typename Key>
+    bool readChunk(const Key& lo, const Key& hi, const T* after, std::vector<T>& chunk) const;
+
+    void setChild(Node* parent, Node* oldChild, Node* newChild);
+    void leftRotate(Node* x);
+    void rightRotate(Node* x);
+    void fixInsert(Node* k);
+    void fixDelete(Node* x);
+    void transplant(Node* u, Node* v);
+    Node* minimum(Node* node) const;
+    void clear(Node* node);
+};
+
+
+template <typename T>
+ConcurrentRBTree<T>::ConcurrentRBTree() : nodeCount(0), version(0) {
+    TNULL = new Node();
+    TNULL->color = BLACK;
+    root.store(TNULL, std::memory_order_relaxed);
+}
+
+template <typename T>
+ConcurrentRBTree<T>::~ConcurrentRBTree() {
+    clear(peek(root));
+    delete TNULL;
+}
+
+template <typename T>
+void ConcurrentRBTree<T>::clear(Node* node) {
+    if (node != TNULL) {
+        clear(peek(node->left));
+        clear(peek(node->right));
+        delete node;
+    }
+}
+
+template <typename T>
+std::uint64_t ConcurrentRBTree<T>::beginRead() const {
+    std::uint64_t seen = version.load(std::memory_order_acquire);
+    while (seen & 1) {
+        std::this_thread::yield();
+        seen = version.load(std::memory_order_acquire);
+    }
+    return seen;
+}
+
+template <typename T>
+bool ConcurrentRBTree<T>::validate(std::uint64_t seen) const {
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return version.load(std::memory_order_relaxed) == seen;
+}
+
+template <typename T>
+void ConcurrentRBTree<T>::beginWrite() {
+    version.store(version.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+}
+
+template <typename T>
+void ConcurrentRBTree<T>::endWrite() {
+    version.store(version.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+
+// One descent; false when the walk ran too long to be consistent.
+template <typename T>
+template <typename Key>
+bool ConcurrentRBTree<T>::lookup(const Key& key, bool& found) const {
+    Node* node = load(root);
+    for (int steps = 0; node != TNULL; steps++) {
+        if (steps == kMaxHeight) {
+            return false;
+        }
+        if (key < node->data) {
+            node = load(node->left);
+        }
+        else if (node->data < key) {
+            node = load(node->right);
+        }
+        else {
+            found = true;
+            return true;
+        }
+    }
+    found = false;
+    return true;
+}
+
+template <typename T>
+template <typename Key>
+bool ConcurrentRBTree<T>::search(const Key& value) const {
+    EpochDomain::Guard guard(epochs);
+    bool found;
+
+    for (int attempt = 0; attempt < kOptimisticAttempts; attempt++) {
+        std::uint64_t seen = beginRead();
+        if (lookup(value, found) && validate(seen)) {
+            return found;
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(writeLock);
+    lookup(value, found);
+    return found;
+}
+
+// Copies up to kScanChunk elements of [lo, hi] into chunk, starting after
+// *after when it is set; more tells whether the range goes on.
+template <typename T>
+template <typename Key>
+bool ConcurrentRBTree<T>::collect(const Key& lo, const Key& hi, const T* after, std::vector<T>& chunk, bool& more) const {
+    Node* stack[kMaxHeight];
+    int depth = 0;
+    int steps = 0;
+
+    Node* node = load(root);
+    while (node != TNULL) {
+        if (++steps == kMaxHeight) {
+            return false;
+        }
+        bool goLeft = after ? *after < node->data : !(node->data < lo);
+        if (goLeft) {
+            stack[depth++] = node;
+            node = load(node->left);
+        }
+        else {
+            node = load(node->right);
+        }
+    }
+
+    more = false;
+    while (depth > 0) {
+        node = stack[--depth];
+        if (hi < node->data) {
+            return true;
+        }
+        if (chunk.size() == kScanChunk) {
+            more = true;
+            return true;
+        }
+        chunk.push_back(node->data);
+
+        for (Node* child = load(node->right); child != TNULL; child = load(child->left)) {
+            if (depth == kMaxHeight) {
+                return false;
+            }
+            stack[depth++] = child;
+        }
+    }
+    return true;
+}
+
+template <typename T>
+template <typename Key>
+bool ConcurrentRBTree<T>::readChunk(const Key& lo, const Key& hi, const T* after, std::vector<T>& chunk) const {
+    EpochDomain::Guard guard(epochs);
+    bool more;
+
+    for (int attempt = 0; attempt < kOptimisticAttempts; attempt++) {
+        chunk.clear();
+        std::uint64_t seen = beginRead();
+        if (collect(lo, hi, after, chunk, more) && validate(seen)) {
+            return more;
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(writeLock);
+    chunk.clear();
+    collect(lo, hi, after, chunk, more);
+    return more;
+}
+
+template <typename T>
+template <typename Key, typename F>
+void ConcurrentRBTree<T>::for_range(const Key& lo, const Key& hi, F fn) const {
+    std::vector<T> chunk;
+    chunk.reserve(kScanChunk);
+
+    bool more = readChunk(lo, hi, static_cast<const T*>(nullptr), chunk);
+    for (;;) {
+        for (const T& value : chunk) {
+            fn(value);
+        }
+        if (!more) {
+            return;
+        }
+        T last = chunk.back();
+        more = readChunk(lo, hi, &last, chunk);
+    }
+}
+
+
+template <typename T>
+void ConcurrentRBTree<T>::setChild(Node* parent, Node* oldChild, Node* newChild) {
+    if (parent == nullptr) {
+        root.store(newChild, std::memory_order_release);
+    }
+    else if (oldChild == peek(parent->left)) {
+        store(parent->left, newChild);
+    }
+    else {
+        store(parent->right, newChild);
+    }
+}
+
+template <typename T>
+void ConcurrentRBTree<T>::leftRotate(Node* x) {
+    Node* y = peek(x->right);
+    Node* inner = peek(y->left);
+
+    store(x->right, inner);
+    if (inner != TNULL) {
+        inner->parent = x;
+    }
+
+    y->parent = x->parent;
+    setChild(x->parent, x, y);
+
+    store(y->left, x);
+    x->parent = y;
+}
+
+template <typename T>
+void ConcurrentRBTree<T>::rightRotate(Node* x) {
+    Node* y = peek(x->left);
+    Node* inner = peek(y->right);
+
+    store(x->left, inner);
+    if (inner != TNULL) {
+        inner->parent = x;
+    }
+
+    y->parent = x->parent;
+    setChild(x->parent, x, y);
+
+    store(y->right, x);
+    x->parent = y;
+}
+
+template <typename T>
+bool ConcurrentRBTree<T>::insert(const T& value) {
+    std::lock_guard<std::mutex> lock(writeLock);
+
+    Node* parent = nullptr;
+    Node* current = peek(root);
+    while (current != TNULL) {
+        parent = current;
+        if (value < current->data) {
+            current = peek(current->left);
+        }
+        else if (current->data < value) {
+            current = peek(current->right);
+        }
+        else {
+            return false;
+        }
+    }
+
+    Node* node = new Node(value);
+    node->left.store(TNULL, std::memory_order_relaxed);
+    node->right.store(TNULL, std::memory_order_relaxed);
+    node->parent = parent;
+
+    beginWrite();
+    if (parent == nullptr) {
+        root.store(node, std::memory_order_release);
+    }
+    else if (value < parent->data) {
+        store(parent->left, node);
+    }
+    else {
+        store(parent->right, node);
+    }
+    fixInsert(node);
+    endWrite();
+
+    nodeCount.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+template <typename T>
+void ConcurrentRBTree<T>::fixInsert(Node* k) {
+    while (k->parent != nullptr && k->parent->color == RED) {
+        Node* grand = k->parent->parent;
+
+        if (k->parent == peek(grand->right)) {
+            Node* u = peek(grand->left);
+
+            if (u->color == RED) {
+                u->color = BLACK;
+                k->parent->color = BLACK;
+                grand->color = RED;
+                k = grand;
+            }
+            else {
+                if (k == peek(k->parent->left)) {
+                    k = k->parent;
+                    rightRotate(k);
+                }
+                k->parent->color = BLACK;
+                k->parent->parent->color = RED;
+                leftRotate(k->parent->parent);
+            }
+        }
+        else {
+            Node* u = peek(grand->right);
+
+            if (u->color == RED) {
+                u->color = BLACK;
+                k->parent->color = BLACK;
+                grand->color = RED;
+                k = grand;
+            }
+            else {
+                if (k == peek(k->parent->right)) {
+                    k = k->parent;
+                    leftRotate(k);
+                }
+                k->parent->color = BLACK;
+                k->parent->parent->color = RED;
+                rightRotate(k->parent->parent);
+            }
+        }
+    }
+    peek(root)->color = BLACK;
+}
+
+template <typename T>
+void ConcurrentRBTree<T>::transplant(Node* u, Node* v) {
+    setChild(u->parent, u, v);
+    v->parent = u->parent;
+}
+
+template <typename T>
+typename ConcurrentRBTree<T>::Node* ConcurrentRBTree<T>::minimum(Node* node) const {
+    while (peek(node->left) != TNULL) {
+        node = peek(node->left);
+    }
+    return node;
+}
+
+template <typename T>
+template <typename Key>
+bool ConcurrentRBTree<T>::remove(const Key& value) {
+    std::lock_guard<std::mutex> lock(writeLock);
+
+    Node* z = peek(root);
+    while (z != TNULL) {
+        if (value < z->data) {
+            z = peek(z->left);
+        }
+        else if (z->data < value) {
+            z = peek(z->right);
+        }
+        else {
+            break;
+        }
+    }
+    if (z == TNULL) {
+        return false;
+    }
+
+    beginWrite();
+    Node* x;
+    Color yOriginalColor = z->color;
+
+    if (peek(z->left) == TNULL) {
+        x = peek(z->right);
+        transplant(z, x);
+    }
+    else if (peek(z->right) == TNULL) {
+        x = peek(z->left);
+        transplant(z, x);
+    }
+    else {
+        Node* y = minimum(peek(z->right));
+        yOriginalColor = y->color;
+        x = peek(y->right);
+
+        if (y->parent == z) {
+            x->parent = y;
+        }
+        else {
+            transplant(y, x);
+            store(y->right, peek(z->right));
+            peek(y->right)->parent = y;
+        }
+
+        transplant(z, y);
+        store(y->left, peek(z->left));
+        peek(y->left)->parent = y;
+        y->color = z->color;
+    }
+
+    if (yOriginalColor == BLACK) {
+        fixDelete(x);
+    }
+    endWrite();
+
+    nodeCount.fetch_sub(1, std::memory_order_relaxed);
+    epochs.retire(z);
+    return true;
+}
+
+template <typename T>
+void ConcurrentRBTree<T>::fixDelete(Node* x) {
+    while (x != peek(root) && x->color == BLACK) {
+        if (x == peek(x->parent->left)) {
+            Node* s = peek(x->parent->right);
+
+            if (s->color == RED) {
+                s->color = BLACK;
+                x->parent->color = RED;
+                leftRotate(x->parent);
+                s = peek(x->parent->right);
+            }
+
+            if (peek(s->left)->color == BLACK && peek(s->right)->color == BLACK) {
+                s->color = RED;
+                x = x->parent;
+            }
+            else {
+                if (peek(s->right)->color == BLACK) {
+                    peek(s->left)->color = BLACK;
+                    s->color = RED;
+                    rightRotate(s);
+                    s = peek(x->parent->right);
+                }
+                s->color = x->parent->color;
+                x->parent->color = BLACK;
+                peek(s->right)->color = BLACK;
+                leftRotate(x->parent);
+                x = peek(root);
+            }
+        }
+        else {
+            Node* s = peek(x->parent->left);
+
+            if (s->color == RED) {
+                s->color = BLACK;
+                x->parent->color = RED;
+                rightRotate(x->parent);
+                s = peek(x->parent->left);
+            }
+
+            if (peek(s->right)->color == BLACK && peek(s->left)->color == BLACK) {
+                s->color = RED;
+                x = x->parent;
+            }
+            else {
+                if (peek(s->left)->color == BLACK) {
+                    peek(s->right)->color = BLACK;
+                    s->color = RED;
+                    leftRotate(s);
+                    s = peek(x->parent->left);
+                }
+                s->color = x->parent->color;
+                x->parent->color = BLACK;
+                peek(s->left)->color = BLACK;
+                rightRotate(x->parent);
+                x = peek(root);
+            }
+        }
+    }
+    x->color = BLACK;
+}
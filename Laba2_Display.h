@@ -0,0 +1,23 @@
+#pragma once
+
+#include <iostream>
+#include <string>
+
+// Prints the subtree under node turned on its side, right subtree above
+// and left below, for trees whose nodes hold data, left and right.
+template <typename Node>
+void printSideways(const Node* node, int level, int spaces, bool left) {
+    if (node == nullptr) {
+        return;
+    }
+
+    printSideways(static_cast<const Node*>(node->right), level + 1, spaces + 4, false);
+
+    std::cout << std::string(spaces, ' ');
+    if (level > 0) {
+        std::cout << (left ? "└── " : "┌── ");
+    }
+    std::cout << node->data << std::endl;
+
+    printSideways(static_cast<const Node*>(node->left), level + 1, spaces + 4, true);
+}
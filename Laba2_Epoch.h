@@ -0,0 +1,130 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <thread>
+#include <vector>
+
+// Epoch-based reclamation for structures read without locks.
+//
+// A reader holds a Guard while it may touch shared nodes; the guard pins
+// the global epoch in one of a fixed set of slots. Writers (serialized by
+// the caller) retire unlinked nodes instead of deleting them. A node
+// retired in epoch e is freed once the epoch reaches e + 2: the epoch can
+// only move on when every pinned reader has seen the current value, so no
+// reader that could still reach the node is left by then.
+class EpochDomain {
+    struct Slot;
+
+public:
+    class Guard {
+    public:
+        explicit Guard(const EpochDomain& domain);
+        ~Guard() { slot->epoch.store(0, std::memory_order_release); }
+
+        Guard(const Guard&) = delete;
+        Guard& operator=(const Guard&) = delete;
+
+    private:
+        Slot* slot;
+    };
+
+    EpochDomain() = default;
+    ~EpochDomain();
+
+    EpochDomain(const EpochDomain&) = delete;
+    EpochDomain& operator=(const EpochDomain&) = delete;
+
+    // Frees node with delete once no reader can reach it. Not thread-safe:
+    // retire() and reclaim() belong to the single writer of the structure.
+    template <typename Node>
+    void retire(Node* node);
+    void reclaim();
+
+    std::size_t pendingCount() const { return limbo.size(); }
+
+private:
+    static constexpr std::size_t kSlots = 128;
+    static constexpr std::size_t kReclaimBatch = 64;
+
+    struct alignas(64) Slot {
+        std::atomic<std::uint64_t> epoch{ 0 };
+    };
+
+    struct Retired {
+        void* node;
+        void (*destroy)(void*);
+        std::uint64_t epoch;
+    };
+
+    mutable Slot slots[kSlots];
+    std::atomic<std::uint64_t> global{ 1 };
+    std::vector<Retired> limbo;
+    std::size_t reclaimAt = kReclaimBatch;
+
+    bool tryAdvance();
+
+    template <typename Node>
+    static void destroyNode(void* node) { delete static_cast<Node*>(node); }
+};
+
+
+inline EpochDomain::Guard::Guard(const EpochDomain& domain) {
+    std::size_t start = std::hash<std::thread::id>()(std::this_thread::get_id());
+    for (std::size_t i = 0;; i++) {
+        Slot& candidate = domain.slots[(start + i) % kSlots];
+        std::uint64_t free = 0;
+        if (candidate.epoch.load(std::memory_order_relaxed) == 0
+            && candidate.epoch.compare_exchange_strong(free, domain.global.load())) {
+            slot = &candidate;
+            return;
+        }
+        if (i % kSlots == kSlots - 1) {
+            std::this_thread::yield();
+        }
+    }
+}
+
+inline EpochDomain::~EpochDomain() {
+    for (Retired& retired : limbo) {
+        retired.destroy(retired.node);
+    }
+}
+
+template <typename Node>
+void EpochDomain::retire(Node* node) {
+    limbo.push_back({ node, &destroyNode<Node>, global.load() });
+    if (limbo.size() >= reclaimAt) {
+        reclaim();
+    }
+}
+
+inline bool EpochDomain::tryAdvance() {
+    std::uint64_t current = global.load();
+    for (Slot& slot : slots) {
+        std::uint64_t pinned = slot.epoch.load();
+        if (pinned != 0 && pinned != current) {
+            return false;
+        }
+    }
+    return global.compare_exchange_strong(current, current + 1);
+}
+
+inline void EpochDomain::reclaim() {
+    tryAdvance();
+    std::uint64_t safe = global.load();
+
+    std::size_t kept = 0;
+    for (Retired& retired : limbo) {
+        if (retired.epoch + 2 <= safe) {
+            retired.destroy(retired.node);
+        }
+        else {
+            limbo[kept++] = retired;
+        }
+    }
+    limbo.resize(kept);
+    reclaimAt = kept + kReclaimBatch;
+}
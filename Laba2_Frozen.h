@@ -0,0 +1,400 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <limits>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#if defined(__AVX2__) || defined(__SSE2__) || defined(_M_X64)
+#include <immintrin.h>
+#endif
+
+#include "Laba2_Bulk.h"
+#include "Laba2_Prefetch.h"
+
+// Read-only sorted set laid out for lookups, built by the trees' freeze().
+//
+// Elements are stored in one 64-byte aligned array in BFS order
+// (Eytzinger layout): the children of slot k are 2k and 2k + 1, so the top
+// levels share a few cache lines and a search is a loop of
+// k = 2k + (a[k] < key) with no unpredictable branch. The descendants of
+// a slot a few levels down fill one cache line, which the loop prefetches
+// while it is still comparing.
+//
+// Integral T uses the same idea with one cache line per node instead of
+// one key: blocks of 64 / sizeof(T) sorted keys with as many + 1 children,
+// where a block is searched by counting the keys below the query with
+// SIMD compares. The last block is padded with the type's maximum.
+template <typename T>
+class FrozenSet {
+public:
+    FrozenSet() : slots(nullptr), count(0), capacity(0), padIsKey(false) {}
+
+    template <typename It>
+    FrozenSet(SortedUnique, It first, It last)
+        : FrozenSet(sortedUnique, first, static_cast<std::size_t>(std::distance(first, last))) {
+    }
+
+    // Takes the first n values of a strictly increasing sequence.
+    template <typename It>
+    FrozenSet(SortedUnique, It first, std::size_t n);
+
+    FrozenSet(FrozenSet&& other) noexcept
+        : slots(other.slots), count(other.count), capacity(other.capacity), padIsKey(other.padIsKey) {
+        other.slots = nullptr;
+        other.count = other.capacity = 0;
+    }
+    FrozenSet& operator=(FrozenSet&& other) noexcept;
+    ~FrozenSet() { release(); }
+
+    FrozenSet(const FrozenSet&) = delete;
+    FrozenSet& operator=(const FrozenSet&) = delete;
+
+    std::size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+
+    // Smallest element not less than value, nullptr if there is none.
+    const T* lower_bound(const T& value) const;
+    bool contains(const T& value) const;
+
+    // The same for n keys at once. Independent searches are advanced in
+    // groups of kBatch so their cache misses overlap.
+    void lower_bound_batch(const T* values, std::size_t n, const T** out) const;
+    void contains_batch(const T* values, std::size_t n, bool* out) const;
+
+private:
+    static constexpr std::size_t kLine = 64;
+    static constexpr std::size_t kBatch = 16;
+    static constexpr bool kBlocked = std::is_integral<T>::value && !std::is_same<T, bool>::value && sizeof(T) <= 8;
+    // Keys per block; 1 selects the binary layout.
+    static constexpr std::size_t kBlock = kBlocked ? kLine / sizeof(T) : 1;
+
+    static constexpr std::size_t prefetchStride() {
+        std::size_t stride = 1;
+        while (stride * 2 * sizeof(T) <= kLine) {
+            stride *= 2;
+        }
+        return stride;
+    }
+
+    // Binary layout: slots[1..count], slot 0 unused so the index arithmetic
+    // needs no offsets. Blocked layout: capacity keys in capacity / kBlock
+    // blocks starting at slots[0].
+    T* slots;
+    std::size_t count;
+    std::size_t capacity;
+    bool padIsKey;
+
+    template <typename It>
+    void fill(It& it, std::size_t slot, std::size_t& built);
+    void destroy(std::size_t slot, std::size_t& left);
+    template <typename It>
+    void fillBlock(It& it, std::size_t& taken, std::size_t block);
+    void release();
+
+    std::size_t blockCount() const { return capacity / kBlock; }
+    const T* result(const T* candidate) const;
+    static unsigned countLess(const T* block, T value);
+    static unsigned popcount(unsigned mask);
+    static unsigned trailingOnes(std::size_t k);
+};
+
+
+template <typename T>
+template <typename It>
+FrozenSet<T>::FrozenSet(SortedUnique, It first, std::size_t n)
+    : slots(nullptr), count(n), capacity(0), padIsKey(false) {
+    if (n == 0) {
+        return;
+    }
+
+    capacity = kBlocked ? (n + kBlock - 1) / kBlock * kBlock : n + 1;
+    slots = static_cast<T*>(::operator new(capacity * sizeof(T), std::align_val_t(kLine)));
+
+    if constexpr (kBlocked) {
+        std::size_t taken = 0;
+        fillBlock(first, taken, 0);
+    }
+    else {
+        std::size_t built = 0;
+        try {
+            fill(first, 1, built);
+        }
+        catch (...) {
+            destroy(1, built);
+            ::operator delete(slots, std::align_val_t(kLine));
+            slots = nullptr;
+            count = capacity = 0;
+            throw;
+        }
+    }
+}
+
+template <typename T>
+FrozenSet<T>& FrozenSet<T>::operator=(FrozenSet&& other) noexcept {
+    if (this != &other) {
+        release();
+        slots = other.slots;
+        count = other.count;
+        capacity = other.capacity;
+        padIsKey = other.padIsKey;
+        other.slots = nullptr;
+        other.count = other.capacity = 0;
+    }
+    return *this;
+}
+
+template <typename T>
+void FrozenSet<T>::release() {
+    if (!slots) {
+        return;
+    }
+    if constexpr (!kBlocked && !std::is_trivially_destructible<T>::value) {
+        for (std::size_t k = 1; k <= count; k++) {
+            slots[k].~T();
+        }
+    }
+    ::operator delete(slots, std::align_val_t(kLine));
+    slots = nullptr;
+}
+
+// In-order walk over the implicit tree, so the sorted input lands in BFS
+// positions.
+template <typename T>
+template <typename It>
+void FrozenSet<T>::fill(It& it, std::size_t slot, std::size_t& built) {
+    if (slot > count) {
+        return;
+    }
+    fill(it, 2 * slot, built);
+    ::new (static_cast<void*>(slots + slot)) T(*it);
+    built++;
+    ++it;
+    fill(it, 2 * slot + 1, built);
+}
+
+// Destroys the first left elements in in-order, i.e. what an interrupted
+// fill() has built.
+template <typename T>
+void FrozenSet<T>::destroy(std::size_t slot, std::size_t& left) {
+    if (slot > count || left == 0) {
+        return;
+    }
+    destroy(2 * slot, left);
+    if (left > 0) {
+        slots[slot].~T();
+        left--;
+        destroy(2 * slot + 1, left);
+    }
+}
+
+template <typename T>
+template <typename It>
+void FrozenSet<T>::fillBlock(It& it, std::size_t& taken, std::size_t block) {
+    if (block >= blockCount()) {
+        return;
+    }
+    for (std::size_t i = 0; i < kBlock; i++) {
+        fillBlock(it, taken, block * (kBlock + 1) + i + 1);
+        if (taken < count) {
+            slots[block * kBlock + i] = *it;
+            padIsKey = padIsKey || *it == std::numeric_limits<T>::max();
+            ++it;
+            taken++;
+        }
+        else {
+            slots[block * kBlock + i] = std::numeric_limits<T>::max();
+        }
+    }
+    fillBlock(it, taken, block * (kBlock + 1) + kBlock + 1);
+}
+
+
+
+template <typename T>
+unsigned FrozenSet<T>::popcount(unsigned mask) {
+#if defined(__GNUC__)
+    return static_cast<unsigned>(__builtin_popcount(mask));
+#else
+    unsigned bits = 0;
+    for (; mask != 0; mask &= mask - 1) {
+        bits++;
+    }
+    return bits;
+#endif
+}
+
+template <typename T>
+unsigned FrozenSet<T>::trailingOnes(std::size_t k) {
+#if defined(__GNUC__)
+    return static_cast<unsigned>(__builtin_ctzll(~static_cast<unsigned long long>(k)));
+#else
+    unsigned ones = 0;
+    for (; k & 1; k >>= 1) {
+        ones++;
+    }
+    return ones;
+#endif
+}
+
+// Number of keys in the block below value. The block is sorted, so this is
+// also the child to descend into.
+template <typename T>
+unsigned FrozenSet<T>::countLess(const T* block, T value) {
+    // The vector compares are signed; flipping the top bit of both sides
+    // orders unsigned keys the same way.
+    constexpr bool flip = std::is_unsigned<T>::value;
+#if defined(__AVX2__)
+    if constexpr (sizeof(T) == 4) {
+        const __m256i bias = _mm256_set1_epi32(flip ? INT32_MIN : 0);
+        const __m256i key = _mm256_xor_si256(_mm256_set1_epi32(static_cast<int>(value)), bias);
+        unsigned less = 0;
+        for (std::size_t i = 0; i < kBlock; i += 8) {
+            __m256i keys = _mm256_xor_si256(_mm256_load_si256(reinterpret_cast<const __m256i*>(block + i)), bias);
+            less += popcount(static_cast<unsigned>(_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(key, keys)))));
+        }
+        return less;
+    }
+    if constexpr (sizeof(T) == 8) {
+        const __m256i bias = _mm256_set1_epi64x(flip ? INT64_MIN : 0);
+        const __m256i key = _mm256_xor_si256(_mm256_set1_epi64x(static_cast<long long>(value)), bias);
+        unsigned less = 0;
+        for (std::size_t i = 0; i < kBlock; i += 4) {
+            __m256i keys = _mm256_xor_si256(_mm256_load_si256(reinterpret_cast<const __m256i*>(block + i)), bias);
+            less += popcount(static_cast<unsigned>(_mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpgt_epi64(key, keys)))));
+        }
+        return less;
+    }
+#elif defined(__SSE2__) || defined(_M_X64)
+    if constexpr (sizeof(T) == 4) {
+        const __m128i bias = _mm_set1_epi32(flip ? INT32_MIN : 0);
+        const __m128i key = _mm_xor_si128(_mm_set1_epi32(static_cast<int>(value)), bias);
+        unsigned less = 0;
+        for (std::size_t i = 0; i < kBlock; i += 4) {
+            __m128i keys = _mm_xor_si128(_mm_load_si128(reinterpret_cast<const __m128i*>(block + i)), bias);
+            less += popcount(static_cast<unsigned>(_mm_movemask_ps(_mm_castsi128_ps(_mm_cmpgt_epi32(key, keys)))));
+        }
+        return less;
+    }
+#endif
+    (void)flip;
+    unsigned less = 0;
+    for (std::size_t i = 0; i < kBlock; i++) {
+        less += block[i] < value;
+    }
+    return less;
+}
+
+template <typename T>
+const T* FrozenSet<T>::result(const T* candidate) const {
+    // Padding is the largest possible key; landing on it means every real
+    // key was smaller, unless that value is itself in the set.
+    if constexpr (kBlocked) {
+        if (candidate && !padIsKey && *candidate == std::numeric_limits<T>::max()) {
+            return nullptr;
+        }
+    }
+    return candidate;
+}
+
+
+template <typename T>
+const T* FrozenSet<T>::lower_bound(const T& value) const {
+    if constexpr (kBlocked) {
+        const T* candidate = nullptr;
+        std::size_t blocks = blockCount();
+        for (std::size_t b = 0; b < blocks;) {
+            const T* block = slots + b * kBlock;
+            unsigned i = countLess(block, value);
+            candidate = i < kBlock ? block + i : candidate;
+            b = b * (kBlock + 1) + i + 1;
+        }
+        return result(candidate);
+    }
+    else {
+        std::size_t k = 1;
+        while (k <= count) {
+            prefetchRead(slots + k * prefetchStride());
+            k = 2 * k + (slots[k] < value);
+        }
+        // The last left turn is where the answer was; undo the right turns
+        // taken after it.
+        k >>= trailingOnes(k) + 1;
+        return k ? slots + k : nullptr;
+    }
+}
+
+template <typename T>
+bool FrozenSet<T>::contains(const T& value) const {
+    const T* found = lower_bound(value);
+    return found && !(value < *found);
+}
+
+template <typename T>
+void FrozenSet<T>::lower_bound_batch(const T* values, std::size_t n, const T** out) const {
+    for (std::size_t start = 0; start < n; start += kBatch) {
+        std::size_t lanes = n - start < kBatch ? n - start : kBatch;
+        const T* group = values + start;
+        std::size_t k[kBatch];
+        bool active = true;
+
+        if constexpr (kBlocked) {
+            const T* candidate[kBatch];
+            std::size_t blocks = blockCount();
+            for (std::size_t j = 0; j < lanes; j++) {
+                k[j] = 0;
+                candidate[j] = nullptr;
+            }
+            while (active) {
+                active = false;
+                for (std::size_t j = 0; j < lanes; j++) {
+                    if (k[j] < blocks) {
+                        const T* block = slots + k[j] * kBlock;
+                        unsigned i = countLess(block, group[j]);
+                        candidate[j] = i < kBlock ? block + i : candidate[j];
+                        k[j] = k[j] * (kBlock + 1) + i + 1;
+                        prefetchRead(slots + k[j] * kBlock);
+                        active = true;
+                    }
+                }
+            }
+            for (std::size_t j = 0; j < lanes; j++) {
+                out[start + j] = result(candidate[j]);
+            }
+        }
+        else {
+            for (std::size_t j = 0; j < lanes; j++) {
+                k[j] = 1;
+            }
+            while (active) {
+                active = false;
+                for (std::size_t j = 0; j < lanes; j++) {
+                    if (k[j] <= count) {
+                        k[j] = 2 * k[j] + (slots[k[j]] < group[j]);
+                        prefetchRead(slots + k[j]);
+                        active = true;
+                    }
+                }
+            }
+            for (std::size_t j = 0; j < lanes; j++) {
+                std::size_t slot = k[j] >> (trailingOnes(k[j]) + 1);
+                out[start + j] = slot ? slots + slot : nullptr;
+            }
+        }
+    }
+}
+
+template <typename T>
+void FrozenSet<T>::contains_batch(const T* values, std::size_t n, bool* out) const {
+    const T* found[kBatch];
+    for (std::size_t start = 0; start < n; start += kBatch) {
+        std::size_t lanes = n - start < kBatch ? n - start : kBatch;
+        lower_bound_batch(values + start, lanes, found);
+        for (std::size_t j = 0; j < lanes; j++) {
+            out[start + j] = found[j] && !(values[start + j] < *found[j]);
+        }
+    }
+}
@@ -0,0 +1,143 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <type_traits>
+#include <utility>
+
+#include "Laba2_AVL.h"
+#include "Laba2_RBT.h"
+
+// Key/value element stored by the map adapters. Ordering looks at the key
+// only, so the trees can hold entries while lookups take a bare key.
+// second is mutable because the trees hand out const references to their
+// elements; changing the value never moves the entry.
+template <typename K, typename V, typename Compare>
+struct MapEntry {
+    K first;
+    mutable V second;
+
+    MapEntry() : first(), second() {}
+
+    template <typename KArg, typename... VArgs,
+        typename = std::enable_if_t<!std::is_same<std::decay_t<KArg>, MapEntry>::value>>
+    explicit MapEntry(KArg&& key, VArgs&&... args)
+        : first(std::forward<KArg>(key)), second(std::forward<VArgs>(args)...) {
+    }
+
+    friend bool operator<(const MapEntry& a, const MapEntry& b) {
+        return Compare()(a.first, b.first);
+    }
+
+    template <typename Key, typename = std::enable_if_t<!std::is_same<Key, MapEntry>::value>>
+    friend bool operator<(const MapEntry& a, const Key& key) {
+        return Compare()(a.first, key);
+    }
+
+    template <typename Key, typename = std::enable_if_t<!std::is_same<Key, MapEntry>::value>>
+    friend bool operator<(const Key& key, const MapEntry& b) {
+        return Compare()(key, b.first);
+    }
+};
+
+// Ordered map on top of one of the balanced trees. Keys are unique; a
+// comparator with is_transparent (e.g. std::less<>) enables lookups by any
+// type it can compare with K without building a K first.
+//
+// RBMap needs default-constructible K and V for the tree's TNULL sentinel.
+template <template <typename, typename, typename, typename> class Engine,
+    typename K, typename V, typename Compare, typename Alloc, typename Augment>
+class TreeMap {
+public:
+    using key_type = K;
+    using mapped_type = V;
+    using value_type = MapEntry<K, V, Compare>;
+    using tree_type = Engine<value_type, Silent, Alloc, Augment>;
+    using const_iterator = typename tree_type::const_iterator;
+    using iterator = const_iterator;
+
+    template <typename... Args>
+    std::pair<iterator, bool> emplace(Args&&... args) {
+        return tree.emplace(std::forward<Args>(args)...);
+    }
+
+    template <typename... Args>
+    std::pair<iterator, bool> try_emplace(const K& key, Args&&... args) {
+        return tree.try_emplace(key, key, std::forward<Args>(args)...);
+    }
+
+    template <typename... Args>
+    std::pair<iterator, bool> try_emplace(K&& key, Args&&... args) {
+        return tree.try_emplace(key, std::move(key), std::forward<Args>(args)...);
+    }
+
+    template <typename M>
+    std::pair<iterator, bool> insert_or_assign(const K& key, M&& value) {
+        std::pair<iterator, bool> result = tree.try_emplace(key, key, std::forward<M>(value));
+        if (!result.second) {
+            result.first->second = std::forward<M>(value);
+        }
+        return result;
+    }
+
+    template <typename M>
+    std::pair<iterator, bool> insert_or_assign(K&& key, M&& value) {
+        std::pair<iterator, bool> result = tree.try_emplace(key, std::move(key), std::forward<M>(value));
+        if (!result.second) {
+            result.first->second = std::forward<M>(value);
+        }
+        return result;
+    }
+
+    V& operator[](const K& key) {
+        return try_emplace(key).first->second;
+    }
+
+    V& operator[](K&& key) {
+        return try_emplace(std::move(key)).first->second;
+    }
+
+    std::size_t erase(const K& key) {
+        std::size_t before = tree.size();
+        tree.remove(key);
+        return before - tree.size();
+    }
+
+    iterator find(const K& key) const { return tree.find(key); }
+    bool contains(const K& key) const { return tree.search(key); }
+    iterator lower_bound(const K& key) const { return tree.lower_bound(key); }
+    iterator upper_bound(const K& key) const { return tree.upper_bound(key); }
+
+    template <typename Key, typename C = Compare, typename = typename C::is_transparent>
+    iterator find(const Key& key) const { return tree.find(key); }
+    template <typename Key, typename C = Compare, typename = typename C::is_transparent>
+    bool contains(const Key& key) const { return tree.search(key); }
+    template <typename Key, typename C = Compare, typename = typename C::is_transparent>
+    iterator lower_bound(const Key& key) const { return tree.lower_bound(key); }
+    template <typename Key, typename C = Compare, typename = typename C::is_transparent>
+    iterator upper_bound(const Key& key) const { return tree.upper_bound(key); }
+    template <typename Key, typename C = Compare, typename = typename C::is_transparent>
+    std::size_t erase(const Key& key) {
+        std::size_t before = tree.size();
+        tree.remove(key);
+        return before - tree.size();
+    }
+
+    iterator begin() const { return tree.begin(); }
+    iterator end() const { return tree.end(); }
+    std::size_t size() const { return tree.size(); }
+    bool empty() const { return tree.size() == 0; }
+    void clear() { tree.clear(); }
+
+    // The underlying tree, for the order statistics and traversals.
+    const tree_type& base() const { return tree; }
+
+private:
+    tree_type tree;
+};
+
+template <typename K, typename V, typename Compare = std::less<K>, typename Alloc = HeapNodes, typename Augment = NoAugment>
+using AVLMap = TreeMap<AVLTree, K, V, Compare, Alloc, Augment>;
+
+template <typename K, typename V, typename Compare = std::less<K>, typename Alloc = HeapNodes, typename Augment = NoAugment>
+using RBMap = TreeMap<RBTree, K, V, Compare, Alloc, Augment>;
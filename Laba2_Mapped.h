@@ -0,0 +1,496 @@
+#pragma once
+
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "Laba2_Bulk.h"
+
+// Read-only set queried in place from a snapshot file written by the
+// trees' save().
+//
+// The file is a 64-byte header followed by one record per element in
+// ascending order: the value and the record indices of its left and right
+// children, so the saved tree's shape is kept and a lookup descends it
+// through the indices with no deserialization. Opening maps the file
+// (on other platforms it is read into memory) and checks the format
+// version, the element size and, unless asked not to, a checksum of the
+// records. Only trivially copyable T can be saved, and the file is read
+// back on a machine with the same byte order.
+template <typename T>
+class MappedSet {
+    static_assert(std::is_trivially_copyable<T>::value, "snapshot files hold raw copies of the elements");
+
+    struct Record {
+        T value;
+        std::uint32_t left;
+        std::uint32_t right;
+    };
+
+    struct Header {
+        char magic[8];
+        std::uint32_t version;
+        std::uint32_t byteOrder;
+        std::uint32_t valueBytes;
+        std::uint32_t valueAlign;
+        std::uint32_t recordBytes;
+        std::uint32_t root;
+        std::uint64_t count;
+        std::uint64_t checksum;
+    };
+
+    static constexpr char kMagic[8] = { 'L', 'A', 'B', 'A', '2', 'M', 'A', 'P' };
+    static constexpr std::uint32_t kVersion = 1;
+    static constexpr std::uint32_t kByteOrder = 0x01020304;
+    static constexpr std::size_t kDataOffset = 64;
+    static constexpr std::uint32_t kNone = 0xFFFFFFFF;
+
+    static_assert(sizeof(Header) <= kDataOffset && alignof(Record) <= kDataOffset, "records start at kDataOffset");
+
+public:
+    class const_iterator {
+    public:
+        using iterator_category = std::bidirectional_iterator_tag;
+        using value_type = T;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const T*;
+        using reference = const T&;
+
+        const_iterator() : record(nullptr) {}
+
+        reference operator*() const { return record->value; }
+        pointer operator->() const { return &record->value; }
+
+        const_iterator& operator++() { ++record; return *this; }
+        const_iterator operator++(int) { const_iterator old = *this; ++record; return old; }
+        const_iterator& operator--() { --record; return *this; }
+        const_iterator operator--(int) { const_iterator old = *this; --record; return old; }
+
+        bool operator==(const const_iterator& other) const { return record == other.record; }
+        bool operator!=(const const_iterator& other) const { return record != other.record; }
+
+    private:
+        friend class MappedSet;
+        explicit const_iterator(const Record* record) : record(record) {}
+
+        const Record* record;
+    };
+
+    MappedSet() : data(nullptr), bytes(0), records(nullptr), count(0), root(kNone), mapped(false) {}
+
+    // Throws std::system_error when the file cannot be read and
+    // std::runtime_error when it is not a valid snapshot of T. Skipping
+    // verify makes opening O(1) but trusts the records as they are.
+    explicit MappedSet(const std::string& path, bool verify = true);
+
+    MappedSet(MappedSet&& other) noexcept
+        : data(other.data), bytes(other.bytes), records(other.records), count(other.count), root(other.root), mapped(other.mapped) {
+        other.data = nullptr;
+        other.records = nullptr;
+        other.bytes = other.count = 0;
+        other.root = kNone;
+    }
+    MappedSet& operator=(MappedSet&& other) noexcept;
+    ~MappedSet() { release(); }
+
+    MappedSet(const MappedSet&) = delete;
+    MappedSet& operator=(const MappedSet&) = delete;
+
+    std::size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+
+    template <typename Key>
+    bool contains(const Key& value) const;
+    // Smallest element not less than value, nullptr if there is none.
+    template <typename Key>
+    const T* lower_bound(const Key& value) const;
+
+    const_iterator begin() const { return const_iterator(records); }
+    const_iterator end() const { return const_iterator(records + count); }
+
+    // Calls fn on every element in [lo, hi] in ascending order.
+    template <typename Key, typename F>
+    void for_range(const Key& lo, const Key& hi, F fn) const;
+
+    // Writes the subtree under root (nil marks a missing child) holding
+    // count elements. The file is written next to path and renamed over
+    // it, so a crash never leaves a torn snapshot behind.
+    template <typename Node>
+    static void write(const std::string& path, const Node* root, const Node* nil, std::size_t count);
+
+private:
+    const unsigned char* data;
+    std::size_t bytes;
+    const Record* records;
+    std::size_t count;
+    std::uint32_t root;
+    bool mapped;
+
+    void release();
+    void check(const std::string& path, bool verify);
+    template <typename Key>
+    std::uint32_t lowerBound(const Key& value) const;
+
+    static std::uint64_t checksum(const unsigned char* first, std::size_t n, std::uint64_t seed);
+    template <typename Node>
+    static std::uint32_t place(const Node* node, const Node* nil, Record* out, std::uint32_t& next);
+};
+
+
+// Tree opened from a snapshot file. Reads go to the mapped records until
+// the first write, which builds a regular Tree from them in O(n) and
+// unmaps the file; from then on everything goes to that tree.
+template <typename Tree>
+class MappedTree {
+public:
+    using value_type = typename Tree::const_iterator::value_type;
+
+    explicit MappedTree(MappedSet<value_type> snapshot) : snapshot(std::move(snapshot)) {}
+
+    template <typename Key>
+    bool search(const Key& value) const { return tree ? tree->search(value) : snapshot.contains(value); }
+    std::size_t size() const { return tree ? tree->size() : snapshot.size(); }
+    bool isEmpty() const { return size() == 0; }
+
+    template <typename Key, typename F>
+    void for_range(const Key& lo, const Key& hi, F fn) const;
+
+    void insert(const value_type& value) { promote().insert(value); }
+    template <typename Key>
+    void remove(const Key& value) { promote().remove(value); }
+    void clear() { promote().clear(); }
+
+    // Whether reads are still served from the file.
+    bool isMapped() const { return !tree; }
+    // The mutable tree, built on first use.
+    Tree& promote();
+
+private:
+    MappedSet<value_type> snapshot;
+    std::unique_ptr<Tree> tree;
+};
+
+
+template <typename T>
+MappedSet<T>& MappedSet<T>::operator=(MappedSet&& other) noexcept {
+    if (this != &other) {
+        release();
+        data = other.data;
+        bytes = other.bytes;
+        records = other.records;
+        count = other.count;
+        root = other.root;
+        mapped = other.mapped;
+        other.data = nullptr;
+        other.records = nullptr;
+        other.bytes = other.count = 0;
+        other.root = kNone;
+    }
+    return *this;
+}
+
+template <typename T>
+void MappedSet<T>::release() {
+    if (!data) {
+        return;
+    }
+#ifdef __linux__
+    if (mapped) {
+        ::munmap(const_cast<unsigned char*>(data), bytes);
+        data = nullptr;
+        return;
+    }
+#endif
+    ::operator delete(const_cast<unsigned char*>(data), std::align_val_t(kDataOffset));
+    data = nullptr;
+}
+
+template <typename T>
+MappedSet<T>::MappedSet(const std::string& path, bool verify)
+    : data(nullptr), bytes(0), records(nullptr), count(0), root(kNone), mapped(false) {
+#ifdef __linux__
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        throw std::system_error(errno, std::generic_category(), path);
+    }
+    struct stat info;
+    if (::fstat(fd, &info) != 0) {
+        int error = errno;
+        ::close(fd);
+        throw std::system_error(error, std::generic_category(), path);
+    }
+    bytes = static_cast<std::size_t>(info.st_size);
+    if (bytes >= kDataOffset) {
+        void* address = ::mmap(nullptr, bytes, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (address == MAP_FAILED) {
+            int error = errno;
+            ::close(fd);
+            throw std::system_error(error, std::generic_category(), path);
+        }
+        data = static_cast<const unsigned char*>(address);
+        mapped = true;
+    }
+    ::close(fd);
+#else
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file) {
+        throw std::system_error(std::make_error_code(std::errc::no_such_file_or_directory), path);
+    }
+    bytes = static_cast<std::size_t>(file.tellg());
+    if (bytes >= kDataOffset) {
+        unsigned char* buffer = static_cast<unsigned char*>(::operator new(bytes, std::align_val_t(kDataOffset)));
+        data = buffer;
+        file.seekg(0);
+        if (!file.read(reinterpret_cast<char*>(buffer), static_cast<std::streamsize>(bytes))) {
+            release();
+            throw std::system_error(std::make_error_code(std::errc::io_error), path);
+        }
+    }
+#endif
+
+    try {
+        check(path, verify);
+    }
+    catch (...) {
+        release();
+        throw;
+    }
+}
+
+template <typename T>
+void MappedSet<T>::check(const std::string& path, bool verify) {
+    if (!data) {
+        throw std::runtime_error(path + ": not a tree snapshot");
+    }
+
+    Header header;
+    std::memcpy(&header, data, sizeof(header));
+    if (std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0) {
+        throw std::runtime_error(path + ": not a tree snapshot");
+    }
+    if (header.version != kVersion || header.byteOrder != kByteOrder) {
+        throw std::runtime_error(path + ": unsupported snapshot version or byte order");
+    }
+    if (header.valueBytes != sizeof(T) || header.valueAlign != alignof(T) || header.recordBytes != sizeof(Record)) {
+        throw std::runtime_error(path + ": snapshot holds a different element type");
+    }
+    if (header.count >= kNone || bytes != kDataOffset + header.count * sizeof(Record)
+        || (header.count == 0 ? header.root != kNone : header.root >= header.count)) {
+        throw std::runtime_error(path + ": truncated or damaged snapshot");
+    }
+
+    records = reinterpret_cast<const Record*>(data + kDataOffset);
+    count = static_cast<std::size_t>(header.count);
+    root = header.root;
+    if (!verify) {
+        return;
+    }
+
+    if (checksum(data + kDataOffset, bytes - kDataOffset, root) != header.checksum) {
+        throw std::runtime_error(path + ": snapshot checksum mismatch");
+    }
+    // Records are numbered in order, so the subtree of a record spans an
+    // interval of indices: its left children come from the part below it,
+    // its right children from the part above. Intervals of different
+    // subtrees do not overlap, so no record is reached twice and a descent
+    // always ends; reaching all count of them makes the records one tree.
+    struct Span {
+        std::uint32_t index;
+        std::uint32_t lo;
+        std::uint32_t hi;
+    };
+    std::vector<Span> pending;
+    std::size_t reached = 0;
+    if (root != kNone) {
+        pending.push_back({ root, 0, static_cast<std::uint32_t>(count) });
+    }
+    while (!pending.empty()) {
+        Span span = pending.back();
+        pending.pop_back();
+        if (span.index < span.lo || span.index >= span.hi) {
+            throw std::runtime_error(path + ": truncated or damaged snapshot");
+        }
+        reached++;
+        const Record& record = records[span.index];
+        if (record.left != kNone) {
+            pending.push_back({ record.left, span.lo, span.index });
+        }
+        if (record.right != kNone) {
+            pending.push_back({ record.right, span.index + 1, span.hi });
+        }
+    }
+    if (reached != count) {
+        throw std::runtime_error(path + ": truncated or damaged snapshot");
+    }
+}
+
+// 64-bit multiply-rotate hash over 8-byte words; a final partial word is
+// zero-padded.
+template <typename T>
+std::uint64_t MappedSet<T>::checksum(const unsigned char* first, std::size_t n, std::uint64_t seed) {
+    const std::uint64_t prime = 0x9E3779B97F4A7C15ull;
+    std::uint64_t hash = seed ^ (n * prime);
+    for (; n > 0; first += 8, n -= std::min<std::size_t>(n, 8)) {
+        std::uint64_t word = 0;
+        std::memcpy(&word, first, std::min<std::size_t>(n, 8));
+        hash = (hash ^ word) * prime;
+        hash ^= hash >> 29;
+    }
+    return hash;
+}
+
+
+template <typename T>
+template <typename Key>
+std::uint32_t MappedSet<T>::lowerBound(const Key& value) const {
+    std::uint32_t result = static_cast<std::uint32_t>(count);
+    std::uint32_t index = root;
+    while (index != kNone) {
+        const Record& record = records[index];
+        if (record.value < value) {
+            index = record.right;
+        }
+        else {
+            result = index;
+            index = record.left;
+        }
+    }
+    return result;
+}
+
+template <typename T>
+template <typename Key>
+bool MappedSet<T>::contains(const Key& value) const {
+    std::uint32_t index = root;
+    while (index != kNone) {
+        const Record& record = records[index];
+        if (value < record.value) {
+            index = record.left;
+        }
+        else if (record.value < value) {
+            index = record.right;
+        }
+        else {
+            return true;
+        }
+    }
+    return false;
+}
+
+template <typename T>
+template <typename Key>
+const T* MappedSet<T>::lower_bound(const Key& value) const {
+    std::uint32_t index = lowerBound(value);
+    return index < count ? &records[index].value : nullptr;
+}
+
+template <typename T>
+template <typename Key, typename F>
+void MappedSet<T>::for_range(const Key& lo, const Key& hi, F fn) const {
+    for (std::size_t i = lowerBound(lo); i < count && !(hi < records[i].value); i++) {
+        fn(records[i].value);
+    }
+}
+
+
+// Numbers the subtree in order starting at next and fills its records;
+// returns the index of node.
+template <typename T>
+template <typename Node>
+std::uint32_t MappedSet<T>::place(const Node* node, const Node* nil, Record* out, std::uint32_t& next) {
+    if (node == nil) {
+        return kNone;
+    }
+    std::uint32_t left = place(static_cast<const Node*>(node->left), nil, out, next);
+    std::uint32_t self = next++;
+    std::uint32_t right = place(static_cast<const Node*>(node->right), nil, out, next);
+
+    std::memcpy(&out[self].value, &node->data, sizeof(T));
+    out[self].left = left;
+    out[self].right = right;
+    return self;
+}
+
+template <typename T>
+template <typename Node>
+void MappedSet<T>::write(const std::string& path, const Node* root, const Node* nil, std::size_t count) {
+    if (count >= kNone) {
+        throw std::length_error("snapshot files hold fewer than 2^32 - 1 elements");
+    }
+
+    // Zeroed first so that padding inside the records is deterministic.
+    std::vector<unsigned char> body(count * sizeof(Record));
+    Record* out = reinterpret_cast<Record*>(body.data());
+    std::uint32_t next = 0;
+    std::uint32_t rootIndex = place(root, nil, out, next);
+
+    Header header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.version = kVersion;
+    header.byteOrder = kByteOrder;
+    header.valueBytes = sizeof(T);
+    header.valueAlign = alignof(T);
+    header.recordBytes = sizeof(Record);
+    header.root = rootIndex;
+    header.count = count;
+    header.checksum = checksum(body.data(), body.size(), rootIndex);
+
+    unsigned char head[kDataOffset] = {};
+    std::memcpy(head, &header, sizeof(header));
+
+    std::string temporary = path + ".tmp";
+    {
+        std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+        file.write(reinterpret_cast<const char*>(head), sizeof(head));
+        file.write(reinterpret_cast<const char*>(body.data()), static_cast<std::streamsize>(body.size()));
+        file.close();
+        if (!file) {
+            std::filesystem::remove(temporary);
+            throw std::system_error(std::make_error_code(std::errc::io_error), path);
+        }
+    }
+    std::filesystem::rename(temporary, path);
+}
+
+
+template <typename Tree>
+template <typename Key, typename F>
+void MappedTree<Tree>::for_range(const Key& lo, const Key& hi, F fn) const {
+    if (!tree) {
+        snapshot.for_range(lo, hi, fn);
+        return;
+    }
+    for (auto it = tree->lower_bound(lo); it != tree->end() && !(hi < *it); ++it) {
+        fn(*it);
+    }
+}
+
+template <typename Tree>
+Tree& MappedTree<Tree>::promote() {
+    if (!tree) {
+        tree.reset(new Tree(sortedUnique, snapshot.begin(), snapshot.end()));
+        snapshot = MappedSet<value_type>();
+    }
+    return *tree;
+}
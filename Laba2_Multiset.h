@@ -0,0 +1,169 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <type_traits>
+#include <utility>
+
+#include "Laba2_AVL.h"
+#include "Laba2_RBT.h"
+
+// Element stored by the multiset adapters: a value and how many copies of
+// it the multiset holds. Ordering looks at the value only, so the trees
+// keep one node per distinct value and lookups take a bare key. count is
+// mutable because the trees hand out const references to their elements;
+// changing it never moves the entry.
+template <typename T, typename Compare>
+struct CountedEntry {
+    T value;
+    mutable std::size_t count;
+
+    CountedEntry() : value(), count(0) {}
+
+    template <typename V, typename = std::enable_if_t<!std::is_same<std::decay_t<V>, CountedEntry>::value>>
+    explicit CountedEntry(V&& value, std::size_t count = 1) : value(std::forward<V>(value)), count(count) {}
+
+    friend bool operator<(const CountedEntry& a, const CountedEntry& b) {
+        return Compare()(a.value, b.value);
+    }
+
+    template <typename Key, typename = std::enable_if_t<!std::is_same<Key, CountedEntry>::value>>
+    friend bool operator<(const CountedEntry& a, const Key& key) {
+        return Compare()(a.value, key);
+    }
+
+    template <typename Key, typename = std::enable_if_t<!std::is_same<Key, CountedEntry>::value>>
+    friend bool operator<(const Key& key, const CountedEntry& b) {
+        return Compare()(key, b.value);
+    }
+};
+
+// Ordered multiset on top of one of the balanced trees. Inserting a value
+// that is already present raises the count in its node instead of adding a
+// node, so memory and depth grow with the number of distinct values, not
+// with the number of insertions. Iteration visits each distinct value once,
+// as an entry with its count. A comparator with is_transparent enables
+// lookups by any type it can compare with T.
+//
+// RBMultiset needs a default-constructible T for the tree's TNULL sentinel.
+template <template <typename, typename, typename, typename> class Engine,
+    typename T, typename Compare, typename Alloc, typename Augment>
+class TreeMultiset {
+public:
+    using key_type = T;
+    using value_type = CountedEntry<T, Compare>;
+    using tree_type = Engine<value_type, Silent, Alloc, Augment>;
+    using const_iterator = typename tree_type::const_iterator;
+    using iterator = const_iterator;
+
+    TreeMultiset() : total(0) {}
+
+    // Add copies of value; return its entry (end() when copies is 0 and
+    // value is absent).
+    iterator insert(const T& value, std::size_t copies = 1) {
+        if (copies == 0) {
+            return tree.find(value);
+        }
+        return add(tree.try_emplace(value, value, copies), copies);
+    }
+
+    iterator insert(T&& value, std::size_t copies = 1) {
+        if (copies == 0) {
+            return tree.find(value);
+        }
+        return add(tree.try_emplace(value, std::move(value), copies), copies);
+    }
+
+    std::size_t count(const T& key) const { return countOf(key); }
+    // Remove one copy of key; return whether there was one.
+    bool erase_one(const T& key) { return eraseOne(key); }
+    // Remove every copy of key; return how many there were.
+    std::size_t erase_all(const T& key) { return eraseAll(key); }
+
+    iterator find(const T& key) const { return tree.find(key); }
+    bool contains(const T& key) const { return tree.search(key); }
+    iterator lower_bound(const T& key) const { return tree.lower_bound(key); }
+    iterator upper_bound(const T& key) const { return tree.upper_bound(key); }
+
+    template <typename Key, typename C = Compare, typename = typename C::is_transparent>
+    std::size_t count(const Key& key) const { return countOf(key); }
+    template <typename Key, typename C = Compare, typename = typename C::is_transparent>
+    bool erase_one(const Key& key) { return eraseOne(key); }
+    template <typename Key, typename C = Compare, typename = typename C::is_transparent>
+    std::size_t erase_all(const Key& key) { return eraseAll(key); }
+    template <typename Key, typename C = Compare, typename = typename C::is_transparent>
+    iterator find(const Key& key) const { return tree.find(key); }
+    template <typename Key, typename C = Compare, typename = typename C::is_transparent>
+    bool contains(const Key& key) const { return tree.search(key); }
+    template <typename Key, typename C = Compare, typename = typename C::is_transparent>
+    iterator lower_bound(const Key& key) const { return tree.lower_bound(key); }
+    template <typename Key, typename C = Compare, typename = typename C::is_transparent>
+    iterator upper_bound(const Key& key) const { return tree.upper_bound(key); }
+
+    iterator begin() const { return tree.begin(); }
+    iterator end() const { return tree.end(); }
+    // Elements counting every copy, and distinct values (nodes).
+    std::size_t size() const { return total; }
+    std::size_t distinct() const { return tree.size(); }
+    bool empty() const { return total == 0; }
+    void clear() {
+        tree.clear();
+        total = 0;
+    }
+
+    // The underlying tree, for the order statistics and traversals; those
+    // count distinct values, not copies.
+    const tree_type& base() const { return tree; }
+
+private:
+    iterator add(std::pair<iterator, bool> result, std::size_t copies) {
+        if (!result.second) {
+            result.first->count += copies;
+        }
+        total += copies;
+        return result.first;
+    }
+
+    template <typename Key>
+    std::size_t countOf(const Key& key) const {
+        iterator it = tree.find(key);
+        return it == tree.end() ? 0 : it->count;
+    }
+
+    template <typename Key>
+    bool eraseOne(const Key& key) {
+        iterator it = tree.find(key);
+        if (it == tree.end()) {
+            return false;
+        }
+        if (it->count > 1) {
+            it->count--;
+        }
+        else {
+            tree.remove(key);
+        }
+        total--;
+        return true;
+    }
+
+    template <typename Key>
+    std::size_t eraseAll(const Key& key) {
+        iterator it = tree.find(key);
+        if (it == tree.end()) {
+            return 0;
+        }
+        std::size_t copies = it->count;
+        tree.remove(key);
+        total -= copies;
+        return copies;
+    }
+
+    tree_type tree;
+    std::size_t total;
+};
+
+template <typename T, typename Compare = std::less<T>, typename Alloc = HeapNodes, typename Augment = NoAugment>
+using AVLMultiset = TreeMultiset<AVLTree, T, Compare, Alloc, Augment>;
+
+template <typename T, typename Compare = std::less<T>, typename Alloc = HeapNodes, typename Augment = NoAugment>
+using RBMultiset = TreeMultiset<RBTree, T, Compare, Alloc, Augment>;
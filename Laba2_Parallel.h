@@ -0,0 +1,282 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Work-stealing fork-join pool for the join-based tree algorithms.
+//
+// invoke(f, g) offers g to other threads and runs f itself; if nobody took
+// g it runs g too, otherwise it executes queued tasks until g is finished.
+// Tasks live on the stack of the forking thread, so nothing is allocated
+// per fork. A thread outside the pool may call invoke(); it then shares one
+// extra queue with other outside callers and helps the same way.
+class ForkJoinPool {
+public:
+    // threads is the total parallelism including the calling thread;
+    // 0 means std::thread::hardware_concurrency().
+    explicit ForkJoinPool(unsigned threads = 0);
+    ~ForkJoinPool();
+
+    ForkJoinPool(const ForkJoinPool&) = delete;
+    ForkJoinPool& operator=(const ForkJoinPool&) = delete;
+
+    // Process-wide pool sized to the machine, started on first use.
+    static ForkJoinPool& shared();
+
+    unsigned size() const { return static_cast<unsigned>(workers.size()) + 1; }
+
+    template <typename F, typename G>
+    void invoke(F&& f, G&& g);
+
+private:
+    struct Task {
+        void (*run)(Task*);
+        std::atomic<bool> done{ false };
+        std::exception_ptr error;
+    };
+
+    template <typename G>
+    struct TaskOf : Task {
+        G* body;
+        explicit TaskOf(G* body) : body(body) { this->run = &TaskOf::execute; }
+        static void execute(Task* task) {
+            try {
+                (*static_cast<TaskOf*>(task)->body)();
+            }
+            catch (...) {
+                task->error = std::current_exception();
+            }
+            task->done.store(true, std::memory_order_release);
+        }
+    };
+
+    struct Queue {
+        std::mutex lock;
+        std::deque<Task*> tasks;
+    };
+
+    std::vector<std::thread> workers;
+    std::unique_ptr<Queue[]> queues;  // one per worker, the last for outside callers
+    std::size_t queueCount;
+
+    std::mutex sleepLock;
+    std::condition_variable wake;
+    std::atomic<std::size_t> pending{ 0 };
+    std::atomic<unsigned> sleeping{ 0 };
+    bool stopping = false;
+
+    Queue& ownQueue();
+    void push(Task* task);
+    bool popOwn(Task* task);
+    Task* steal(std::size_t start);
+    void workerLoop(std::size_t index);
+
+    static thread_local const ForkJoinPool* currentPool;
+    static thread_local std::size_t currentIndex;
+};
+
+// std::execution-style policy tag for the tree operations that can run in
+// parallel. Subtrees of fewer than cutoff elements are handled serially.
+struct Parallel {
+    ForkJoinPool* pool = nullptr;  // nullptr: ForkJoinPool::shared()
+    std::size_t cutoff = std::size_t(1) << 12;
+
+    ForkJoinPool& resolve() const { return pool ? *pool : ForkJoinPool::shared(); }
+};
+constexpr Parallel parallel{};
+
+inline int log2Floor(std::size_t n) {
+    int log = 0;
+    while (n > 1) {
+        n >>= 1;
+        log++;
+    }
+    return log;
+}
+
+// What a tree algorithm needs to fork: where to, below which subtree height
+// (roughly log2 of its size) to stay serial, and the lock guarding a node
+// pool that cannot be used from several threads. The default runs serially.
+struct ForkContext {
+    ForkJoinPool* pool = nullptr;
+    int minHeight = 0;
+    std::mutex* lock = nullptr;
+
+    ForkContext() = default;
+    ForkContext(const Parallel& policy, std::mutex* poolLock)
+        : pool(&policy.resolve()), minHeight(log2Floor(policy.cutoff)), lock(poolLock) {
+    }
+
+    template <typename F, typename G>
+    void invoke(int height, F&& f, G&& g) const {
+        if (pool && height >= minHeight) {
+            pool->invoke(std::forward<F>(f), std::forward<G>(g));
+        }
+        else {
+            f();
+            g();
+        }
+    }
+
+    template <typename F>
+    void locked(F&& f) const {
+        if (lock) {
+            std::lock_guard<std::mutex> guard(*lock);
+            f();
+        }
+        else {
+            f();
+        }
+    }
+};
+
+
+inline thread_local const ForkJoinPool* ForkJoinPool::currentPool = nullptr;
+inline thread_local std::size_t ForkJoinPool::currentIndex = 0;
+
+inline ForkJoinPool::ForkJoinPool(unsigned threads) {
+    if (threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    queueCount = threads;
+    queues.reset(new Queue[queueCount]);
+    for (std::size_t i = 0; i + 1 < threads; i++) {
+        workers.emplace_back(&ForkJoinPool::workerLoop, this, i);
+    }
+}
+
+inline ForkJoinPool::~ForkJoinPool() {
+    {
+        std::lock_guard<std::mutex> guard(sleepLock);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+}
+
+inline ForkJoinPool& ForkJoinPool::shared() {
+    static ForkJoinPool pool;
+    return pool;
+}
+
+inline ForkJoinPool::Queue& ForkJoinPool::ownQueue() {
+    return currentPool == this ? queues[currentIndex] : queues[queueCount - 1];
+}
+
+inline void ForkJoinPool::push(Task* task) {
+    Queue& queue = ownQueue();
+    {
+        std::lock_guard<std::mutex> guard(queue.lock);
+        queue.tasks.push_back(task);
+    }
+    pending.fetch_add(1);
+    if (sleeping.load() > 0) {
+        { std::lock_guard<std::mutex> guard(sleepLock); }
+        wake.notify_one();
+    }
+}
+
+// Takes task back if it is still the newest entry of this thread's queue.
+inline bool ForkJoinPool::popOwn(Task* task) {
+    Queue& queue = ownQueue();
+    std::lock_guard<std::mutex> guard(queue.lock);
+    if (!queue.tasks.empty() && queue.tasks.back() == task) {
+        queue.tasks.pop_back();
+        pending.fetch_sub(1, std::memory_order_relaxed);
+        return true;
+    }
+    return false;
+}
+
+// Oldest task of any queue, scanning from start; the oldest tasks are the
+// biggest subproblems.
+inline ForkJoinPool::Task* ForkJoinPool::steal(std::size_t start) {
+    for (std::size_t i = 0; i < queueCount; i++) {
+        Queue& queue = queues[(start + i) % queueCount];
+        std::lock_guard<std::mutex> guard(queue.lock);
+        if (!queue.tasks.empty()) {
+            Task* task = queue.tasks.front();
+            queue.tasks.pop_front();
+            pending.fetch_sub(1, std::memory_order_relaxed);
+            return task;
+        }
+    }
+    return nullptr;
+}
+
+inline void ForkJoinPool::workerLoop(std::size_t index) {
+    currentPool = this;
+    currentIndex = index;
+
+    for (;;) {
+        if (Task* task = steal(index)) {
+            task->run(task);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> guard(sleepLock);
+        sleeping.fetch_add(1);
+        wake.wait(guard, [this] { return stopping || pending.load() > 0; });
+        sleeping.fetch_sub(1);
+        if (stopping) {
+            return;
+        }
+    }
+}
+
+template <typename F, typename G>
+void ForkJoinPool::invoke(F&& f, G&& g) {
+    if (workers.empty()) {
+        f();
+        g();
+        return;
+    }
+
+    TaskOf<std::remove_reference_t<G>> task(&g);
+    push(&task);
+
+    std::exception_ptr error;
+    try {
+        f();
+    }
+    catch (...) {
+        error = std::current_exception();
+    }
+
+    if (popOwn(&task)) {
+        if (error) {
+            std::rethrow_exception(error);
+        }
+        g();
+        return;
+    }
+
+    std::size_t start = currentPool == this ? currentIndex : queueCount - 1;
+    while (!task.done.load(std::memory_order_acquire)) {
+        if (Task* other = steal(start)) {
+            other->run(other);
+        }
+        else {
+            std::this_thread::yield();
+        }
+    }
+
+    if (error) {
+        std::rethrow_exception(error);
+    }
+    if (task.error) {
+        std::rethrow_exception(task.error);
+    }
+}
@@ -0,0 +1,137 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+// Hardware event counts of the calling thread over a region of code, read
+// through Linux perf_event_open(2) with kernel and hypervisor time excluded.
+//
+// Each event is opened on its own rather than as a group, so one the CPU
+// lacks does not take the others down with it; when the kernel has to
+// multiplex them, counts are scaled by enabled / running time. Opening can
+// fail as a whole (perf_event_paranoid above 2, a VM without a PMU, another
+// OS), in which case available() is false and start()/stop() do nothing.
+class PerfCounters {
+public:
+    enum Event { CYCLES, INSTRUCTIONS, L1D_MISSES, LLC_MISSES, BRANCH_MISSES, DTLB_MISSES, EVENT_COUNT };
+
+    PerfCounters();
+    ~PerfCounters();
+
+    PerfCounters(const PerfCounters&) = delete;
+    PerfCounters& operator=(const PerfCounters&) = delete;
+
+    bool available() const;
+    static const char* name(Event event);
+
+    void start();
+    void stop();
+    // Count over the last start() / stop(); negative when the event could
+    // not be opened or never got a hardware counter.
+    double value(Event event) const { return values[event]; }
+
+private:
+    int fds[EVENT_COUNT];
+    double values[EVENT_COUNT];
+};
+
+
+inline const char* PerfCounters::name(Event event) {
+    static const char* const names[EVENT_COUNT] = {
+        "cycles", "instructions", "l1d_misses", "llc_misses", "branch_misses", "dtlb_misses"
+    };
+    return names[event];
+}
+
+inline bool PerfCounters::available() const {
+    for (int fd : fds) {
+        if (fd >= 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+#ifdef __linux__
+
+inline PerfCounters::PerfCounters() {
+    auto cacheMiss = [](std::uint64_t cache) {
+        return cache | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+    };
+    const std::uint32_t types[EVENT_COUNT] = {
+        PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE, PERF_TYPE_HW_CACHE,
+        PERF_TYPE_HW_CACHE, PERF_TYPE_HARDWARE, PERF_TYPE_HW_CACHE
+    };
+    const std::uint64_t configs[EVENT_COUNT] = {
+        PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS, cacheMiss(PERF_COUNT_HW_CACHE_L1D),
+        cacheMiss(PERF_COUNT_HW_CACHE_LL), PERF_COUNT_HW_BRANCH_MISSES, cacheMiss(PERF_COUNT_HW_CACHE_DTLB)
+    };
+
+    for (int i = 0; i < EVENT_COUNT; i++) {
+        perf_event_attr attr;
+        std::memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = types[i];
+        attr.config = configs[i];
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+        fds[i] = static_cast<int>(::syscall(SYS_perf_event_open, &attr, 0, -1, -1, PERF_FLAG_FD_CLOEXEC));
+        values[i] = -1.0;
+    }
+}
+
+inline PerfCounters::~PerfCounters() {
+    for (int fd : fds) {
+        if (fd >= 0) {
+            ::close(fd);
+        }
+    }
+}
+
+inline void PerfCounters::start() {
+    for (int fd : fds) {
+        if (fd >= 0) {
+            ::ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+            ::ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+        }
+    }
+}
+
+inline void PerfCounters::stop() {
+    for (int fd : fds) {
+        if (fd >= 0) {
+            ::ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+        }
+    }
+    for (int i = 0; i < EVENT_COUNT; i++) {
+        values[i] = -1.0;
+        std::uint64_t reading[3];  // value, time enabled, time running
+        if (fds[i] >= 0 && ::read(fds[i], reading, sizeof(reading)) == static_cast<ssize_t>(sizeof(reading)) && reading[2] > 0) {
+            values[i] = static_cast<double>(reading[0]) * static_cast<double>(reading[1]) / static_cast<double>(reading[2]);
+        }
+    }
+}
+
+#else
+
+inline PerfCounters::PerfCounters() {
+    for (int i = 0; i < EVENT_COUNT; i++) {
+        fds[i] = -1;
+        values[i] = -1.0;
+    }
+}
+
+inline PerfCounters::~PerfCounters() {}
+inline void PerfCounters::start() {}
+inline void PerfCounters::stop() {}
+
+#endif
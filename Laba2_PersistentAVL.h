@@ -0,0 +1,412 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+// AVL tree with O(1) snapshots.
+//
+// Nodes are reference counted and shared between versions, so they carry
+// no parent pointer. A write copies a node only when it is shared with a
+// snapshot (refs > 1); rotateLeft(), rotateRight() and balance() go
+// through the same check, so only the O(log n) path to the change is
+// copied and a tree without live snapshots is updated in place.
+//
+// Writes and snapshot() are serialized by an internal mutex. A Snapshot is
+// an immutable version that any thread may read without locks while the
+// writer keeps going; its nodes are freed by whoever drops the last
+// reference, writer or reader.
+template <typename T>
+class PersistentAVLTree {
+private:
+    struct Node {
+        T data;
+        Node* left;
+        Node* right;
+        int height;
+        mutable std::atomic<std::uint32_t> refs;
+
+        template <typename... Args>
+        explicit Node(Args&&... args)
+            : data(std::forward<Args>(args)...), left(nullptr), right(nullptr), height(1), refs(1) {
+        }
+    };
+
+    static constexpr int kMaxHeight = 96;
+
+    Node* root;
+    std::size_t nodeCount;
+    mutable std::mutex writeLock;
+
+public:
+    class const_iterator;
+    class Snapshot;
+
+    PersistentAVLTree() : root(nullptr), nodeCount(0) {}
+    ~PersistentAVLTree() { release(root); }
+
+    PersistentAVLTree(const PersistentAVLTree&) = delete;
+    PersistentAVLTree& operator=(const PersistentAVLTree&) = delete;
+
+    bool insert(const T& value);
+    template <typename Key>
+    bool remove(const Key& value);
+    void clear();
+
+    // The current version; O(1), safe to call while other threads write.
+    Snapshot snapshot() const;
+
+    // Reads of the live tree belong to the writer's thread; other threads
+    // read through a snapshot.
+    template <typename Key>
+    bool search(const Key& value) const { return lookup(root, value); }
+    std::size_t size() const { return nodeCount; }
+    bool isEmpty() const { return root == nullptr; }
+    int getTreeHeight() const { return getHeight(root); }
+
+    const_iterator begin() const { return const_iterator(root); }
+    const_iterator end() const { return const_iterator(); }
+
+private:
+    static int getHeight(const Node* node) { return node ? node->height : 0; }
+    static int getBalanceFactor(const Node* node) { return getHeight(node->left) - getHeight(node->right); }
+    static void updateHeight(Node* node);
+
+    static const Node* retain(const Node* node);
+    static void release(const Node* node);
+    static Node* own(Node* node);
+
+    Node* rotateRight(Node* y);
+    Node* rotateLeft(Node* x);
+    Node* balance(Node* node);
+    Node* insertAt(Node* node, const T& value);
+    template <typename Key>
+    Node* removeAt(Node* node, const Key& key);
+    Node* removeMin(Node* node, Node*& min);
+
+    template <typename Key>
+    static bool lookup(const Node* node, const Key& key);
+    template <typename Key, typename F>
+    static void forRange(const Node* node, const Key& lo, const Key& hi, F& fn);
+};
+
+
+// In-order iterator over one version; it holds a path stack instead of
+// following parent pointers, which shared nodes do not have.
+template <typename T>
+class PersistentAVLTree<T>::const_iterator {
+public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = T;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const T*;
+    using reference = const T&;
+
+    const_iterator() = default;
+
+    reference operator*() const { return path.back()->data; }
+    pointer operator->() const { return &path.back()->data; }
+
+    const_iterator& operator++() {
+        const Node* node = path.back();
+        path.pop_back();
+        pushLeft(node->right);
+        return *this;
+    }
+    const_iterator operator++(int) { const_iterator old = *this; ++*this; return old; }
+
+    bool operator==(const const_iterator& other) const {
+        return path.empty() ? other.path.empty() : !other.path.empty() && path.back() == other.path.back();
+    }
+    bool operator!=(const const_iterator& other) const { return !(*this == other); }
+
+private:
+    friend class PersistentAVLTree;
+    explicit const_iterator(const Node* root) {
+        path.reserve(kMaxHeight);
+        pushLeft(root);
+    }
+
+    void pushLeft(const Node* node) {
+        for (; node; node = node->left) {
+            path.push_back(node);
+        }
+    }
+
+    std::vector<const Node*> path;
+};
+
+// An immutable version of the tree. Copying shares it in O(1).
+template <typename T>
+class PersistentAVLTree<T>::Snapshot {
+public:
+    Snapshot() : root(nullptr), count(0) {}
+    Snapshot(const Snapshot& other) : root(retain(other.root)), count(other.count) {}
+    Snapshot(Snapshot&& other) noexcept : root(other.root), count(other.count) { other.root = nullptr; other.count = 0; }
+    ~Snapshot() { release(root); }
+
+    Snapshot& operator=(Snapshot other) {
+        std::swap(root, other.root);
+        std::swap(count, other.count);
+        return *this;
+    }
+
+    template <typename Key>
+    bool search(const Key& value) const { return lookup(root, value); }
+    std::size_t size() const { return count; }
+    bool isEmpty() const { return root == nullptr; }
+
+    const_iterator begin() const { return const_iterator(root); }
+    const_iterator end() const { return const_iterator(); }
+
+    // Calls fn on every element in [lo, hi] in ascending order.
+    template <typename Key, typename F>
+    void for_range(const Key& lo, const Key& hi, F fn) const { forRange(root, lo, hi, fn); }
+
+private:
+    friend class PersistentAVLTree;
+    Snapshot(const Node* root, std::size_t count) : root(root), count(count) {}
+
+    const Node* root;
+    std::size_t count;
+};
+
+
+template <typename T>
+void PersistentAVLTree<T>::updateHeight(Node* node) {
+    node->height = std::max(getHeight(node->left), getHeight(node->right)) + 1;
+}
+
+template <typename T>
+const typename PersistentAVLTree<T>::Node* PersistentAVLTree<T>::retain(const Node* node) {
+    if (node) {
+        node->refs.fetch_add(1, std::memory_order_relaxed);
+    }
+    return node;
+}
+
+template <typename T>
+void PersistentAVLTree<T>::release(const Node* node) {
+    while (node && node->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        release(node->left);
+        const Node* right = node->right;
+        delete node;
+        node = right;
+    }
+}
+
+// Returns node itself when this reference is the only one, otherwise a
+// private copy sharing its children; either way the caller may modify it.
+template <typename T>
+typename PersistentAVLTree<T>::Node* PersistentAVLTree<T>::own(Node* node) {
+    if (node->refs.load(std::memory_order_acquire) == 1) {
+        return node;
+    }
+
+    Node* copy = new Node(node->data);
+    copy->left = const_cast<Node*>(retain(node->left));
+    copy->right = const_cast<Node*>(retain(node->right));
+    copy->height = node->height;
+    release(node);
+    return copy;
+}
+
+
+template <typename T>
+typename PersistentAVLTree<T>::Node* PersistentAVLTree<T>::rotateRight(Node* y) {
+    y = own(y);
+    Node* x = own(y->left);
+
+    y->left = x->right;
+    x->right = y;
+
+    updateHeight(y);
+    updateHeight(x);
+    return x;
+}
+
+template <typename T>
+typename PersistentAVLTree<T>::Node* PersistentAVLTree<T>::rotateLeft(Node* x) {
+    x = own(x);
+    Node* y = own(x->right);
+
+    x->right = y->left;
+    y->left = x;
+
+    updateHeight(x);
+    updateHeight(y);
+    return y;
+}
+
+template <typename T>
+typename PersistentAVLTree<T>::Node* PersistentAVLTree<T>::balance(Node* node) {
+    node = own(node);
+    updateHeight(node);
+    int balanceFactor = getBalanceFactor(node);
+
+    if (balanceFactor > 1) {
+        if (getBalanceFactor(node->left) < 0) {
+            node->left = rotateLeft(node->left);
+        }
+        return rotateRight(node);
+    }
+
+    if (balanceFactor < -1) {
+        if (getBalanceFactor(node->right) > 0) {
+            node->right = rotateRight(node->right);
+        }
+        return rotateLeft(node);
+    }
+
+    return node;
+}
+
+
+// Each takes over the caller's reference to node and returns a reference
+// to the new subtree.
+template <typename T>
+typename PersistentAVLTree<T>::Node* PersistentAVLTree<T>::insertAt(Node* node, const T& value) {
+    if (!node) {
+        return new Node(value);
+    }
+
+    node = own(node);
+    if (value < node->data) {
+        node->left = insertAt(node->left, value);
+    }
+    else {
+        node->right = insertAt(node->right, value);
+    }
+    return balance(node);
+}
+
+template <typename T>
+typename PersistentAVLTree<T>::Node* PersistentAVLTree<T>::removeMin(Node* node, Node*& min) {
+    node = own(node);
+    if (!node->left) {
+        Node* right = node->right;
+        node->right = nullptr;
+        min = node;
+        return right;
+    }
+    node->left = removeMin(node->left, min);
+    return balance(node);
+}
+
+template <typename T>
+template <typename Key>
+typename PersistentAVLTree<T>::Node* PersistentAVLTree<T>::removeAt(Node* node, const Key& key) {
+    node = own(node);
+
+    if (key < node->data) {
+        node->left = removeAt(node->left, key);
+    }
+    else if (node->data < key) {
+        node->right = removeAt(node->right, key);
+    }
+    else {
+        Node* left = node->left;
+        Node* right = node->right;
+        node->left = node->right = nullptr;
+        release(node);
+
+        if (!left || !right) {
+            return left ? left : right;
+        }
+
+        Node* min;
+        right = removeMin(right, min);
+        min->left = left;
+        min->right = right;
+        node = min;
+    }
+    return balance(node);
+}
+
+template <typename T>
+bool PersistentAVLTree<T>::insert(const T& value) {
+    std::lock_guard<std::mutex> lock(writeLock);
+    if (lookup(root, value)) {
+        return false;
+    }
+    root = insertAt(root, value);
+    nodeCount++;
+    return true;
+}
+
+template <typename T>
+template <typename Key>
+bool PersistentAVLTree<T>::remove(const Key& value) {
+    std::lock_guard<std::mutex> lock(writeLock);
+    if (!lookup(root, value)) {
+        return false;
+    }
+    root = removeAt(root, value);
+    nodeCount--;
+    return true;
+}
+
+template <typename T>
+void PersistentAVLTree<T>::clear() {
+    std::lock_guard<std::mutex> lock(writeLock);
+    release(root);
+    root = nullptr;
+    nodeCount = 0;
+}
+
+template <typename T>
+typename PersistentAVLTree<T>::Snapshot PersistentAVLTree<T>::snapshot() const {
+    std::lock_guard<std::mutex> lock(writeLock);
+    return Snapshot(retain(root), nodeCount);
+}
+
+
+template <typename T>
+template <typename Key>
+bool PersistentAVLTree<T>::lookup(const Node* node, const Key& key) {
+    while (node) {
+        if (key < node->data) {
+            node = node->left;
+        }
+        else if (node->data < key) {
+            node = node->right;
+        }
+        else {
+            return true;
+        }
+    }
+    return false;
+}
+
+template <typename T>
+template <typename Key, typename F>
+void PersistentAVLTree<T>::forRange(const Node* node, const Key& lo, const Key& hi, F& fn) {
+    const Node* stack[kMaxHeight];
+    int depth = 0;
+
+    while (node) {
+        if (node->data < lo) {
+            node = node->right;
+        }
+        else {
+            stack[depth++] = node;
+            node = node->left;
+        }
+    }
+
+    while (depth > 0) {
+        node = stack[--depth];
+        if (hi < node->data) {
+            return;
+        }
+        fn(node->data);
+        for (node = node->right; node; node = node->left) {
+            stack[depth++] = node;
+        }
+    }
+}
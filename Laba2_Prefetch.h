@@ -0,0 +1,17 @@
+#pragma once
+
+#if !defined(__GNUC__) && (defined(_M_X64) || defined(_M_IX86))
+#include <xmmintrin.h>
+#endif
+
+// Asks for the cache line at address to be loaded ahead of a read; a no-op
+// where the compiler offers no way to say so.
+inline void prefetchRead(const void* address) {
+#if defined(__GNUC__)
+    __builtin_prefetch(address);
+#elif defined(_M_X64) || defined(_M_IX86)
+    _mm_prefetch(static_cast<const char*>(address), _MM_HINT_T0);
+#else
+    (void)address;
+#endif
+}
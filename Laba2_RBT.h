@@ -0,0 +1,2036 @@
+#pragma once
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+#include "Laba2_Trace.h"
+#include "Laba2_Alloc.h"
+#include "Laba2_Bulk.h"
+#include "Laba2_Augment.h"
+#include "Laba2_Parallel.h"
+#include "Laba2_Frozen.h"
+#include "Laba2_Mapped.h"
+#include "Laba2_Prefetch.h"
+
+enum Color { RED, BLACK };
+
+template <typename T, typename Trace = Silent, typename Alloc = HeapNodes, typename Augment = NoAugment>
+class RBTree {
+private:
+    struct Node : Augment::Field {
+        using Link = typename Alloc::template Link<Node>;
+
+        T data;
+        Link left;
+        Link right;
+
+        template <typename... Args>
+        explicit Node(Args&&... args)
+            : data(std::forward<Args>(args)...), left(nullptr), right(nullptr) {
+        }
+
+        Node* parent() const { return parentAndColor.get(); }
+        Color color() const { return static_cast<Color>(parentAndColor.tag()); }
+        void setParent(Node* node) { parentAndColor.set(node); }
+        void setColor(Color color) { parentAndColor.setTag(color); }
+
+    private:
+        // The color rides in the spare bit of the parent link.
+        typename Alloc::template TaggedLink<Node> parentAndColor;
+    };
+
+    using NodePool = typename Alloc::template Pool<Node>;
+    static constexpr bool bulkClear = NodePool::bulkRelease && std::is_trivially_destructible<T>::value;
+
+    Node* root;
+    Node* TNULL;  
+    std::size_t nodeCount;
+    NodePool pool;
+    mutable std::conditional_t<Trace::counting, TreeStats, NoStats> counters;
+
+private:
+    std::size_t clear(Node* node);
+    void initializeNULLNode();
+
+    void leftRotate(Node* x);
+    void rightRotate(Node* x);
+    void fixInsert(Node* k);
+    void fixDelete(Node* x);
+    void transplant(Node* u, Node* v);
+    void updateSize(Node* node);
+
+    template <typename... Args>
+    Node* createNode(Args&&... args);
+    template <typename It>
+    Node* build(It& it, std::size_t n, int depth, int redDepth);
+
+    // Join-based building blocks work on subtrees paired with their black
+    // height (black nodes on a path down to TNULL, the root included), so
+    // joins never have to measure it. Roots may be red; the parent of a
+    // returned root is left unspecified.
+    struct Subtree {
+        Node* root;
+        int blackHeight;
+    };
+
+    Node* link(Node* left, Node* node, Node* right);
+    Subtree joinNodes(Subtree left, Node* node, Subtree right);
+    Node* joinRight(Node* left, int leftHeight, Node* node, Subtree right);
+    Node* joinLeft(Subtree left, Node* node, Node* right, int rightHeight);
+    Subtree join2(Subtree left, Subtree right);
+    Subtree splitLast(Subtree tree, Node*& last);
+    template <typename Key>
+    void splitNodes(Subtree tree, const Key& key, Subtree& left, Node*& found, Subtree& right);
+    Subtree unite(Subtree a, Subtree b, Subtree* dups, std::size_t& dupCount, const ForkContext& fork);
+    Subtree intersect(Subtree a, Subtree b, std::size_t& dropped, const ForkContext& fork);
+    Subtree subtract(Subtree a, Subtree b, std::size_t& dropped, const ForkContext& fork);
+    template <typename Pred>
+    Subtree filterNodes(Subtree tree, Pred& pred, std::size_t& dropped, const ForkContext& fork);
+    template <typename It>
+    Subtree uniteSorted(Subtree tree, It first, It last, std::size_t& added);
+    template <typename It>
+    Subtree subtractSorted(Subtree tree, It first, It last, std::size_t& removed);
+    template <typename It>
+    Node* build(It first, std::size_t n, int depth, int redDepth, const ForkContext& fork);
+    void dispose(Node* node, const ForkContext& fork);
+    std::size_t discard(Node* node, const ForkContext& fork);
+    Subtree adoptFrom(RBTree& other, const ForkContext& fork);
+    void relink(Subtree tree, Node* oldNull, const ForkContext& fork);
+    void takeSentinel(Node* sentinel, const ForkContext& fork);
+    Node* transfer(Node* node, RBTree& to);
+    void setRoot(Node* node);
+
+    void union_with(RBTree& other, const ForkContext& fork);
+    void intersect_with(RBTree& other, const ForkContext& fork);
+    void difference_with(RBTree& other, const ForkContext& fork);
+    template <typename Pred>
+    void filter(Pred& pred, const ForkContext& fork);
+
+    static constexpr std::size_t kBatchLanes = 16;
+    template <typename Key, typename F>
+    void lookupBatch(const Key* keys, std::size_t n, F done) const;
+    template <bool KeepRight, typename GoLeft>
+    const Node* bound(GoLeft goLeft) const;
+    template <typename Key>
+    Node* descend(const Key& key, Node*& parent) const;
+    Node* attach(Node* newNode, Node* parent);
+    template <typename Key>
+    Node* remove(Node* node, const Key& value);
+    Node* minimum(Node* node);
+    template <typename Key>
+    Node* searchTreeHelper(Node* node, const Key& value) const;
+
+    const Node* minNode(const Node* node) const;
+    const Node* maxNode(const Node* node) const;
+    const Node* nextNode(const Node* node) const;
+    const Node* prevNode(const Node* node) const;
+    int checkNode(const Node* node, const Node* parent, const Node*& prev, std::size_t& count) const;
+
+    void inorder(Node* node) const;
+    void preorder(Node* node) const;
+    void postorder(Node* node) const;
+
+    
+    void printTreeHelper(Node* node, int space, bool last) const;
+    int getBlackHeight(Node* node) const;
+    int getHeight(Node* node) const;
+
+public:
+    RBTree();
+    ~RBTree();
+
+    template <typename It>
+    RBTree(It first, It last, unsigned threads = 1) : RBTree() { assign(first, last, threads); }
+    template <typename It>
+    RBTree(SortedUnique, It first, It last) : RBTree() { assign(sortedUnique, first, last); }
+
+    // Bytes allocated per element, before allocator overhead.
+    static constexpr std::size_t nodeBytes = sizeof(Node);
+
+    // Bidirectional in-order iterator over the parent links; end() holds nullptr.
+    class const_iterator {
+    public:
+        using iterator_category = std::bidirectional_iterator_tag;
+        using value_type = T;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const T*;
+        using reference = const T&;
+
+        const_iterator() : node(nullptr), tree(nullptr) {}
+
+        reference operator*() const { return node->data; }
+        pointer operator->() const { return &node->data; }
+
+        const_iterator& operator++() { node = tree->nextNode(node); return *this; }
+        const_iterator operator++(int) { const_iterator old = *this; ++*this; return old; }
+        const_iterator& operator--() { node = node ? tree->prevNode(node) : tree->maxNode(tree->root); return *this; }
+        const_iterator operator--(int) { const_iterator old = *this; --*this; return old; }
+
+        bool operator==(const const_iterator& other) const { return node == other.node; }
+        bool operator!=(const const_iterator& other) const { return node != other.node; }
+
+    private:
+        friend class RBTree;
+        const_iterator(const Node* node, const RBTree* tree) : node(node), tree(tree) {}
+
+        const Node* node;
+        const RBTree* tree;
+    };
+
+    using iterator = const_iterator;
+    using reverse_iterator = std::reverse_iterator<const_iterator>;
+    using const_reverse_iterator = reverse_iterator;
+
+    void insert(const T& value);
+    void insert(T&& value);
+    template <typename Key>
+    void remove(const Key& value);
+    template <typename Key>
+    bool search(const Key& value) const;
+
+    // emplace() builds the element first and drops it if an equivalent one
+    // exists; try_emplace() looks key up first and builds the element from
+    // args only when it is absent.
+    template <typename... Args>
+    std::pair<const_iterator, bool> emplace(Args&&... args);
+    template <typename Key, typename... Args>
+    std::pair<const_iterator, bool> try_emplace(const Key& key, Args&&... args);
+
+    const_iterator begin() const { return const_iterator(minNode(root), this); }
+    const_iterator end() const { return const_iterator(nullptr, this); }
+    const_reverse_iterator rbegin() const { return const_reverse_iterator(end()); }
+    const_reverse_iterator rend() const { return const_reverse_iterator(begin()); }
+
+    // Many independent lookups at once; out[i] answers keys[i]. Up to
+    // kBatchLanes descents are in flight together: each step moves one of
+    // them down a level and prefetches the node it lands on, then turns to
+    // the next, so the cache misses of different keys overlap.
+    template <typename Key>
+    void contains_batch(const Key* keys, std::size_t n, bool* out) const;
+    template <typename Key>
+    void find_batch(const Key* keys, std::size_t n, const_iterator* out) const;
+
+    template <typename Key>
+    const_iterator find(const Key& value) const;
+    template <typename Key>
+    const_iterator lower_bound(const Key& value) const;
+    template <typename Key>
+    const_iterator upper_bound(const Key& value) const;
+    // Largest element <= value / smallest >= value; end() when there is none.
+    template <typename Key>
+    const_iterator floor(const Key& value) const;
+    template <typename Key>
+    const_iterator ceiling(const Key& value) const { return lower_bound(value); }
+    // Largest element < value / smallest > value; end() when there is none.
+    template <typename Key>
+    const_iterator predecessor(const Key& value) const;
+    template <typename Key>
+    const_iterator successor(const Key& value) const { return upper_bound(value); }
+
+    // Order statistics; these need the SubtreeSize augmentation.
+    // rank() counts the elements < value, select() returns the k-th smallest
+    // (0-based, end() when k >= size()), count_range() counts [lo, hi].
+    template <typename Key>
+    std::size_t rank(const Key& value) const;
+    const_iterator select(std::size_t k) const;
+    template <typename Key>
+    std::size_t count_range(const Key& lo, const Key& hi) const;
+
+    // Read-only copy of the current contents in a cache-friendly layout.
+    FrozenSet<T> freeze() const { return FrozenSet<T>(sortedUnique, begin(), nodeCount); }
+
+    // Snapshot file of the current contents (trivially copyable T only),
+    // see MappedSet. open_mapped() serves reads from the file in place and
+    // builds the tree only on the first write.
+    void save(const std::string& path) const { MappedSet<T>::template write<Node>(path, root, TNULL, nodeCount); }
+    static MappedTree<RBTree> open_mapped(const std::string& path, bool verify = true) {
+        return MappedTree<RBTree>(MappedSet<T>(path, verify));
+    }
+
+    void displayInorder() const;
+    void displayPreorder() const;
+    void displayPostorder() const;
+    void displayTree() const;
+
+    bool isEmpty() const { return root == TNULL; }
+    std::size_t size() const { return nodeCount; }
+    void clear();
+
+    template <typename It>
+    void assign(It first, It last, unsigned threads = 1);
+    template <typename It>
+    void assign(SortedUnique, It first, It last);
+
+    // join() appends key and then every element of right, all of which must
+    // be greater than the elements here; right is left empty. split()
+    // keeps the elements < key, moves those > key into right (replacing its
+    // contents) and drops key itself, returning whether it was present. For
+    // both, right must be another tree (std::invalid_argument otherwise).
+    //
+    // Leaves point at their tree's TNULL, so the nodes of the smaller side
+    // have to be repointed: join() is O(log n + min(n, m)) for sizes n and
+    // m. split() is O(log n + min(|left|, |right|)) for transferable pools
+    // (HeapNodes), counting the smaller half as well when there is no
+    // SubtreeSize; other pools copy every moved element into right's pool.
+    void join(const T& key, RBTree& right);
+    template <typename Key>
+    bool split(const Key& key, RBTree& right);
+
+    // Set algebra in O(m log(n/m + 1)) for sizes m <= n, whichever of the
+    // two trees is the smaller: the leaves of that one are pointed at the
+    // other's TNULL, in O(m). The nodes of other are
+    // spliced in or destroyed, so other is left empty, except by merge(),
+    // which like std::set::merge leaves there the elements already present.
+    void union_with(RBTree& other) { union_with(other, ForkContext()); }
+    void intersect_with(RBTree& other) { intersect_with(other, ForkContext()); }
+    void difference_with(RBTree& other) { difference_with(other, ForkContext()); }
+    void merge(RBTree& other);
+    // Keeps only the elements for which pred returns true.
+    template <typename Pred>
+    void filter(Pred pred) { filter(pred, ForkContext()); }
+
+    // Insert / remove a batch of m keys in one pass over the subtrees they
+    // fall into, O(m log(n/m + 1)) instead of m separate descents. The
+    // batch is sorted first; the SortedUnique forms take a strictly
+    // increasing random-access range as is. Return how many elements were
+    // actually inserted / removed. The sort stays on the calling thread
+    // unless threads asks for more (0: one per hardware thread).
+    template <typename It>
+    std::size_t insert_batch(It first, It last, unsigned threads = 1);
+    template <typename It>
+    std::size_t insert_batch(SortedUnique, It first, It last);
+    template <typename It>
+    std::size_t erase_batch(It first, It last, unsigned threads = 1);
+    template <typename It>
+    std::size_t erase_batch(SortedUnique, It first, It last);
+
+    // The same on a fork-join pool: independent subtrees larger than the
+    // policy's cutoff run in parallel, so pred has to be thread-safe. A
+    // pool that is not concurrent (SlabNodes) is locked around each node
+    // destroyed, and the parallel assign() builds its nodes serially.
+    void union_with(Parallel policy, RBTree& other);
+    void intersect_with(Parallel policy, RBTree& other);
+    void difference_with(Parallel policy, RBTree& other);
+    template <typename Pred>
+    void filter(Parallel policy, Pred pred);
+    template <typename It>
+    void assign(Parallel policy, It first, It last);
+    template <typename It>
+    void assign(Parallel policy, SortedUnique, It first, It last);
+
+    void displayRBProperties() const;
+    // Checks order, parent links, the red and black rules, subtree sizes
+    // and size(), in O(n); for tests.
+    bool isValid() const;
+
+    // Counters of a tree with the Counting trace policy, plus its height
+    // and black height; the height takes a walk over the whole tree.
+    TreeStats stats() const;
+    void resetStats() { counters = {}; }
+};
+
+
+template <typename T, typename Trace, typename Alloc, typename Augment>
+RBTree<T, Trace, Alloc, Augment>::RBTree() : nodeCount(0) {
+    initializeNULLNode();
+}
+
+template <typename T, typename Trace, typename Alloc, typename Augment>
+RBTree<T, Trace, Alloc, Augment>::~RBTree() {
+    if constexpr (!bulkClear) {
+        clear(root);
+        pool.destroy(TNULL);
+    }
+}
+
+template <typename T, typename Trace, typename Alloc, typename Augment>
+void RBTree<T, Trace, Alloc, Augment>::initializeNULLNode() {
+    TNULL = pool.create(T());  
+    TNULL->setColor(BLACK);   
+    TNULL->left = nullptr;
+    TNULL->right = nullptr;
+    if constexpr (Augment::enabled) {
+        TNULL->size = 0;
+    }
+    root = TNULL;  
+}
+
+
+
+template <typename T, typename Trace, typename Alloc, typename Augment>
+std::size_t RBTree<T, Trace, Alloc, Augment>::clear(Node* node) {
+    if (node == TNULL) {
+        return 0;
+    }
+    std::size_t count = clear(node->left) + clear(node->right);
+    pool.destroy(node);
+    return count + 1;
+}
+
+template <typename T, typename Trace, typename Alloc, typename Augment>
+void RBTree<T, Trace, Alloc, Augment>::clear() {
+    if constexpr (bulkClear) {
+        pool.releaseAll();
+        initializeNULLNode();
+    }
+    else {
+        clear(root);
+        root = TNULL;
+    }
+    nodeCount = 0;
+}
+
+
+template <typename T, typename Trace, typename Alloc, typename Augment>
+void RBTree<T, Trace, Alloc, Augment>::leftRotate(Node* x) {
+    Node* y = x->right;  
+
+    x->right = y->left;
+
+    if (y->left != TNULL) {
+        y->left->setParent(x);
+    }
+
+    y->setParent(x->parent());  
+
+    if (x->parent() == nullptr) {  
+        root = y;
+    }
+    else if (x == x->parent()->left) {  
+        x->parent()->left = y;
+    }
+    else { 
+        x->parent()->right = y;
+    }
+
+    y->left = x; 
+    x->setParent(y);
+
+    updateSize(x);
+    updateSize(y);
+}
+
+template <typename T, typename Trace, typename Alloc, typename Augment>
+void RBTree<T, Trace, Alloc, Augment>::rightRotate(Node* x) {
+    Node* y = x->left; 
+
+    x->left = y->right;  
+
+    if (y->right != TNULL) {
+        y->right->setParent(x);
+    }
+
+    y->setParent(x->parent());  
+
+    if (x->parent() == nullptr) {  
+        root = y;
+    }
+    else if (x == x->parent()->right) { 
+        x->parent()->right = y;
+    }
+    else {  
+        x->parent()->left = y;
+    }
+
+    y->right = x;
+    x->setParent(y);
+
+    updateSize(x);
+    updateSize(y);
+}
+
+
+template <typename T, typename Trace, typename Alloc, typename Augment>
+void RBTree<T, Trace, Alloc, Augment>::updateSize(Node* node) {
+    if constexpr (Augment::enabled) {
+        node->size = node->left->size + node->right->size + 1;
+    }
+}
+
+
+template <typename T, typename Trace, typename Alloc, typename Augment>
+void RBTree<T, Trace, Alloc, Augment>::fixInsert(Node* k) {
+    Node* u; 
+    std::size_t recolors = 0;
+    std::size_t rotations = 0;
+
+    while (k->parent() != nullptr && k->parent()->color() == RED) {
+        if (k->parent() == k->parent()->parent()->right) {
+           
+            u = k->parent()->parent()->left;  
+
+            if (u->color() == RED) {
+                
+                u->setColor(BLACK);
+                k->parent()->setColor(BLACK);
+                k->parent()->parent()->setColor(RED);
+                k = k->parent()->parent();
+                recolors++;
+            }
+            else {
+                if (k == k->parent()->left) {
+                   
+                    k = k->parent();
+                    rightRotate(k);
+                    rotations++;
+                }
+
+                k->parent()->setColor(BLACK);
+                k->parent()->parent()->setColor(RED);
+                leftRotate(k->parent()->parent());
+                rotations++;
+            }
+        }
+        else {
+          
+            u = k->parent()->parent()->right;  
+
+            if (u->color() == RED) {
+                
+                u->setColor(BLACK);
+                k->parent()->setColor(BLACK);
+                k->parent()->parent()->setColor(RED);
+                k = k->parent()->parent();
+                recolors++;
+            }
+            else {
+                if (k == k->parent()->right) {
+                    
+                    k = k->parent();
+                    leftRotate(k);
+                    rotations++;
+                }
+               
+                k->parent()->setColor(BLACK);
+                k->parent()->parent()->setColor(RED);
+                rightRotate(k->parent()->parent());
+                rotations++;
+            }
+        }
+
+        if (k == root) {
+            break;
+        }
+    }
+
+    root->setColor(BLACK);  
+    if constexpr (Trace::counting) {
+        counters.insertRecolors += recolors;
+        counters.insertRotations += rotations;
+    }
+}
+
+
+template <typename T, typename Trace, typename Alloc, typename Augment>
+void RBTree<T, Trace, Alloc, Augment>::transplant(Node* u, Node* v) {
+    if (u->parent() == nullptr) {
+        root = v;
+    }
+    else if (u == u->parent()->left) {
+        u->parent()->left = v;
+    }
+    else {
+        u->parent()->right = v;
+    }
+    v->setParent(u->parent());
+}
+
+
+template <typename T, typename Trace, typename Alloc, typename Augment>
+typename RBTree<T, Trace, Alloc, Augment>::Node* RBTree<T, Trace, Alloc, Augment>::minimum(Node* node) {
+    while (node->left != TNULL) {
+        node = node->left;
+    }
+    return node;
+}
+
+template <typename T, typename Trace, typename Alloc, typename Augment>
+void RBTree<T, Trace, Alloc, Augment>::fixDelete(Node* x) {
+    Node* s;  
+    std::size_t recolors = 0;
+    std::size_t rotations = 0;
+
+    while (x != root && x->color() == BLACK) {
+        if (x == x->parent()->left) {
+            s = x->parent()->right;
+
+            if (s->color() == RED) {
+                
+                s->setColor(BLACK);
+                x->parent()->setColor(RED);
+                leftRotate(x->parent());
+                rotations++;
+                s = x->parent()->right;
+            }
+
+            if (s->left->color() == BLACK && s->right->color() == BLACK) {
+              
+                s->setColor(RED);
+                x = x->parent();
+                recolors++;
+            }
+            else {
+                if (s->right->color() == BLACK) {
+                   
+                    s->left->setColor(BLACK);
+                    s->setColor(RED);
+                    rightRotate(s);
+                    rotations++;
+                    s = x->parent()->right;
+                }
+                
+                s->setColor(x->parent()->color());
+                x->parent()->setColor(BLACK);
+                s->right->setColor(BLACK);
+                leftRotate(x->parent());
+                rotations++;
+                x = root;
+            }
+        }
+        else {
+         
+            s = x->parent()->left;
+
+            if (s->color() == RED) {
+                s->setColor(BLACK);
+                x->parent()->setColor(RED);
+                rightRotate(x->parent());
+                rotations++;
+                s = x->parent()->left;
+            }
+
+            if (s->right->color() == BLACK && s->left->color() == BLACK) {
+                s->setColor(RED);
+                x = x->parent();
+                recolors++;
+            }
+            else {
+                if (s->left->color() == BLACK) {
+                    s->right->setColor(BLACK);
+                    s->setColor(RED);
+                    leftRotate(s);
+                    rotations++;
+                    s = x->parent()->left;
+                }
+                s->setColor(x->parent()->color());
+                x->parent()->setColor(BLACK);
+                s->left->setColor(BLACK);
+                rightRotate(x->parent());
+                rotations++;
+                x = root;
+            }
+        }
+    }
+    x->setColor(BLACK);
+    if constexpr (Trace::counting) {
+        counters.deleteRecolors += recolors;
+        counters.deleteRotations += rotations;
+    }
+}
+
+
+// Returns the node equal to key, or TNULL with parent set to the node
+// key would be attached under (nullptr for an empty tree).
+template <typename T, typename Trace, typename Alloc, typename Augment>
+template <typename Key>
+typename RBTree<T, Trace, Alloc, Augment>::Node* RBTree<T, Trace, Alloc, Augment>::descend(const Key& key, Node*& parent) const {
+    parent = nullptr;
+    Node* current = root;
+    std::size_t nodes = 0;
+    std::size_t compares = 0;
+
+    while (current != TNULL) {
+        nodes++;
+        if (key < current->data) {
+            compares += 1;
+            parent = current;
+            current = current->left;
+        }
+        else if (current->data < key) {
+            compares += 2;
+            parent = current;
+            current = current->right;
+        }
+        else {
+            compares += 2;
+            break;
+        }
+    }
+    if constexpr (Trace::counting) {
+        counters.descent(nodes, compares);
+    }
+    return current;
+}
+
+template <typename T, typename Trace, typename Alloc, typename Augment>
+typename RBTree<T, Trace, Alloc, Augment>::Node* RBTree<T, Trace, Alloc, Augment>::attach(Node* newNode, Node* parent) {
+    newNode->left = TNULL;
+    newNode->right = TNULL;
+    newNode->setParent(parent);
+
+    if (parent == nullptr) {
+        root = newNode;
+    }
+    else if (newNode->data < parent->data) {
+        parent->left = newNode;
+    }
+    else {
+        parent->right = newNode;
+    }
+
+    nodeCount++;
+    if constexpr (Augment::enabled) {
+        for (Node* p = parent; p != nullptr; p = p->parent()) {
+            p->size++;
+        }
+    }
+
+    if (newNode->parent() == nullptr) {
+        newNode->setColor(BLACK);
+        return newNode;
+    }
+
+    if (newNode->parent()->parent() == nullptr) {
+        return newNode;
+    }
+
+    fixInsert(newNode);
+    return newNode;
+}
+
+template <typename T, typename Trace, typename Alloc, typename Augment>
+template <typename... Args>
+std::pair<typename RBTree<T, Trace, Alloc, Augment>::const_iterator, bool> RBTree<T, Trace, Alloc, Augment>::emplace(Args&&... args) {
+    Node* newNode = createNode(std::forward<Args>(args)...);
+
+    Node* parent;
+    Node* existing = descend(newNode->data, parent);
+    if (existing != TNULL) {
+        pool.destroy(newNode);
+        return { const_iterator(existing, this), false };
+    }
+    return { const_iterator(attach(newNode, parent), this), true };
+}
+
+template <typename T, typename Trace, typename Alloc, typename Augment>
+template <typename Key, typename... Args>
+std::pair<typename RBTree<T, Trace, Alloc, Augment>::const_iterator, bool> RBTree<T, Trace, Alloc, Augment>::try_emplace(const Key& key, Args&&... args) {
+    Node* parent;
+    Node* existing = descend(key, parent);
+    if (existing != TNULL) {
+        return { const_iterator(existing, this), false };
+    }
+    return { const_iterator(attach(createNode(std::forward<Args>(args)...), parent), this), true };
+}
+
+template <typename T, typename Trace, typename Alloc, typename Augment>
+void RBTree<T, Trace, Alloc, Augment>::insert(const T& value) {
+    if constexpr (Trace::enabled) {
+        std::cout << "Вставка " << value << std::endl;
+    }
+    try_emplace(value, value);
+}
+
+template <typename T, typename Trace, typename Alloc, typename Augment>
+void RBTree<T, Trace, Alloc, Augment>::insert(T&& value) {
+    if constexpr (Trace::enabled) {
+        std::cout << "Вставка " << value << std::endl;
+    }
+    try_emplace(value, std::move(value));
+}
+
+
+template <typename T, typename Trace, typename Alloc, typename Augment>
+template <typename... Args>
+typename RBTree<T, Trace, Alloc, Augment>::Node* RBTree<T, Trace, Alloc, Augment>::createNode(Args&&... args) {
+    Node* node = pool.create(std::forward<Args>(args)...);
+    if constexpr (Trace::counting) {
+        counters.nodesAllocated++;
+    }
+    return node;
+}
+
+// Builds a perfectly balanced subtree from the next n sorted values of it.
+// Every level above redDepth is full; the nodes of the partial bottom
+// level are red, which keeps the black height equal on all paths.
+template <typename T, typename Trace, typename Alloc, typename Augment>
+template <typename It>
+typename RBTree<T, Trace, Alloc, Augment>::Node* RBTree<T, Trace, Alloc, Augment>::build(It& it, std::size_t n, int depth, int redDepth) {
+    if (n == 0) {
+        return TNULL;
+    }
+
+    std::size_t leftSize = (n - 1) / 2;
+    Node* left = build(it, leftSize, depth + 1, redDepth);
+    Node* node = createNode(*it);
+    ++it;
+    Node* right = build(it, n - 1 - leftSize, depth + 1, redDepth);
+
+    node->setColor(depth == redDepth ? RED : BLACK);
+    node->left = left;
+    node->right = right;
+    if (left != TNULL) {
+        left->setParent(node);
+    }
+    if (right != TNULL) {
+        right->setParent(node);
+    }
+    updateSize(node);
+    return node;
+}
+
+template <typename T, typename Trace, typename Alloc, typename Augment>
+template <typename It>
+void RBTree<T, Trace, Alloc, Augment>::assign(It first, It last, unsigned threads) {
+    std::vector<T> values(first, last);
+    sortUnique(values, threads);
+    assign(sortedUnique, std::make_move_iterator(values.begin()), std::make_move_iterator(values.end()));
+}
+
+template <typename T, typename Trace, typename Alloc, typename Augment>
+template <typename It>
+void RBTree<T, Trace, Alloc, Augment>::assign(SortedUnique, It first, It last) {
+    clear();
+    std::size_t n = static_cast<std::size_t>(std::distance(first, last));
+
+    int redDepth = 0;
+    while ((std::size_t(2) << redDepth) - 1 <= n) {
+        redDepth++;
+    }
+    root = build(first, n, 0, redDepth);
+    root->setParent(nullptr);
+    nodeCount = n;
+}
+
+
+template <typename T, typename Trace, typename Alloc, typename Augment>
+template <typename Key>
+typename RBTree<T, Trace, Alloc, Augment>::Node* RBTree<T, Trace, Alloc, Augment>::searchTreeHelper(Node* node, const Key& value) const {
+    std::size_t nodes = 0;
+    std::size_t compares = 0;
+    while (node != TNULL) {
+        nodes++;
+        if (value < node->data) {
+            compares += 1;
+            node = node->left;
+        }
+        else if (node->data < value) {
+            compares += 2;
+            node = node->right;
+        }
+        else {
+            compares += 2;
+            break;
+        }
+    }
+    if constexpr (Trace::counting) {
+        counters.descent(nodes, compares);
+    }
+    return node;
+}
+
+template <typename T, typename Trace, typename Alloc, typename Augment>
+template <typename Key>
+bool RBTree<T, Trace, Alloc, Augment>::search(const Key& value) const {
+    Node* result = searchTreeHelper(root, value);
+    return result != TNULL;
+}
+
+template <typename T, typename Trace, typename Alloc, typename Augment>
+const typename RBTree<T, Trace, Alloc, Augment>::Node* RBTree<T, Trace, Alloc, Augment>::minNode(const Node* node) const {
+    if (node == TNULL) {
+        return nullptr;
+    }
+    while (node->left != TNULL) {
+        node = node->left;
+    }
+    return node;
+}
+
+template <typename T, typename Trace, typename Alloc, typename Augment>
+const typename RBTree<T, Trace, Alloc, Augment>::Node* RBTree<T, Trace, Alloc, Augment>::maxNode(const Node* node) const {
+    if (node == TNULL) {
+        return nullptr;
+    }
+    while (node->right != TNULL) {
+        node = node->right;
+    }
+    return node;
+}
+
+template <typename T, typename Trace, typename Alloc, typename Augment>
+const typename RBTree<T, Trace, Alloc, Augment>::Node* RBTree<T, Trace, Alloc, Augment>::nextNode(const Node* node) const {
+    if (node->right != TNULL) {
+        return minNode(node->right);
+    }
+    while (node->parent() != nullptr && node == node->parent()->right) {
+        node = node->parent();
+    }
+    return node->parent();
+}
+
+template <typename T, typename Trace, typename Alloc, typename Augment>
+const typename RBTree<T, Trace, Alloc, Augment>::Node* RBTree<T, Trace, Alloc, Augment>::prevNode(const Node* node) const {
+    if (node->left != TNULL) {
+        return maxNode(node->left);
+    }
+    while (node->parent() != nullptr && node == node->parent()->left) {
+        node = node->parent();
+    }
+    return node->parent();
+}
+
+// A lane holds one lookup in progress. A lane that finishes takes the next
+// key, so short and long descents share the lanes without waiting.
+template <typename T, typename Trace, typename Alloc, typename Augment>
+template <typename Key, typename F>
+void RBTree<T, Trace, Alloc, Augment>::lookupBatch(const Key* keys, std::size_t n, F done) const {
+    const Node* top = root;
+    if (top == TNULL) {
+        for (std::size_t i = 0; i < n; i++) {
+            done(i, nullptr);
+        }
+        if constexpr (Trace::counting) {
+            for (std::size_t i = 0; i < n; i++) {
+                counters.descent(0, 0);
+            }
+        }
+        return;
+    }
+
+    struct Lane {
+        const Node* node;
+        std::size_t index;
+        std::size_t nodes;
+        std::size_t compares;
+    };
+    Lane lanes[kBatchLanes];
+    std::size_t active = 0;
+    std::size_t next = 0;
+    while (active < kBatchLanes && next < n) {
+        lanes[active++] = { top, next++, 0, 0 };
+    }
+
+    while (active > 0) {
+        for (std::size_t j = 0; j < active;) {
+            Lane& lane = lanes[j];
+            const Node* node = lane.node;
+            const Key& key = keys[lane.index];
+
+            bool less = key < node->data;
+            bool greater = !less && node->data < key;
+            lane.nodes++;
+            lane.compares += less ? 1 : 2;
+            if (less || greater) {
+                node = less ? node->left : node->right;
+                if (node != TNULL) {
+                    prefetchRead(node);
+                    lane.node = node;
+                    j++;
+                    continue;
+                }
+                done(lane.index, nullptr);
+            }
+            else {
+                done(lane.index, node);
+            }
+            if constexpr (Trace::counting) {
+                counters.descent(lane.nodes, lane.compares);
+            }
+
+            if (next < n) {
+                lane = { top, next++, 0, 0 };
+                j++;
+            }
+            else {
+                lane = lanes[--active];
+            }
+        }
+    }
+}
+
+template <typename T, typename Trace, typename Alloc, typename Augment>
+template <typename Key>
+void RBTree<T, Trace, Alloc, Augment>::contains_batch(const Key* keys, std::size_t n, bool* out) const {
+    lookupBatch(keys, n, [out](std::size_t i, const Node* node) { out[i] = node != nullptr; });
+}
+
+template <typename T, typename Trace, typename Alloc, typename Augment>
+template <typename Key>
+void RBTree<T, Trace, Alloc, Augment>::find_batch(const Key* keys, std::size_t n, const_iterator* out) const {
+    lookupBatch(keys, n, [this, out](std::size_t i, const Node* node) { out[i] = const_iterator(node, this); });
+}
+
+template <typename T, typename Trace, typename Alloc, typename Augment>
+template <typename Key>
+typename RBTree<T, Trace, Alloc, Augment>::const_iterator RBTree<T, Trace, Alloc, Augment>::find(const Key& value) const {
+    const_iterator it = lower_bound(value);
+    return it != end() && !(value < *it) ? it : end();
+}
+
+// The four bound lookups differ only in which way the search goes at a
+// node and on which side the candidate is kept; goLeft(node) picks the
+// way, and the node is remembered when the search leaves it to the left
+// (or to the right, with KeepRight).
+template <typename T, typename Trace, typename Alloc, typename Augment>
+template <bool KeepRight, typename GoLeft>
+const typename RBTree<T, Trace, Alloc, Augment>::Node* RBTree<T, Trace, Alloc, Augment>::bound(GoLeft goLeft) const {
+    const Node* node = root;
+    const Node* result = nullptr;
+    std::size_t nodes = 0;
+    while (node != TNULL) {
+        nodes++;
+        if (goLeft(node)) {
+            if (!KeepRight) {
+                result = node;
+            }
+            node = node->left;
+        }
+        else {
+            if (KeepRight) {
+                result = node;
+            }
+            node = node->right;
+        }
+    }
+    if constexpr (Trace::counting) {
+        counters.descent(nodes, nodes);
+    }
+    return result;
+}
+
+template <typename T, typename Trace, typename Alloc, typename Augment>
+template <typename Key>
+typename RBTree<T, Trace, Alloc, Augment>::const_iterator RBTree<T, Trace, Alloc, Augment>::lower_bound(const Key& value) const {
+    return const_iterator(bound<false>([&value](const Node* node) { return !(node->data < value); }), this);
+}
+
+template <typename T, typename Trace, typename Alloc, typename Augment>
+template <typename Key>
+typename RBTree<T, Trace, Alloc, Augment>::const_iterator RBTree<T, Trace, Alloc, Augment>::upper_bound(const Key& value) const {
+    return const_iterator(bound<false>([&value](const Node* node) { return value < node->data; }), this);
+}
+
+template <typename T, typename Trace, typename Alloc, typename Augment>
+template <typename Key>
+typename RBTree<T, Trace, Alloc, Augment>::const_iterator RBTree<T, Trace, Alloc, Augment>::floor(const Key& value) const {
+    return const_iterator(bound<true>([&value](const Node* node) { return value < node->data; }), this);
+}
+
+template <typename T, typename Trace, typename Alloc, typename Augment>
+template <typename Key>
+typename RBTree<T, Trace, Alloc, Augment>::const_iterator RBTree<T, Trace, Alloc, Augment>::predecessor(const Key& value) const {
+    return const_iterator(bound<true>([&value](const Node* node) { return !(node->data < value); }), this);
+}
+
+template <typename T, typename Trace, typename Alloc, typename Augment>
+template <typename Key>
+std::size_t RBTree<T, Trace, Alloc, Augment>::rank(const Key& value) const {
+    static_assert(Augment::enabled, "rank() needs the SubtreeSize augmentation");
+    std::size_t result = 0;
+    std::size_t nodes = 0;
+    const Node* node = root;
+    while (node != TNULL) {
+        nodes++;
+        if (node->data < value) {
+            result += node->left->size + 1;
+            node = node->right;
+        }
+        else {
+            node = node->left;
+        }
+    }
+    if constexpr (Trace::counting) {
+        counters.descent(nodes, nodes);
+    }
+    return result;
+}
+
+template <typename T, typename Trace, typename Alloc, typename Augment>
+typename RBTree<T, Trace, Alloc, Augment>::const_iterator RBTree<T, Trace, Alloc, Augment>::select(std::size_t k) const {
+    static_assert(Augment::enabled, "select() needs the SubtreeSize augmentation");
+    const Node* node = root;
+    while (node != TNULL) {
+        std::size_t leftSize = node->left->size;
+        if (k < leftSize) {
+            node = node->left;
+        }
+        else if (k > leftSize) {
+            k -= leftSize + 1;
+            node = node->right;
+        }
+        else {
+            return const_iterator(node, this);
+        }
+    }
+    return end();
+}
+
+template <typename T, typename Trace, typename Alloc, typename Augment>
+template <typename Key>
+std::size_t RBTree<T, Trace, Alloc, Augment>::count_range(const Key& lo, const Key& hi) const {
+    static_assert(Augment::enabled, "count_range() needs the SubtreeSize augmentation");
+    if (hi < lo) {
+        return 0;
+    }
+
+    std::size_t notAbove = 0;
+    std::size_t nodes = 0;
+    const Node* node = root;
+    while (node != TNULL) {
+        nodes++;
+        if (hi < node->data) {
+            node = node->left;
+        }
+        else {
+            notAbove += node->left->size + 1;
+            node = node->right;
+        }
+    }
+    if constexpr (Trace::counting) {
+        counters.descent(nodes, nodes);
+    }
+    return notAbove - rank(lo);
+}
+
+template <typename T, typename Trace, typename Alloc, typename Augment>
+typename RBTree<T, Trace, Alloc, Augment>::Node* RBTree<T, Trace, Alloc, Augment>::link(Node* left, Node* node, Node* right) {
+    node->left = left;
+    node->right = right;
+    if (left != TNULL) {
+        left->setParent(node);
+    }
+    if (right != TNULL) {
+        right->setParent(node);
+    }
+    updateSize(node);
+    return node;
+}
+
+// Attaches node and right on the right spine of left at the black height of
+// right. A red node with a red right child may come back; the first black
+// ancestor fixes it with a left rotation.
+template <typename T, typename Trace, typename Alloc, typename Augment>
+typename RBTree<T, Trace, Alloc, Augment>::Node* RBTree<T, Trace, Alloc, Augment>::joinRight(Node* left, int leftHeight, Node* node, Subtree right) {
+    if (left->color() == BLACK && leftHeight == right.blackHeight) {
+        node->setColor(RED);
+        return link(left, node, right.root);
+    }
+
+    Node* joined = joinRight(left->right, leftHeight - (left->color() == BLACK), node, right);
+    link(left->left, left, joined);
+
+    if (left->color() == BLACK && joined->color() == RED && joined->right->color() == RED) {
+        joined->right->setColor(BLACK);
+        link(left->left, left, joined->left);
+        return link(left, joined, joined->right);
+    }
+    return left;
+}
+
+template <typename T, typename Trace, typename Alloc, typename Augment>
+typename RBTree<T, Trace, Alloc, Augment>::Node* RBTree<T, Trace, Alloc, Augment>::joinLeft(Subtree left, Node* node, Node* right, int rightHeight) {
+    if (right->color() == BLACK && rightHeight == left.blackHeight) {
+        node->setColor(RED);
+        return link(left.root, node, right);
+    }
+
+    Node* joined = joinLeft(left, node, right->left, rightHeight - (right->color() == BLACK));
+    link(joined, right, right->right);
+
+    if (right->color() == BLACK && joined->color() == RED && joined->left->color() == RED) {
+        joined->left->setColor(BLACK);
+        link(joined->right, right, right->right);
+        return link(joined->left, joined, right);
+    }
+    return right;
+}
+
+// Joins left, node and right, where left < node < right. Red roots are
+// blackened first, which keeps both inputs valid and the joins simple.
+template <typename T, typename Trace, typename Alloc, typename Augment>
+typename RBTree<T, Trace, Alloc, Augment>::Subtree RBTree<T, Trace, Alloc, Augment>::joinNodes(Subtree left, Node* node, Subtree right) {
+    if (left.root->color() == RED) {
+        left.root->setColor(BLACK);
+        left.blackHeight++;
+    }
+    if (right.root->color() == RED) {
+        right.root->setColor(BLACK);
+        right.blackHeight++;
+    }
+
+    Subtree joined;
+    if (left.blackHeight > right.blackHeight) {
+        joined = { joinRight(left.root, left.blackHeight, node, right), left.blackHeight };
+        if (joined.root->color() == RED && joined.root->right->color() == RED) {
+            joined.root->setColor(BLACK);
+            joined.blackHeight++;
+        }
+    }
+    else if (right.blackHeight > left.blackHeight) {
+        joined = { joinLeft(left, node, right.root, right.blackHeight), right.blackHeight };
+        if (joined.root->color() == RED && joined.root->left->color() == RED) {
+            joined.root->setColor(BLACK);
+            joined.blackHeight++;
+        }
+    }
+    else {
+        node->setColor(BLACK);
+        joined = { link(left.root, node, right.root), left.blackHeight + 1 };
+    }
+    joined.root->setParent(nullptr);
+    return joined;
+}
+
+// Removes the largest node of a non-empty subtree into last.
+template <typename T, typename Trace, typename Alloc, typename Augment>
+typename RBTree<T, Trace, Alloc, Augment>::Subtree RBTree<T, Trace, Alloc, Augment>::splitLast(Subtree tree, Node*& last) {
+    Node* node = tree.root;
+    int inner = tree.blackHeight - (node->color() == BLACK);
+
+    if (node->right == TNULL) {
+        last = node;
+        if (node->left != TNULL) {
+            node->left->setParent(nullptr);
+        }
+        return { node->left, inner };
+    }
+    Subtree rest = splitLast({ node->right, inner }, last);
+    return joinNodes({ node->left, inner }, node, rest);
+}
+
+template <typename T, typename Trace, typename Alloc, typename Augment>
+typename RBTree<T, Trace, Alloc, Augment>::Subtree RBTree<T, Trace, Alloc, Augment>::join2(Subtree left, Subtree right) {
+    if (left.root == TNULL) {
+        return right;
+    }
+    Node* last;
+    Subtree rest = splitLast(left, last);
+    return joinNodes(rest, last, right);
+}
+
+template <typename T, typename Trace, typename Alloc, typename Augment>
+template <typename Key>
+void RBTree<T, Trace, Alloc, Augment>::splitNodes(Subtree tree, const Key& key, Subtree& left, Node*& found, Subtree& right) {
+    Node* node = tree.root;
+    if (node == TNULL) {
+        left = right = { TNULL, 0 };
+        found = nullptr;
+        return;
+    }
+
+    int inner = tree.blackHeight - (node->color() == BLACK);
+    Subtree l = { node->left, inner };
+    Subtree r = { node->right, inner };
+    if (key < node->data) {
+        Subtree rest;
+        splitNodes(l, key, left, found, rest);
+        right = joinNodes(rest, node, r);
+    }
+    else if (node->data < key) {
+        Subtree rest;
+        splitNodes(r, key, rest, found, right);
+        left = joinNodes(l, node, rest);
+    }
+    else {
+        if (l.root != TNULL) {
+            l.root->setParent(nullptr);
+        }
+        if (r.root != TNULL) {
+            r.root->setParent(nullptr);
+        }
+        left = l;
+        right = r;
+        found = node;
+    }
+}
+
+// Union of a and b keeping the nodes of a for equal elements. The nodes of
+// b that lose are joined into *dups, or destroyed when dups is null.
+template <typename T, typename Trace, typename Alloc, typename Augment>
+typename RBTree<T, Trace, Alloc, Augment>::Subtree RBTree<T, Trace, Alloc, Augment>::unite(Subtree a, Subtree b, Subtree* dups, std::size_t& dupCount, const ForkContext& fork) {
+    if (a.root == TNULL || b.root == TNULL) {
+        if (dups) {
+            *dups = { TNULL, 0 };
+        }
+        return a.root == TNULL ? b : a;
+    }
+
+    int height = 2 * std::min(a.blackHeight, b.blackHeight);
+    Node* node = b.root;
+    int inner = b.blackHeight - (node->color() == BLACK);
+    Subtree bl = { node->left, inner };
+    Subtree br = { node->right, inner };
+    Subtree al, ar;
+    Node* found;
+    splitNodes(a, node->data, al, found, ar);
+
+    Subtree left{ TNULL, 0 }, right{ TNULL, 0 };
+    Subtree dupsLeft, dupsRight;
+    std::size_t dupsRightCount = 0;
+    fork.invoke(height,
+        [&] { left = unite(al, bl, dups ? &dupsLeft : nullptr, dupCount, fork); },
+        [&] { right = unite(ar, br, dups ? &dupsRight : nullptr, dupsRightCount, fork); });
+    dupCount += dupsRightCount;
+
+    if (!found) {
+        if (dups) {
+            *dups = join2(dupsLeft, dupsRight);
+        }
+        return joinNodes(left, node, right);
+    }
+
+    dupCount++;
+    if (dups) {
+        *dups = joinNodes(dupsLeft, node, dupsRight);
+    }
+    else {
+        dispose(node, fork);
+    }
+    return joinNodes(left, found, right);
+}
+
+template <typename T, typename Trace, typename Alloc, typename Augment>
+typename RBTree<T, Trace, Alloc, Augment>::Subtree RBTree<T, Trace, Alloc, Augment>::intersect(Subtree a, Subtree b, std::size_t& dropped, const ForkContext& fork) {
+    if (a.root == TNULL || b.root == TNULL) {
+        dropped += discard(a.root, fork) + discard(b.root, fork);
+        return { TNULL, 0 };
+    }
+
+    int height = 2 * std::min(a.blackHeight, b.blackHeight);
+    Node* node = b.root;
+    int inner = b.blackHeight - (node->color() == BLACK);
+    Subtree al, ar;
+    Node* found;
+    splitNodes(a, node->data, al, found, ar);
+
+    Subtree left{ TNULL, 0 }, right{ TNULL, 0 };
+    std::size_t droppedRight = 0;
+    fork.invoke(height,
+        [&] { left = intersect(al, { node->left, inner }, dropped, fork); },
+        [&] { right = intersect(ar, { node->right, inner }, droppedRight, fork); });
+    dispose(node, fork);
+    dropped += droppedRight + 1;
+
+    if (found) {
+        return joinNodes(left, found, right);
+    }
+    return join2(left, right);
+}
+
+template <typename T, typename Trace, typename Alloc, typename Augment>
+typename RBTree<T, Trace, Alloc, Augment>::Subtree RBTree<T, Trace, Alloc, Augment>::subtract(Subtree a, Subtree b, std::size_t& dropped, const ForkContext& fork) {
+    if (a.root == TNULL || b.root == TNULL) {
+        dropped += discard(b.root, fork);
+        return a;
+    }
+
+    int height = 2 * std::min(a.blackHeight, b.blackHeight);
+    Node* node = b.root;
+    int inner = b.blackHeight - (node->color() == BLACK);
+    Subtree al, ar;
+    Node* found;
+    splitNodes(a, node->data, al, found, ar);
+
+    Subtree left{ TNULL, 0 }, right{ TNULL, 0 };
+    std::size_t droppedRight = 0;
+    fork.invoke(height,
+        [&] { left = subtract(al, { node->left, inner }, dropped, fork); },
+        [&] { right = subtract(ar, { node->right, inner }, droppedRight, fork); });
+    dispose(node, fork);
+    dropped += droppedRight + 1;
+    if (found) {
+        dispose(found, fork);
+        dropped++;
+    }
+    return join2(left, right);
+}
+
+template <typename T, typename Trace, typename Alloc, typename Augment>
+template <typename Pred>
+typename RBTree<T, Trace, Alloc, Augment>::Subtree RBTree<T, Trace, Alloc, Augment>::filterNodes(Subtree tree, Pred& pred, std::size_t& dropped, const ForkContext& fork) {
+    Node* node = tree.root;
+    if (node == TNULL) {
+        return tree;
+    }
+
+    int inner = tree.blackHeight - (node->color() == BLACK);
+    Node* l = node->left;
+    Node* r = node->right;
+    Subtree left{ TNULL, 0 }, right{ TNULL, 0 };
+    std::size_t droppedRight = 0;
+    fork.invoke(2 * tree.blackHeight,
+        [&] { left = filterNodes({ l, inner }, pred, dropped, fork); },
+        [&] { right = filterNodes({ r, inner }, pred, droppedRight, fork); });
+    dropped += droppedRight;
+
+    if (pred(static_cast<const T&>(node->data))) {
+        return joinNodes(left, node, right);
+    }
+    dispose(node, fork);
+    dropped++;
+    return join2(left, right);
+}
+
+// Like unite() with a sorted range in place of the second tree: the range
+// is split at each node by binary search, and only the keys that are new
+// get nodes.
+template <typename T, typename Trace, typename Alloc, typename Augment>
+template <typename It>
+typename RBTree<T, Trace, Alloc, Augment>::Subtree RBTree<T, Trace, Alloc, Augment>::uniteSorted(Subtree tree, It first, It last, std::size_t& added) {
+    if (first == last) {
+        return tree;
+    }
+    Node* node = tree.root;
+    if (node == TNULL) {
+        std::size_t n = static_cast<std::size_t>(last - first);
+        int redDepth = 0;
+        while ((std::size_t(2) << redDepth) - 1 <= n) {
+            redDepth++;
+        }
+        added += n;
+        // All levels above redDepth are black, so that is the black height.
+        return { build(first, n, 0, redDepth), redDepth };
+    }
+
+    int inner = tree.blackHeight - (node->color() == BLACK);
+    It mid = std::lower_bound(first, last, node->data);
+    bool found = mid != last && !(node->data < *mid);
+    Subtree left = uniteSorted({ node->left, inner }, first, mid, added);
+    Subtree right = uniteSorted({ node->right, inner }, found ? mid + 1 : mid, last, added);
+    return joinNodes(left, node, right);
+}
+
+template <typename T, typename Trace, typename Alloc, typename Augment>
+template <typename It>
+typename RBTree<T, Trace, Alloc, Augment>::Subtree RBTree<T, Trace, Alloc, Augment>::subtractSorted(Subtree tree, It first, It last, std::size_t& removed) {
+    Node* node = tree.root;
+    if (node == TNULL || first == last) {
+        return tree;
+    }
+
+    int inner = tree.blackHeight - (node->color() == BLACK);
+    It mid = std::lower_bound(first, last, node->data);
+    bool found = mid != last && !(node->data < *mid);
+    Subtree left = subtractSorted({ node->left, inner }, first, mid, removed);
+    Subtree right = subtractSorted({ node->right, inner }, found ? mid + 1 : mid, last, removed);
+    if (found) {
+        pool.destroy(node);
+        removed++;
+        return join2(left, right);
+    }
+    return joinNodes(left, node, right);
+}
+
+// Builds the same tree as build(it, n, depth, redDepth) from a
+// random-access range, creating the two halves in parallel.
+template <typename T, typename Trace, typename Alloc, typename Augment>
+template <typename It>
+typename RBTree<T, Trace, Alloc, Augment>::Node* RBTree<T, Trace, Alloc, Augment>::build(It first, std::size_t n, int depth, int redDepth, const ForkContext& fork) {
+    if (n == 0) {
+        return TNULL;
+    }
+
+    std::size_t leftSize = (n - 1) / 2;
+    Node* left = TNULL, * right = TNULL;
+    fork.invoke(log2Floor(n),
+        [&] { left = build(first, leftSize, depth + 1, redDepth, fork); },
+        [&] { right = build(first + (leftSize + 1), n - 1 - leftSize, depth + 1, redDepth, fork); });
+    Node* node = pool.create(first[leftSize]);
+    node->setColor(depth == redDepth ? RED : BLACK);
+    return link(left, node, right);
+}
+
+template <typename T, typename Trace, typename Alloc, typename Augment>
+void RBTree<T, Trace, Alloc, Augment>::dispose(Node* node, const ForkContext& fork) {
+    fork.locked([&] { pool.destroy(node); });
+}
+
+template <typename T, typename Trace, typename Alloc, typename Augment>
+std::size_t RBTree<T, Trace, Alloc, Augment>::discard(Node* node, const ForkContext& fork) {
+    std::size_t count = 0;
+    if (node != TNULL) {
+        fork.locked([&] { count = clear(node); });
+    }
+    return count;
+}
+
+template <typename T, typename Trace, typename Alloc, typename Augment>
+void RBTree<T, Trace, Alloc, Augment>::relink(Subtree tree, Node* oldNull, const ForkContext& fork) {
+    Node* node = tree.root;
+    int inner = tree.blackHeight - (node->color() == BLACK);
+    fork.invoke(2 * tree.blackHeight,
+        [&] {
+            if (node->left == oldNull) {
+                node->left = TNULL;
+            }
+            else {
+                relink({ node->left, inner }, oldNull, fork);
+            }
+        },
+        [&] {
+            if (node->right == oldNull) {
+                node->right = TNULL;
+            }
+            else {
+                relink({ node->right, inner }, oldNull, fork);
+            }
+        });
+}
+
+// Points the leaves of this tree at sentinel, which becomes its TNULL; the
+// old one is left to the caller.
+template <typename T, typename Trace, typename Alloc, typename Augment>
+void RBTree<T, Trace, Alloc, Augment>::takeSentinel(Node* sentinel, const ForkContext& fork) {
+    Node* old = TNULL;
+    Subtree nodes = { root, getBlackHeight(root) };
+    TNULL = sentinel;
+    if (root == old) {
+        root = TNULL;
+    }
+    else {
+        relink(nodes, old, fork);
+    }
+}
+
+// Takes the nodes of other, leaving it empty. The leaves of the smaller
+// tree are pointed at the other one's TNULL, which this tree keeps, and
+// other gets a new sentinel.
+template <typename T, typename Trace, typename Alloc, typename Augment>
+typename RBTree<T, Trace, Alloc, Augment>::Subtree RBTree<T, Trace, Alloc, Augment>::adoptFrom(RBTree& other, const ForkContext& fork) {
+    pool.adopt(other.pool);
+
+    Subtree nodes = { TNULL, other.getBlackHeight(other.root) };
+    Node* spare = other.TNULL;
+    if (other.root != other.TNULL) {
+        nodes.root = other.root;
+        if (other.nodeCount <= nodeCount) {
+            relink(nodes, other.TNULL, fork);
+        }
+        else {
+            spare = TNULL;
+            takeSentinel(other.TNULL, fork);
+        }
+    }
+
+    pool.destroy(spare);
+    other.initializeNULLNode();
+    other.nodeCount = 0;
+    return nodes;
+}
+
+// Rebuilds a subtree of this pool in the pool of to, keeping its shape and colors.
+template <typename T, typename Trace, typename Alloc, typename Augment>
+typename RBTree<T, Trace, Alloc, Augment>::Node* RBTree<T, Trace, Alloc, Augment>::transfer(Node* node, RBTree& to) {
+    if (node == TNULL) {
+        return to.TNULL;
+    }
+    Node* left = transfer(node->left, to);
+    Node* right = transfer(node->right, to);
+    Node* copy = to.createNode(std::move(node->data));
+    copy->setColor(node->color());
+    pool.destroy(node);
+    return to.link(left, copy, right);
+}
+
+template <typename T, typename Trace, typename Alloc, typename Augment>
+void RBTree<T, Trace, Alloc, Augment>::setRoot(Node* node) {
+    root = node;
+    if (root != TNULL) {
+        root->setParent(nullptr);
+        root->setColor(BLACK);
+    }
+}
+
+template <typename T, typename Trace, typename Alloc, typename Augment>
+void RBTree<T, Trace, Alloc, Augment>::join(const T& key, RBTree& right) {
+    if (&right == this) {
+        throw std::invalid_argument("RBTree::join: right must be another tree");
+    }
+    std::size_t count = right.nodeCount;
+    Subtree nodes = adoptFrom(right, ForkContext());
+    setRoot(joinNodes({ root, getBlackHeight(root) }, createNode(key), nodes).root);
+    nodeCount += count + 1;
+}
+
+template <typename T, typename Trace, typename Alloc, typename Augment>
+template <typename Key>
+bool RBTree<T, Trace, Alloc, Augment>::split(const Key& key, RBTree& right) {
+    if (&right == this) {
+        throw std::invalid_argument("RBTree::split: right must be another tree");
+    }
+    right.clear();
+
+    Subtree left, rest;
+    Node* found;
+    splitNodes({ root, getBlackHeight(root) }, key, left, found, rest);
+    if (found) {
+        pool.destroy(found);
+    }
+
+    std::size_t total = nodeCount - (found ? 1 : 0);
+    setRoot(left.root);
+    if (rest.root != TNULL) {
+        rest.root->setParent(nullptr);
+    }
+
+    // Both halves still end in this TNULL here.
+    std::size_t restCount;
+    if constexpr (Augment::enabled) {
+        restCount = rest.root->size;
+    }
+    else {
+        // Walk both halves in step until the smaller one runs out.
+        const Node* l = minNode(root);
+        const Node* r = minNode(rest.root);
+        std::size_t steps = 0;
+        while (l && r) {
+            l = nextNode(l);
+            r = nextNode(r);
+            steps++;
+        }
+        restCount = r ? total - steps : steps;
+    }
+    nodeCount = total - restCount;
+    right.nodeCount = restCount;
+
+    if constexpr (NodePool::transferable) {
+        if (restCount <= nodeCount) {
+            if (rest.root != TNULL) {
+                right.relink(rest, TNULL, ForkContext());
+            }
+            right.setRoot(rest.root == TNULL ? right.TNULL : rest.root);
+        }
+        else {
+            // The moved half is the larger one: it keeps this TNULL and
+            // the nodes staying here take right's.
+            Node* sentinel = right.TNULL;
+            right.TNULL = TNULL;
+            takeSentinel(sentinel, ForkContext());
+            right.setRoot(rest.root);
+        }
+    }
+    else {
+        right.setRoot(transfer(rest.root, right));
+    }
+    return found != nullptr;
+}
+
+template <typename T, typename Trace, typename Alloc, typename Augment>
+template <typename It>
+std::size_t RBTree<T, Trace, Alloc, Augment>::insert_batch(It first, It last, unsigned threads) {
+    std::vector<T> values(first, last);
+    sortUnique(values, threads);
+    return insert_batch(sortedUnique, std::make_move_iterator(values.begin()), std::make_move_iterator(values.end()));
+}
+
+template <typename T, typename Trace, typename Alloc, typename Augment>
+template <typename It>
+std::size_t RBTree<T, Trace, Alloc, Augment>::insert_batch(SortedUnique, It first, It last) {
+    std::size_t added = 0;
+    setRoot(uniteSorted({ root, getBlackHeight(root) }, first, last, added).root);
+    nodeCount += added;
+    return added;
+}
+
+template <typename T, typename Trace, typename Alloc, typename Augment>
+template <typename It>
+std::size_t RBTree<T, Trace, Alloc, Augment>::erase_batch(It first, It last, unsigned threads) {
+    std::vector<T> values(first, last);
+    sortUnique(values, threads);
+    return erase_batch(sortedUnique, values.begin(), values.end());
+}
+
+template <typename T, typename Trace, typename Alloc, typename Augment>
+template <typename It>
+std::size_t RBTree<T, Trace, Alloc, Augment>::erase_batch(SortedUnique, It first, It last) {
+    std::size_t removed = 0;
+    setRoot(subtractSorted({ root, getBlackHeight(root) }, first, last, removed).root);
+    nodeCount -= removed;
+    return removed;
+}
+
+template <typename T, typename Trace, typename Alloc, typename Augment>
+void RBTree<T, Trace, Alloc, Augment>::union_with(RBTree& other, const ForkContext& fork) {
+    if (&other == this) {
+        return;
+    }
+    std::size_t count = other.nodeCount;
+    std::size_t dupCount = 0;
+    Subtree nodes = adoptFrom(other, fork);
+    setRoot(unite({ root, getBlackHeight(root) }, nodes, nullptr, dupCount, fork).root);
+    nodeCount += count - dupCount;
+}
+
+template <typename T, typename Trace, typename Alloc, typename Augment>
+void RBTree<T, Trace, Alloc, Augment>::intersect_with(RBTree& other, const ForkContext& fork) {
+    if (&other == this) {
+        return;
+    }
+    std::size_t count = other.nodeCount;
+    std::size_t dropped = 0;
+    Subtree nodes = adoptFrom(other, fork);
+    setRoot(intersect({ root, getBlackHeight(root) }, nodes, dropped, fork).root);
+    nodeCount = nodeCount + count - dropped;
+}
+
+template <typename T, typename Trace, typename Alloc, typename Augment>
+void RBTree<T, Trace, Alloc, Augment>::difference_with(RBTree& other, const ForkContext& fork) {
+    if (&other == this) {
+        clear();
+        return;
+    }
+    std::size_t count = other.nodeCount;
+    std::size_t dropped = 0;
+    Subtree nodes = adoptFrom(other, fork);
+    setRoot(subtract({ root, getBlackHeight(root) }, nodes, dropped, fork).root);
+    nodeCount = nodeCount + count - dropped;
+}
+
+template <typename T, typename Trace, typename Alloc, typename Augment>
+template <typename Pred>
+void RBTree<T, Trace, Alloc, Augment>::filter(Pred& pred, const ForkContext& fork) {
+    std::size_t dropped = 0;
+    setRoot(filterNodes({ root, getBlackHeight(root) }, pred, dropped, fork).root);
+    nodeCount -= dropped;
+}
+
+template <typename T, typename Trace, typename Alloc, typename Augment>
+void RBTree<T, Trace, Alloc, Augment>::union_with(Parallel policy, RBTree& other) {
+    std::mutex lock;
+    union_with(other, ForkContext(policy, NodePool::concurrent ? nullptr : &lock));
+}
+
+template <typename T, typename Trace, typename Alloc, typename Augment>
+void RBTree<T, Trace, Alloc, Augment>::intersect_with(Parallel policy, RBTree& other) {
+    std::mutex lock;
+    intersect_with(other, ForkContext(policy, NodePool::concurrent ? nullptr : &lock));
+}
+
+template <typename T, typename Trace, typename Alloc, typename Augment>
+void RBTree<T, Trace, Alloc, Augment>::difference_with(Parallel policy, RBTree& other) {
+    std::mutex lock;
+    difference_with(other, ForkContext(policy, NodePool::concurrent ? nullptr : &lock));
+}
+
+template <typename T, typename Trace, typename Alloc, typename Augment>
+template <typename Pred>
+void RBTree<T, Trace, Alloc, Augment>::filter(Parallel policy, Pred pred) {
+    std::mutex lock;
+    filter(pred, ForkContext(policy, NodePool::concurrent ? nullptr : &lock));
+}
+
+template <typename T, typename Trace, typename Alloc, typename Augment>
+template <typename It>
+void RBTree<T, Trace, Alloc, Augment>::assign(Parallel policy, It first, It last) {
+    std::vector<T> values(first, last);
+    sortUnique(values, policy);
+    assign(policy, sortedUnique, std::make_move_iterator(values.begin()), std::make_move_iterator(values.end()));
+}
+
+template <typename T, typename Trace, typename Alloc, typename Augment>
+template <typename It>
+void RBTree<T, Trace, Alloc, Augment>::assign(Parallel policy, SortedUnique, It first, It last) {
+    if constexpr (!NodePool::concurrent) {
+        assign(sortedUnique, first, last);
+        return;
+    }
+    clear();
+    std::size_t n = static_cast<std::size_t>(std::distance(first, last));
+
+    int redDepth = 0;
+    while ((std::size_t(2) << redDepth) - 1 <= n) {
+        redDepth++;
+    }
+    // Nodes are created on several threads, so they are counted here.
+    setRoot(build(first, n, 0, redDepth, ForkContext(policy, nullptr)));
+    nodeCount = n;
+    if constexpr (Trace::counting) {
+        counters.nodesAllocated += n;
+    }
+}
+
+template <typename T, typename Trace, typename Alloc, typename Augment>
+void RBTree<T, Trace, Alloc, Augment>::merge(RBTree& other) {
+    if (&other == this) {
+        return;
+    }
+    std::size_t count = other.nodeCount;
+    std::size_t dupCount = 0;
+    Subtree dups;
+    Subtree nodes = adoptFrom(other, ForkContext());
+    setRoot(unite({ root, getBlackHeight(root) }, nodes, &dups, dupCount, ForkContext()).root);
+    nodeCount += count - dupCount;
+
+    if constexpr (NodePool::transferable) {
+        if (dups.root != TNULL) {
+            other.relink(dups, TNULL, ForkContext());
+            other.setRoot(dups.root);
+        }
+    }
+    else {
+        other.setRoot(transfer(dups.root, other));
+    }
+    other.nodeCount = dupCount;
+}
+
+
+template <typename T, typename Trace, typename Alloc, typename Augment>
+template <typename Key>
+typename RBTree<T, Trace, Alloc, Augment>::Node* RBTree<T, Trace, Alloc, Augment>::remove(Node* node, const Key& value) {
+    Node* z = searchTreeHelper(node, value);
+    Node* x, * y;
+
+    if (z == TNULL) {
+        if constexpr (Trace::enabled) {
+            std::cout << "Элемент " << value << " не найден" << std::endl;
+        }
+        return root;
+    }
+
+    y = z;
+    Color yOriginalColor = y->color();
+
+    nodeCount--;
+    if constexpr (Augment::enabled) {
+        Node* vacated = (z->left == TNULL || z->right == TNULL) ? z : minimum(z->right);
+        for (Node* p = vacated->parent(); p != nullptr; p = p->parent()) {
+            p->size--;
+        }
+    }
+
+    if (z->left == TNULL) {
+        x = z->right;
+        transplant(z, z->right);
+    }
+    else if (z->right == TNULL) {
+        x = z->left;
+        transplant(z, z->left);
+    }
+    else {
+        y = minimum(z->right);
+        yOriginalColor = y->color();
+        x = y->right;
+
+        if (y->parent() == z) {
+            x->setParent(y);
+        }
+        else {
+            transplant(y, y->right);
+            y->right = z->right;
+            y->right->setParent(y);
+        }
+
+        transplant(z, y);
+        y->left = z->left;
+        y->left->setParent(y);
+        y->setColor(z->color());
+        if constexpr (Augment::enabled) {
+            y->size = z->size;
+        }
+    }
+
+    pool.destroy(z);
+
+    if (yOriginalColor == BLACK) {
+        fixDelete(x);
+    }
+
+    return root;
+}
+
+template <typename T, typename Trace, typename Alloc, typename Augment>
+template <typename Key>
+void RBTree<T, Trace, Alloc, Augment>::remove(const Key& value) {
+    if constexpr (Trace::enabled) {
+        std::cout << "Удаление " << value << std::endl;
+    }
+    root = remove(root, value);
+}
+
+
+template <typename T, typename Trace, typename Alloc, typename Augment>
+void RBTree<T, Trace, Alloc, Augment>::inorder(Node* node) const {
+    if (node != TNULL) {
+        inorder(node->left);
+        std::cout << node->data << "(" << (node->color() == RED ? "R" : "B") << ") ";
+        inorder(node->right);
+    }
+}
+
+template <typename T, typename Trace, typename Alloc, typename Augment>
+void RBTree<T, Trace, Alloc, Augment>::preorder(Node* node) const {
+    if (node != TNULL) {
+        std::cout << node->data << "(" << (node->color() == RED ? "R" : "B") << ") ";
+        preorder(node->left);
+        preorder(node->right);
+    }
+}
+
+template <typename T, typename Trace, typename Alloc, typename Augment>
+void RBTree<T, Trace, Alloc, Augment>::postorder(Node* node) const {
+    if (node != TNULL) {
+        postorder(node->left);
+        postorder(node->right);
+        std::cout << node->data << "(" << (node->color() == RED ? "R" : "B") << ") ";
+    }
+}
+
+template <typename T, typename Trace, typename Alloc, typename Augment>
+void RBTree<T, Trace, Alloc, Augment>::displayInorder() const {
+    std::cout << "Inorder (R-красный, B-черный): ";
+    inorder(root);
+    std::cout << std::endl;
+}
+
+template <typename T, typename Trace, typename Alloc, typename Augment>
+void RBTree<T, Trace, Alloc, Augment>::displayPreorder() const {
+    std::cout << "Preorder (R-красный, B-черный): ";
+    preorder(root);
+    std::cout << std::endl;
+}
+
+template <typename T, typename Trace, typename Alloc, typename Augment>
+void RBTree<T, Trace, Alloc, Augment>::displayPostorder() const {
+    std::cout << "Postorder (R-красный, B-черный): ";
+    postorder(root);
+    std::cout << std::endl;
+}
+
+
+template <typename T, typename Trace, typename Alloc, typename Augment>
+void RBTree<T, Trace, Alloc, Augment>::printTreeHelper(Node* node, int space, bool last) const {
+    if (node != TNULL) {
+        space += 10;
+
+        printTreeHelper(node->right, space, false);
+
+        std::cout << std::endl;
+        for (int i = 10; i < space; i++) {
+            std::cout << " ";
+        }
+
+        std::cout << node->data;
+        if (node->color() == RED) {
+            std::cout << "[R]";
+        }
+        else {
+            std::cout << "[B]";
+        }
+
+        if (last) {
+            std::cout << " ──┐";
+        }
+        else {
+            std::cout << " ──┤";
+        }
+        std::cout << std::endl;
+
+        printTreeHelper(node->left, space, true);
+    }
+}
+
+template <typename T, typename Trace, typename Alloc, typename Augment>
+void RBTree<T, Trace, Alloc, Augment>::displayTree() const {
+    std::cout << "\nКрасно-черное дерево:\n";
+    std::cout << "=====================\n";
+    if (root == TNULL) {
+        std::cout << "Дерево пустое\n";
+    }
+    else {
+        printTreeHelper(root, 0, true);
+    }
+    std::cout << "=====================\n";
+}
+
+
+template <typename T, typename Trace, typename Alloc, typename Augment>
+int RBTree<T, Trace, Alloc, Augment>::getBlackHeight(Node* node) const {
+    int blackHeight = 0;
+    while (node != TNULL) {
+        if (node->color() == BLACK) {
+            blackHeight++;
+        }
+        node = node->left;
+    }
+    return blackHeight;
+}
+
+
+template <typename T, typename Trace, typename Alloc, typename Augment>
+int RBTree<T, Trace, Alloc, Augment>::getHeight(Node* node) const {
+    return node == TNULL ? 0 : std::max(getHeight(node->left), getHeight(node->right)) + 1;
+}
+
+// Returns the subtree's black height, or -1 if anything in it is off. prev
+// is the last node visited in order.
+template <typename T, typename Trace, typename Alloc, typename Augment>
+int RBTree<T, Trace, Alloc, Augment>::checkNode(const Node* node, const Node* parent, const Node*& prev, std::size_t& count) const {
+    if (node == TNULL) {
+        return 0;
+    }
+    if (node->parent() != parent) {
+        return -1;
+    }
+    if (node->color() == RED && (node->left->color() == RED || node->right->color() == RED)) {
+        return -1;
+    }
+    int left = checkNode(node->left, node, prev, count);
+    if (left < 0 || (prev && !(prev->data < node->data))) {
+        return -1;
+    }
+    prev = node;
+    count++;
+    int right = checkNode(node->right, node, prev, count);
+    if (right != left) {
+        return -1;
+    }
+    if constexpr (Augment::enabled) {
+        if (node->size != node->left->size + node->right->size + 1) {
+            return -1;
+        }
+    }
+    return left + (node->color() == BLACK);
+}
+
+template <typename T, typename Trace, typename Alloc, typename Augment>
+bool RBTree<T, Trace, Alloc, Augment>::isValid() const {
+    if (TNULL->color() != BLACK || root->color() != BLACK) {
+        return false;
+    }
+    if constexpr (Augment::enabled) {
+        if (TNULL->size != 0) {
+            return false;
+        }
+    }
+    const Node* prev = nullptr;
+    std::size_t count = 0;
+    return checkNode(root, nullptr, prev, count) >= 0 && count == nodeCount;
+}
+
+template <typename T, typename Trace, typename Alloc, typename Augment>
+TreeStats RBTree<T, Trace, Alloc, Augment>::stats() const {
+    static_assert(Trace::counting, "stats() needs the Counting trace policy");
+    TreeStats result = counters;
+    result.height = getHeight(root);
+    result.blackHeight = getBlackHeight(root);
+    return result;
+}
+
+template <typename T, typename Trace, typename Alloc, typename Augment>
+void RBTree<T, Trace, Alloc, Augment>::displayRBProperties() const {
+    std::cout << "\nСвойства RB-дерева:\n";
+    std::cout << "1. Корень: " << (root == TNULL ? "пустой" : std::to_string(root->data))
+        << ", цвет: " << (root->color() == RED ? "КРАСНЫЙ (нарушение!)" : "ЧЕРНЫЙ") << std::endl;
+
+    if (root != TNULL) {
+        std::cout << "2. Черная высота: " << getBlackHeight(root) << std::endl;
+    }
+}
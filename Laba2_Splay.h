@@ -0,0 +1,394 @@
+#pragma once
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <cstddef>
+#include <iterator>
+#include <type_traits>
+#include <utility>
+
+#include "Laba2_Alloc.h"
+#include "Laba2_Bulk.h"
+#include "Laba2_Display.h"
+#include "Laba2_Frozen.h"
+
+// Splay policies: which lookups restructure the tree. Inserts and removes
+// always splay, since they write to the tree anyway.
+struct SplayAlways {
+    static constexpr bool always = true;
+    bool operator()(std::size_t) { return true; }
+};
+
+// Splays one lookup in N and leaves the rest read-only, trading some of the
+// adaptation for N times fewer writes on a read-mostly tree.
+template <unsigned N>
+struct SplayEveryNth {
+    static_assert(N > 0, "SplayEveryNth needs N > 0");
+    static constexpr bool always = false;
+    unsigned lookups = 0;
+    bool operator()(std::size_t) {
+        if (++lookups < N) {
+            return false;
+        }
+        lookups = 0;
+        return true;
+    }
+};
+
+// Splays only lookups that visited more than Depth nodes, so keys already
+// near the root are read without touching the tree.
+template <std::size_t Depth>
+struct SplayDeeperThan {
+    static constexpr bool always = false;
+    bool operator()(std::size_t depth) { return depth > Depth; }
+};
+
+// Self-adjusting search tree (Sleator, Tarjan): every access splays the key
+// to the root, so often used keys stay a few levels down and any sequence
+// of m operations costs O(m log n) in total. Splaying is top-down, done in
+// the same pass as the descent, so it needs neither parent links nor a
+// stack, and nodes have the shape of BST's: the element and two links.
+//
+// Because lookups move nodes, search() is not const and a SplayTree must
+// not be read from several threads at once.
+template <typename T, typename Splay = SplayAlways, typename Alloc = HeapNodes>
+class SplayTree {
+private:
+    struct Node {
+        T data;
+        Node* left;
+        Node* right;
+
+        Node(const T& value) : data(value), left(nullptr), right(nullptr) {}
+        Node(T&& value) : data(std::move(value)), left(nullptr), right(nullptr) {}
+    };
+
+    using NodePool = typename Alloc::template Pool<Node>;
+    static constexpr bool bulkClear = NodePool::bulkRelease && std::is_trivially_destructible<T>::value;
+
+    Node* root;
+    std::size_t nodeCount;
+    NodePool pool;
+    Splay policy;
+
+public:
+    SplayTree() : root(nullptr), nodeCount(0) {}
+    ~SplayTree() { clear(); }
+
+    template <typename It>
+    SplayTree(It first, It last, unsigned threads = 1) : root(nullptr), nodeCount(0) { assign(first, last, threads); }
+    template <typename It>
+    SplayTree(SortedUnique, It first, It last) : root(nullptr), nodeCount(0) { assign(sortedUnique, first, last); }
+
+    SplayTree(const SplayTree&) = delete;
+    SplayTree& operator=(const SplayTree&) = delete;
+
+    // Bytes allocated per element, before allocator overhead.
+    static constexpr std::size_t nodeBytes = sizeof(Node);
+
+    void insert(const T& value) { insertValue(value); }
+    void insert(T&& value) { insertValue(std::move(value)); }
+    void remove(const T& value);
+    bool search(const T& value);
+    void clear();
+
+    template <typename It>
+    void assign(It first, It last, unsigned threads = 1);
+    template <typename It>
+    void assign(SortedUnique, It first, It last);
+    // Read-only copy of the current contents in a cache-friendly layout.
+    FrozenSet<T> freeze() const;
+
+    std::size_t size() const { return nodeCount; }
+    bool isEmpty() const { return root == nullptr; }
+    int getTreeHeight() const;
+
+    void displayInorder() const;
+    void displayTree() const;
+
+private:
+    static Node* splay(Node* node, const T& value);
+
+    template <typename V>
+    void insertValue(V&& value);
+    template <typename It>
+    Node* build(It& it, std::size_t n);
+};
+
+
+// Brings the node holding value, or the last node on its search path, to
+// the top of the subtree and returns it. Nodes passed on the way down are
+// hung on a left tree (smaller than value) and a right tree (larger); a
+// zig-zig step rotates first, which is what halves the depth of the path.
+template <typename T, typename Splay, typename Alloc>
+typename SplayTree<T, Splay, Alloc>::Node* SplayTree<T, Splay, Alloc>::splay(Node* node, const T& value) {
+    Node* leftTree = nullptr;
+    Node* rightTree = nullptr;
+    Node** leftHook = &leftTree;
+    Node** rightHook = &rightTree;
+
+    for (;;) {
+        if (value < node->data) {
+            if (node->left == nullptr) {
+                break;
+            }
+            if (value < node->left->data) {
+                Node* up = node->left;
+                node->left = up->right;
+                up->right = node;
+                node = up;
+                if (node->left == nullptr) {
+                    break;
+                }
+            }
+            *rightHook = node;
+            rightHook = &node->left;
+            node = node->left;
+        }
+        else if (value > node->data) {
+            if (node->right == nullptr) {
+                break;
+            }
+            if (value > node->right->data) {
+                Node* up = node->right;
+                node->right = up->left;
+                up->left = node;
+                node = up;
+                if (node->right == nullptr) {
+                    break;
+                }
+            }
+            *leftHook = node;
+            leftHook = &node->right;
+            node = node->right;
+        }
+        else {
+            break;
+        }
+    }
+
+    *leftHook = node->left;
+    *rightHook = node->right;
+    node->left = leftTree;
+    node->right = rightTree;
+    return node;
+}
+
+
+template <typename T, typename Splay, typename Alloc>
+template <typename V>
+void SplayTree<T, Splay, Alloc>::insertValue(V&& value) {
+    if (root == nullptr) {
+        root = pool.create(std::forward<V>(value));
+        nodeCount++;
+        return;
+    }
+
+    root = splay(root, value);
+    bool less = value < root->data;
+    if (!less && !(value > root->data)) {
+        return;
+    }
+
+    Node* node = pool.create(std::forward<V>(value));
+    if (less) {
+        node->left = root->left;
+        node->right = root;
+        root->left = nullptr;
+    }
+    else {
+        node->right = root->right;
+        node->left = root;
+        root->right = nullptr;
+    }
+    root = node;
+    nodeCount++;
+}
+
+// Splays value to the root, then joins the two subtrees: splaying the left
+// one for value brings its maximum up, which has no right child.
+template <typename T, typename Splay, typename Alloc>
+void SplayTree<T, Splay, Alloc>::remove(const T& value) {
+    if (root == nullptr) {
+        return;
+    }
+
+    root = splay(root, value);
+    if (value < root->data || value > root->data) {
+        return;
+    }
+
+    Node* node = root;
+    if (node->left == nullptr) {
+        root = node->right;
+    }
+    else {
+        root = splay(node->left, value);
+        root->right = node->right;
+    }
+    pool.destroy(node);
+    nodeCount--;
+}
+
+// Under a policy that does not always splay, the lookup first descends
+// read-only and splays (a second pass over a path now in cache) only when
+// the policy asks for it.
+template <typename T, typename Splay, typename Alloc>
+bool SplayTree<T, Splay, Alloc>::search(const T& value) {
+    if (root == nullptr) {
+        return false;
+    }
+
+    if constexpr (Splay::always) {
+        root = splay(root, value);
+        return !(value < root->data) && !(value > root->data);
+    }
+    else {
+        const Node* node = root;
+        std::size_t depth = 0;
+        bool found = false;
+        while (node != nullptr) {
+            depth++;
+            if (value < node->data) {
+                node = node->left;
+            }
+            else if (value > node->data) {
+                node = node->right;
+            }
+            else {
+                found = true;
+                break;
+            }
+        }
+        if (policy(depth)) {
+            root = splay(root, value);
+        }
+        return found;
+    }
+}
+
+
+template <typename T, typename Splay, typename Alloc>
+void SplayTree<T, Splay, Alloc>::clear() {
+    if constexpr (bulkClear) {
+        pool.releaseAll();
+    }
+    else {
+        destroyNodes(pool, root,
+            [](Node* node, int dir) { return dir ? node->right : node->left; },
+            [](Node* node, int dir, Node* child) { (dir ? node->right : node->left) = child; });
+    }
+    root = nullptr;
+    nodeCount = 0;
+}
+
+
+// Builds a perfectly balanced subtree from the next n sorted values of it.
+template <typename T, typename Splay, typename Alloc>
+template <typename It>
+typename SplayTree<T, Splay, Alloc>::Node* SplayTree<T, Splay, Alloc>::build(It& it, std::size_t n) {
+    if (n == 0) {
+        return nullptr;
+    }
+
+    std::size_t leftSize = (n - 1) / 2;
+    Node* left = build(it, leftSize);
+    Node* node = pool.create(*it);
+    ++it;
+    node->left = left;
+    node->right = build(it, n - 1 - leftSize);
+    return node;
+}
+
+template <typename T, typename Splay, typename Alloc>
+template <typename It>
+void SplayTree<T, Splay, Alloc>::assign(It first, It last, unsigned threads) {
+    std::vector<T> values(first, last);
+    sortUnique(values, threads);
+    assign(sortedUnique, std::make_move_iterator(values.begin()), std::make_move_iterator(values.end()));
+}
+
+template <typename T, typename Splay, typename Alloc>
+template <typename It>
+void SplayTree<T, Splay, Alloc>::assign(SortedUnique, It first, It last) {
+    clear();
+    nodeCount = static_cast<std::size_t>(std::distance(first, last));
+    root = build(first, nodeCount);
+}
+
+template <typename T, typename Splay, typename Alloc>
+FrozenSet<T> SplayTree<T, Splay, Alloc>::freeze() const {
+    std::vector<T> values;
+    values.reserve(nodeCount);
+    std::vector<const Node*> path;
+    const Node* node = root;
+    while (node != nullptr || !path.empty()) {
+        if (node != nullptr) {
+            path.push_back(node);
+            node = node->left;
+        }
+        else {
+            node = path.back();
+            path.pop_back();
+            values.push_back(node->data);
+            node = node->right;
+        }
+    }
+    return FrozenSet<T>(sortedUnique, std::make_move_iterator(values.begin()), values.size());
+}
+
+
+// Level by level, since a splay tree can be as deep as it has nodes.
+template <typename T, typename Splay, typename Alloc>
+int SplayTree<T, Splay, Alloc>::getTreeHeight() const {
+    std::vector<const Node*> level;
+    std::vector<const Node*> next;
+    if (root != nullptr) {
+        level.push_back(root);
+    }
+    int height = 0;
+    while (!level.empty()) {
+        height++;
+        next.clear();
+        for (const Node* n : level) {
+            if (n->left != nullptr) {
+                next.push_back(n->left);
+            }
+            if (n->right != nullptr) {
+                next.push_back(n->right);
+            }
+        }
+        level.swap(next);
+    }
+    return height;
+}
+
+
+template <typename T, typename Splay, typename Alloc>
+void SplayTree<T, Splay, Alloc>::displayInorder() const {
+    std::cout << "Inorder traversal: ";
+    std::vector<const Node*> path;
+    const Node* node = root;
+    while (node != nullptr || !path.empty()) {
+        if (node != nullptr) {
+            path.push_back(node);
+            node = node->left;
+        }
+        else {
+            node = path.back();
+            path.pop_back();
+            std::cout << node->data << " ";
+            node = node->right;
+        }
+    }
+    std::cout << std::endl;
+}
+
+template <typename T, typename Splay, typename Alloc>
+void SplayTree<T, Splay, Alloc>::displayTree() const {
+    std::cout << "\nДерево (вертикальный вид):\n";
+    std::cout << "==========================\n";
+    printSideways(root, 0, 0, true);
+    std::cout << "==========================\n";
+}
@@ -0,0 +1,1078 @@
+#include "Laba2_BST.h"
+#include "Laba2_AVL.h"
+#include "Laba2_RBT.h"
+#include "Laba2_Map.h"
+#include "Laba2_Multiset.h"
+#include "Laba2_WAVL.h"
+#include "Laba2_Splay.h"
+#include "Laba2_ConcurrentRBT.h"
+#include "Laba2_PersistentAVL.h"
+#include "Laba2_TopDownRBT.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <limits>
+#include <map>
+#include <memory>
+#include <random>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Randomized differential checks: every tree runs the same random
+// operations as std::set, std::map or std::multiset, and after each round
+// its contents, size() and structural invariants are compared. Prints
+// one line per section and exits non-zero if any check failed.
+//
+//   Laba2_Test [seed]
+
+namespace {
+
+int g_failures = 0;
+
+#define CHECK(cond)                                                                   \
+    do {                                                                              \
+        if (!(cond)) {                                                                \
+            std::cerr << __FILE__ << ":" << __LINE__ << ": check failed: " #cond "\n"; \
+            g_failures++;                                                             \
+        }                                                                             \
+    } while (0)
+
+template <typename Tree>
+bool sameContents(const Tree& tree, const std::set<int>& expected) {
+    return tree.size() == expected.size() && std::equal(tree.begin(), tree.end(), expected.begin(), expected.end());
+}
+
+void section(const char* name, int failuresBefore) {
+    std::cout << (g_failures == failuresBefore ? "ok    " : "FAIL  ") << name << std::endl;
+}
+
+// The trees without iterators are compared through freeze(): every key of
+// [-1, hi] must have the same lower bound in both.
+bool sameFrozen(const FrozenSet<int>& frozen, const std::set<int>& expected, int hi) {
+    if (frozen.size() != expected.size()) {
+        return false;
+    }
+    for (int key = -1; key <= hi; key++) {
+        const int* found = frozen.lower_bound(key);
+        auto at = expected.lower_bound(key);
+        if (at == expected.end() ? found != nullptr : found == nullptr || *found != *at) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Random inserts and removes over a small key space, so both hit often.
+template <typename Tree>
+void testSet(const char* name, std::uint64_t seed) {
+    int before = g_failures;
+    Tree tree;
+    std::set<int> expected;
+    std::mt19937_64 rng(seed);
+    for (int round = 0; round < 200; round++) {
+        for (int i = 0; i < 100; i++) {
+            int key = static_cast<int>(rng() % 1000);
+            if (rng() % 3) {
+                tree.insert(key);
+                expected.insert(key);
+            }
+            else {
+                tree.remove(key);
+                expected.erase(key);
+            }
+        }
+        CHECK(tree.isValid());
+        CHECK(sameContents(tree, expected));
+        int key = static_cast<int>(rng() % 1000);
+        CHECK(tree.search(key) == (expected.count(key) != 0));
+    }
+
+    // Drain in random order, checking after every remove.
+    std::vector<int> keys(expected.begin(), expected.end());
+    std::shuffle(keys.begin(), keys.end(), rng);
+    bool valid = true;
+    for (int key : keys) {
+        tree.remove(key);
+        valid = valid && tree.isValid();
+    }
+    CHECK(valid && tree.size() == 0 && tree.begin() == tree.end());
+    section(name, before);
+}
+
+template <typename Tree>
+void fill(Tree& tree, std::set<int>& expected, std::mt19937_64& rng, std::size_t count, int lo, int hi) {
+    for (std::size_t i = 0; i < count; i++) {
+        int key = lo + static_cast<int>(rng() % static_cast<std::uint64_t>(hi - lo));
+        tree.insert(key);
+        expected.insert(key);
+    }
+}
+
+// After being emptied or given nodes by another tree, a tree must still
+// take inserts and removes of its own.
+template <typename Tree>
+void checkUsable(Tree& tree, std::set<int>& expected, std::mt19937_64& rng) {
+    for (int i = 0; i < 50; i++) {
+        int key = static_cast<int>(rng() % 2000);
+        if (i % 2) {
+            tree.insert(key);
+            expected.insert(key);
+        }
+        else {
+            tree.remove(key);
+            expected.erase(key);
+        }
+    }
+    CHECK(tree.isValid());
+    CHECK(sameContents(tree, expected));
+}
+
+// Sizes are drawn so that either side can be the much smaller one.
+std::size_t drawSize(std::mt19937_64& rng) {
+    static const std::size_t sizes[] = { 0, 1, 3, 20, 300, 1500 };
+    return sizes[rng() % 6];
+}
+
+template <typename Tree>
+void testJoinSplit(const char* name, std::uint64_t seed) {
+    int before = g_failures;
+    std::mt19937_64 rng(seed);
+    for (int round = 0; round < 60; round++) {
+        Tree left, right;
+        std::set<int> expectedLeft, expectedRight;
+        fill(left, expectedLeft, rng, drawSize(rng), 0, 1000);
+        fill(right, expectedRight, rng, drawSize(rng), 1001, 2000);
+        left.join(1000, right);
+        expectedLeft.insert(1000);
+        expectedLeft.insert(expectedRight.begin(), expectedRight.end());
+        expectedRight.clear();
+        CHECK(left.isValid() && right.isValid());
+        CHECK(sameContents(left, expectedLeft) && sameContents(right, expectedRight));
+
+        int key = static_cast<int>(rng() % 2000);
+        bool present = left.split(key, right);
+        CHECK(present == (expectedLeft.count(key) != 0));
+        expectedRight.insert(expectedLeft.upper_bound(key), expectedLeft.end());
+        expectedLeft.erase(expectedLeft.lower_bound(key), expectedLeft.end());
+        CHECK(left.isValid() && right.isValid());
+        CHECK(sameContents(left, expectedLeft) && sameContents(right, expectedRight));
+        checkUsable(left, expectedLeft, rng);
+        checkUsable(right, expectedRight, rng);
+    }
+
+    Tree tree;
+    tree.insert(1);
+    bool threw = false;
+    try {
+        tree.join(2, tree);
+    }
+    catch (const std::invalid_argument&) {
+        threw = true;
+    }
+    CHECK(threw && tree.isValid() && tree.size() == 1);
+    threw = false;
+    try {
+        tree.split(1, tree);
+    }
+    catch (const std::invalid_argument&) {
+        threw = true;
+    }
+    CHECK(threw && tree.isValid() && tree.size() == 1 && tree.search(1));
+    section(name, before);
+}
+
+template <typename Tree>
+void testSetAlgebra(const char* name, std::uint64_t seed) {
+    int before = g_failures;
+    std::mt19937_64 rng(seed);
+    for (int round = 0; round < 80; round++) {
+        Tree a, b;
+        std::set<int> expectedA, expectedB, result;
+        fill(a, expectedA, rng, drawSize(rng), 0, 2000);
+        fill(b, expectedB, rng, drawSize(rng), 0, 2000);
+
+        int op = round % 5;
+        if (op == 0) {
+            a.union_with(b);
+            std::set_union(expectedA.begin(), expectedA.end(), expectedB.begin(), expectedB.end(), std::inserter(result, result.end()));
+            expectedB.clear();
+        }
+        else if (op == 1) {
+            a.intersect_with(b);
+            std::set_intersection(expectedA.begin(), expectedA.end(), expectedB.begin(), expectedB.end(), std::inserter(result, result.end()));
+            expectedB.clear();
+        }
+        else if (op == 2) {
+            a.difference_with(b);
+            std::set_difference(expectedA.begin(), expectedA.end(), expectedB.begin(), expectedB.end(), std::inserter(result, result.end()));
+            expectedB.clear();
+        }
+        else if (op == 3) {
+            a.merge(b);
+            std::set<int> dups;
+            std::set_intersection(expectedA.begin(), expectedA.end(), expectedB.begin(), expectedB.end(), std::inserter(dups, dups.end()));
+            std::set_union(expectedA.begin(), expectedA.end(), expectedB.begin(), expectedB.end(), std::inserter(result, result.end()));
+            expectedB = dups;
+        }
+        else {
+            a.filter([](int key) { return key % 3 != 0; });
+            for (int key : expectedA) {
+                if (key % 3 != 0) {
+                    result.insert(key);
+                }
+            }
+        }
+        CHECK(a.isValid() && b.isValid());
+        CHECK(sameContents(a, result) && sameContents(b, expectedB));
+        checkUsable(a, result, rng);
+        checkUsable(b, expectedB, rng);
+    }
+    section(name, before);
+}
+
+template <typename Tree>
+bool sameEntry(const Tree& tree, typename Tree::const_iterator it, const std::set<int>& expected, std::set<int>::const_iterator at) {
+    return at == expected.end() ? it == tree.end() : it != tree.end() && *it == *at;
+}
+
+std::uint64_t descents(const TreeStats& stats) {
+    std::uint64_t total = 0;
+    for (std::uint64_t count : stats.pathLength) {
+        total += count;
+    }
+    return total;
+}
+
+// Each bound lookup and each key of a batch lookup is one descent in the
+// Counting stats, and the bounds agree with std::set's.
+template <typename Tree>
+void testLookupStats(const char* name, std::uint64_t seed) {
+    int before = g_failures;
+    std::mt19937_64 rng(seed);
+    Tree tree;
+    std::set<int> expected;
+    fill(tree, expected, rng, 1500, 0, 4000);
+    tree.resetStats();
+    std::uint64_t lookups = 0;
+    for (int i = 0; i < 500; i++) {
+        int key = static_cast<int>(rng() % 4100) - 50;
+        auto lower = expected.lower_bound(key);
+        auto upper = expected.upper_bound(key);
+        auto below = [&expected](std::set<int>::const_iterator it) { return it == expected.begin() ? expected.end() : std::prev(it); };
+        CHECK(sameEntry(tree, tree.lower_bound(key), expected, lower));
+        CHECK(sameEntry(tree, tree.upper_bound(key), expected, upper));
+        CHECK(sameEntry(tree, tree.floor(key), expected, below(upper)));
+        CHECK(sameEntry(tree, tree.predecessor(key), expected, below(lower)));
+        lookups += 4;
+    }
+    int keys[64];
+    bool found[64];
+    for (int& key : keys) {
+        key = static_cast<int>(rng() % 4000);
+    }
+    tree.contains_batch(keys, 64, found);
+    lookups += 64;
+    for (int i = 0; i < 64; i++) {
+        CHECK(found[i] == (expected.count(keys[i]) != 0));
+    }
+    TreeStats stats = tree.stats();
+    CHECK(descents(stats) == lookups);
+    CHECK(stats.comparisons >= lookups);
+    section(name, before);
+}
+
+// Unsorted batches with duplicates, so insert_batch / erase_batch have to
+// sort and deduplicate them; the returned counts are checked as well.
+template <typename Tree>
+void testBatch(const char* name, std::uint64_t seed) {
+    int before = g_failures;
+    std::mt19937_64 rng(seed);
+    Tree tree;
+    std::set<int> expected;
+    for (int round = 0; round < 40; round++) {
+        std::vector<int> batch(drawSize(rng) * 2);
+        for (int& v : batch) {
+            v = static_cast<int>(rng() % 5000);
+        }
+        std::size_t changed = 0;
+        if (round % 3 == 0) {
+            for (int v : batch) {
+                changed += expected.insert(v).second;
+            }
+            CHECK(tree.insert_batch(batch.begin(), batch.end()) == changed);
+        }
+        else if (round % 3 == 1) {
+            for (int v : batch) {
+                changed += expected.erase(v);
+            }
+            CHECK(tree.erase_batch(batch.begin(), batch.end()) == changed);
+        }
+        else {
+            expected.insert(batch.begin(), batch.end());
+            std::vector<int> tail(expected.upper_bound(2500), expected.end());
+            std::vector<int> upper(tail.rbegin(), tail.rend());
+            tree.insert_batch(batch.begin(), batch.end());
+            tree.erase_batch(sortedUnique, tail.begin(), tail.end());
+            tree.insert_batch(upper.begin(), upper.end());
+        }
+        CHECK(tree.isValid() && sameContents(tree, expected));
+    }
+
+    // Large enough for the multi-threaded sort to split into chunks.
+    std::vector<int> values(std::size_t(3) << 16);
+    for (int& v : values) {
+        v = static_cast<int>(rng() % 100000);
+    }
+    std::set<int> all(values.begin(), values.end());
+    Tree serial(values.begin(), values.end());
+    Tree threaded(values.begin(), values.end(), 3);
+    CHECK(serial.isValid() && sameContents(serial, all));
+    CHECK(threaded.isValid() && sameContents(threaded, all));
+    CHECK(threaded.erase_batch(values.begin(), values.end(), 2) == all.size() && threaded.size() == 0);
+    section(name, before);
+}
+
+// The Parallel forms on a small pool with a low cutoff, so that they
+// really fork, against the same std::set results as the serial ones.
+template <typename Tree>
+void testParallel(const char* name, std::uint64_t seed) {
+    int before = g_failures;
+    ForkJoinPool pool(4);
+    Parallel policy;
+    policy.pool = &pool;
+    policy.cutoff = 64;
+    std::mt19937_64 rng(seed);
+    for (int round = 0; round < 20; round++) {
+        std::vector<int> values(drawSize(rng) * 20);
+        for (int& v : values) {
+            v = static_cast<int>(rng() % 20000);
+        }
+        Tree a;
+        a.assign(policy, values.begin(), values.end());
+        std::set<int> expectedA(values.begin(), values.end());
+        CHECK(a.isValid() && sameContents(a, expectedA));
+
+        Tree b;
+        std::set<int> expectedB, result;
+        fill(b, expectedB, rng, drawSize(rng) * 10, 0, 20000);
+        if (round % 2) {
+            a.union_with(policy, b);
+            std::set_union(expectedA.begin(), expectedA.end(), expectedB.begin(), expectedB.end(), std::inserter(result, result.end()));
+        }
+        else {
+            a.difference_with(policy, b);
+            std::set_difference(expectedA.begin(), expectedA.end(), expectedB.begin(), expectedB.end(), std::inserter(result, result.end()));
+        }
+        a.filter(policy, [](int key) { return key % 5 != 0; });
+        for (auto it = result.begin(); it != result.end();) {
+            it = *it % 5 == 0 ? result.erase(it) : std::next(it);
+        }
+        CHECK(a.isValid() && b.isValid() && sameContents(a, result) && b.size() == 0);
+    }
+    section(name, before);
+}
+
+// Lookups restructure a splay tree, so they are mixed in with the updates
+// rather than only checked at the end of a round.
+template <typename Tree>
+void testSplay(const char* name, std::uint64_t seed) {
+    int before = g_failures;
+    std::mt19937_64 rng(seed);
+    Tree tree;
+    std::set<int> expected;
+    for (int round = 0; round < 100; round++) {
+        for (int i = 0; i < 100; i++) {
+            int key = static_cast<int>(rng() % 1000);
+            switch (rng() % 4) {
+            case 0:
+            case 1:
+                tree.insert(key);
+                expected.insert(key);
+                break;
+            case 2:
+                tree.remove(key);
+                expected.erase(key);
+                break;
+            default:
+                CHECK(tree.search(key) == (expected.count(key) != 0));
+                break;
+            }
+        }
+        CHECK(tree.size() == expected.size() && tree.isEmpty() == expected.empty());
+        CHECK(sameFrozen(tree.freeze(), expected, 1000));
+    }
+
+    std::vector<int> values(expected.begin(), expected.end());
+    std::shuffle(values.begin(), values.end(), rng);
+    tree.assign(values.begin(), values.end());
+    CHECK(sameFrozen(tree.freeze(), expected, 1000));
+    CHECK(tree.getTreeHeight() <= static_cast<int>(std::log2(values.size() + 1)) + 1);
+    for (int key : values) {
+        tree.remove(key);
+    }
+    CHECK(tree.isEmpty() && tree.size() == 0 && tree.getTreeHeight() == 0);
+    section(name, before);
+}
+
+// Inserts in sorted order degenerate a plain BST into a list; in scapegoat
+// mode the height must stay within log(n) / log(1 / alpha) plus the slack
+// removes are allowed before the whole tree is rebuilt.
+template <typename Alloc>
+void testScapegoat(const char* name, std::uint64_t seed) {
+    int before = g_failures;
+    std::mt19937_64 rng(seed);
+    BST<int, Alloc> tree;
+    std::set<int> expected;
+    for (int key = 0; key < 500; key++) {
+        tree.insert(key);
+        expected.insert(key);
+    }
+    CHECK(tree.getTreeHeight() == 500);
+
+    const double alphas[] = { 0.55, 0.7, 0.9 };
+    for (double alpha : alphas) {
+        tree.enableRebalance(alpha);
+        auto bound = [&tree, alpha] {
+            double n = static_cast<double>(tree.size()) + 1;
+            return static_cast<int>(std::log(n) / std::log(1.0 / alpha)) + 3;
+        };
+        CHECK(tree.getTreeHeight() <= static_cast<int>(std::log2(tree.size() + 1)) + 1);
+        for (int round = 0; round < 20; round++) {
+            for (int i = 0; i < 200; i++) {
+                // Mostly ascending keys, the worst case for a plain BST.
+                int key = rng() % 4 ? 500 + round * 200 + i : static_cast<int>(rng() % 4500);
+                if (rng() % 3) {
+                    tree.insert(key);
+                    expected.insert(key);
+                }
+                else {
+                    tree.remove(key);
+                    expected.erase(key);
+                }
+            }
+            CHECK(tree.getTreeHeight() <= bound());
+            CHECK(sameFrozen(tree.freeze(), expected, 4500));
+        }
+        int key = static_cast<int>(rng() % 4500);
+        CHECK(tree.search(key) == (expected.count(key) != 0));
+    }
+
+    tree.disableRebalance();
+    for (int key = 5000; key < 5100; key++) {
+        tree.insert(key);
+    }
+    CHECK(tree.getTreeHeight() >= 100);
+
+    bool threw = false;
+    try {
+        tree.enableRebalance(0.5);
+    }
+    catch (const std::invalid_argument&) {
+        threw = true;
+    }
+    CHECK(threw);
+    section(name, before);
+}
+
+// Elements keep their addresses while other keys come and go, and each
+// remove takes at most one rebalancing step (single or double rotation).
+template <typename Tree>
+void testWAVL(const char* name, std::uint64_t seed) {
+    int before = g_failures;
+    Tree tree;
+    std::set<int> expected;
+    std::mt19937_64 rng(seed);
+    for (int key = 0; key < 1000; key += 2) {
+        tree.insert(key);
+        expected.insert(key);
+    }
+    const int* held = &*tree.find(500);
+    for (int i = 0; i < 20000; i++) {
+        int key = static_cast<int>(rng() % 1000);
+        if (key == 500) {
+            continue;
+        }
+        if (rng() % 2) {
+            tree.insert(key);
+            expected.insert(key);
+        }
+        else {
+            TreeStats was = tree.stats();
+            tree.remove(key);
+            expected.erase(key);
+            TreeStats now = tree.stats();
+            CHECK(now.rotationsLL + now.rotationsLR + now.rotationsRR + now.rotationsRL
+                - was.rotationsLL - was.rotationsLR - was.rotationsRR - was.rotationsRL <= 1);
+        }
+        if (i % 100 == 0) {
+            CHECK(tree.isValid());
+            CHECK(sameContents(tree, expected));
+            CHECK(std::equal(tree.rbegin(), tree.rend(), expected.rbegin(), expected.rend()));
+        }
+    }
+    CHECK(held == &*tree.find(500));
+    for (int key = -1; key <= 1000; key++) {
+        auto lb = tree.lower_bound(key);
+        auto ub = tree.upper_bound(key);
+        auto elb = expected.lower_bound(key);
+        auto eub = expected.upper_bound(key);
+        CHECK(lb == tree.end() ? elb == expected.end() : elb != expected.end() && *lb == *elb);
+        CHECK(ub == tree.end() ? eub == expected.end() : eub != expected.end() && *ub == *eub);
+    }
+    section(name, before);
+}
+
+// Erasing one key must not move any other entry: references into the map
+// stay valid until their own key is erased.
+template <typename Map>
+void testMapReferences(const char* name, std::uint64_t seed) {
+    int before = g_failures;
+    Map map;
+    std::map<int, std::string> expected;
+    std::mt19937_64 rng(seed);
+    for (int key = 0; key < 500; key++) {
+        map[key] = std::to_string(key);
+        expected[key] = std::to_string(key);
+    }
+
+    std::vector<std::pair<int, std::string*>> held;
+    for (int key = 0; key < 500; key += 7) {
+        held.push_back({ key, &map[key] });
+    }
+    for (int i = 0; i < 400; i++) {
+        int key = static_cast<int>(rng() % 500);
+        if (key % 7 == 0) {
+            continue;
+        }
+        CHECK(map.erase(key) == expected.erase(key));
+    }
+    for (const auto& h : held) {
+        CHECK(*h.second == std::to_string(h.first));
+        CHECK(h.second == &map.find(h.first)->second);
+    }
+    CHECK(map.size() == expected.size());
+    CHECK(map.base().isValid());
+    section(name, before);
+}
+
+}  // namespace
+
+// Duplicates over a small key space, so counts go well above one and
+// erase_one often leaves the node in place.
+template <typename Multiset>
+void testMultiset(const char* name, std::uint64_t seed) {
+    int before = g_failures;
+    Multiset set;
+    std::multiset<int> expected;
+    std::mt19937_64 rng(seed);
+    for (int round = 0; round < 100; round++) {
+        for (int i = 0; i < 100; i++) {
+            int key = static_cast<int>(rng() % 200);
+            switch (rng() % 6) {
+            case 0:
+            case 1:
+                set.insert(key);
+                expected.insert(key);
+                break;
+            case 2: {
+                std::size_t copies = rng() % 4;
+                auto it = set.insert(key, copies);
+                for (std::size_t c = 0; c < copies; c++) {
+                    expected.insert(key);
+                }
+                CHECK(expected.count(key) == 0 ? it == set.end() : it != set.end() && it->value == key);
+                break;
+            }
+            case 3: {
+                auto it = expected.find(key);
+                bool had = it != expected.end();
+                if (had) {
+                    expected.erase(it);
+                }
+                CHECK(set.erase_one(key) == had);
+                break;
+            }
+            case 4:
+                CHECK(set.erase_all(key) == expected.erase(key));
+                break;
+            default:
+                CHECK(set.count(key) == expected.count(key));
+                CHECK(set.contains(key) == (expected.count(key) != 0));
+                break;
+            }
+        }
+
+        CHECK(set.size() == expected.size() && set.empty() == expected.empty());
+        CHECK(set.base().isValid());
+        std::size_t distinct = 0;
+        bool same = true;
+        for (auto it = set.begin(); it != set.end(); ++it) {
+            distinct++;
+            same = same && it->count > 0 && it->count == expected.count(it->value);
+        }
+        std::set<int> keys(expected.begin(), expected.end());
+        CHECK(same && distinct == keys.size() && set.distinct() == keys.size());
+        int key = static_cast<int>(rng() % 200);
+        auto lower = set.lower_bound(key);
+        auto upper = set.upper_bound(key);
+        auto expectedLower = keys.lower_bound(key);
+        auto expectedUpper = keys.upper_bound(key);
+        CHECK(expectedLower == keys.end() ? lower == set.end() : lower != set.end() && lower->value == *expectedLower);
+        CHECK(expectedUpper == keys.end() ? upper == set.end() : upper != set.end() && upper->value == *expectedUpper);
+    }
+    set.clear();
+    CHECK(set.empty() && set.size() == 0 && set.distinct() == 0);
+    section(name, before);
+}
+
+std::vector<char> readFile(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    return std::vector<char>(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+void writeFile(const std::string& path, const std::vector<char>& bytes) {
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+}
+
+template <typename F>
+bool throwsRuntimeError(F f) {
+    try {
+        f();
+    }
+    catch (const std::runtime_error&) {
+        return true;
+    }
+    return false;
+}
+
+template <typename Mapped>
+bool sameRange(const Mapped& tree, const std::set<int>& expected, int lo, int hi) {
+    std::vector<int> seen;
+    tree.for_range(lo, hi, [&seen](int key) { seen.push_back(key); });
+    return std::equal(seen.begin(), seen.end(), expected.lower_bound(lo), expected.upper_bound(hi));
+}
+
+// Snapshot files: a saved tree reopened in place must answer like the
+// std::set it was saved from, the first write must move it into a regular
+// tree, and damaged files must be refused when opened.
+template <typename Tree>
+void testMapped(const char* name, std::uint64_t seed) {
+    int before = g_failures;
+    std::mt19937_64 rng(seed);
+    std::string path = (std::filesystem::temp_directory_path() / "laba2_test.snapshot").string();
+    const std::size_t sizes[] = { 0, 1, 2, 1500 };
+    for (std::size_t n : sizes) {
+        Tree tree;
+        std::set<int> expected;
+        while (expected.size() < n) {
+            int key = static_cast<int>(rng() % 4000);
+            tree.insert(key);
+            expected.insert(key);
+        }
+        tree.save(path);
+
+        auto mapped = Tree::open_mapped(path);
+        CHECK(mapped.isMapped() && mapped.size() == n && mapped.isEmpty() == (n == 0));
+        CHECK(sameRange(mapped, expected, -1, 4000));
+        for (int i = 0; i < 200; i++) {
+            int key = static_cast<int>(rng() % 4100) - 50;
+            int hi = key + static_cast<int>(rng() % 300);
+            CHECK(mapped.search(key) == (expected.count(key) != 0));
+            CHECK(sameRange(mapped, expected, key, hi));
+        }
+
+        int key = static_cast<int>(rng() % 4000);
+        if (n % 2) {
+            mapped.remove(key);
+            expected.erase(key);
+        }
+        else {
+            mapped.insert(key);
+            expected.insert(key);
+        }
+        CHECK(!mapped.isMapped() && mapped.promote().isValid());
+        CHECK(mapped.size() == expected.size() && sameRange(mapped, expected, -1, 4000));
+        CHECK(sameContents(mapped.promote(), expected));
+    }
+
+    // Two elements; record i starts at byte 64 + 12 i, and the header
+    // keeps the root index at byte 28 and the checksum at byte 40.
+    Tree pair;
+    pair.insert(10);
+    pair.insert(20);
+    pair.save(path);
+    std::vector<char> good = readFile(path);
+    std::vector<char> bad(good.begin(), good.end() - 1);
+    writeFile(path, bad);
+    CHECK(throwsRuntimeError([&path] { Tree::open_mapped(path); }));
+    bad = good;
+    bad[64] ^= 1;
+    writeFile(path, bad);
+    CHECK(throwsRuntimeError([&path] { Tree::open_mapped(path); }));
+    writeFile(path, good);
+    CHECK(throwsRuntimeError([&path] { MappedSet<double>{ path }; }));
+
+    // A cycle, 1 -> left 0 -> right 1, with a valid checksum (the same
+    // hash as MappedSet::checksum, seeded with the root).
+    bad = good;
+    std::uint32_t records[6] = { 10, 0xFFFFFFFF, 1, 20, 0, 0xFFFFFFFF };
+    std::uint32_t root = 1;
+    std::memcpy(&bad[64], records, sizeof(records));
+    std::memcpy(&bad[28], &root, sizeof(root));
+    const std::uint64_t prime = 0x9E3779B97F4A7C15ull;
+    std::uint64_t hash = root ^ (sizeof(records) * prime);
+    for (std::size_t i = 0; i < sizeof(records); i += 8) {
+        std::uint64_t word = 0;
+        std::memcpy(&word, reinterpret_cast<const char*>(records) + i, std::min<std::size_t>(sizeof(records) - i, 8));
+        hash = (hash ^ word) * prime;
+        hash ^= hash >> 29;
+    }
+    std::memcpy(&bad[40], &hash, sizeof(hash));
+    writeFile(path, bad);
+    CHECK(throwsRuntimeError([&path] { Tree::open_mapped(path); }));
+    std::filesystem::remove(path);
+    section(name, before);
+}
+
+template <typename Tree>
+std::vector<int> rangeOf(const Tree& tree, int lo, int hi) {
+    std::vector<int> seen;
+    tree.for_range(lo, hi, [&seen](int key) { seen.push_back(key); });
+    return seen;
+}
+
+void testConcurrent(std::uint64_t seed) {
+    int before = g_failures;
+    std::mt19937_64 rng(seed);
+    {
+        ConcurrentRBTree<int> tree;
+        std::set<int> expected;
+        for (int round = 0; round < 100; round++) {
+            for (int i = 0; i < 100; i++) {
+                int key = static_cast<int>(rng() % 1000);
+                if (rng() % 3) {
+                    CHECK(tree.insert(key) == expected.insert(key).second);
+                }
+                else {
+                    CHECK(tree.remove(key) == (expected.erase(key) != 0));
+                }
+            }
+            int key = static_cast<int>(rng() % 1000);
+            int hi = key + static_cast<int>(rng() % 400);
+            std::vector<int> seen = rangeOf(tree, key, hi);
+            CHECK(tree.search(key) == (expected.count(key) != 0));
+            CHECK(std::equal(seen.begin(), seen.end(), expected.lower_bound(key), expected.upper_bound(hi)));
+            CHECK(tree.size() == expected.size() && tree.isEmpty() == expected.empty());
+        }
+        std::vector<int> all = rangeOf(tree, -1, 1000);
+        CHECK(std::equal(all.begin(), all.end(), expected.begin(), expected.end()));
+    }
+    section("concurrent rbt", before);
+
+    // One writer churns the odd keys while readers look for the even ones,
+    // which stay in the tree throughout, and scan ranges that must come
+    // out strictly increasing and hold every even key of the range.
+    before = g_failures;
+    {
+        ConcurrentRBTree<int> tree;
+        const int keys = 4000;
+        for (int key = 0; key < keys; key += 2) {
+            tree.insert(key);
+        }
+        std::atomic<bool> writing{ true };
+        std::atomic<int> readerFailures{ 0 };
+        std::vector<std::thread> readers;
+        for (unsigned r = 0; r < 3; r++) {
+            readers.emplace_back([&tree, &writing, &readerFailures, r, seed] {
+                std::mt19937_64 local(seed + r + 1);
+                do {
+                    int key = static_cast<int>(local() % keys) & ~1;
+                    if (!tree.search(key)) {
+                        readerFailures++;
+                    }
+                    int lo = static_cast<int>(local() % keys);
+                    int hi = lo + static_cast<int>(local() % 200);
+                    std::vector<int> seen = rangeOf(tree, lo, hi);
+                    int even = 0;
+                    for (std::size_t i = 0; i < seen.size(); i++) {
+                        if ((i > 0 && seen[i - 1] >= seen[i]) || seen[i] < lo || seen[i] > hi) {
+                            readerFailures++;
+                        }
+                        even += seen[i] % 2 == 0;
+                    }
+                    int first = lo + lo % 2;
+                    int last = std::min(hi, keys - 1);
+                    if (even != (last < first ? 0 : (last - first) / 2 + 1)) {
+                        readerFailures++;
+                    }
+                } while (writing.load());
+            });
+        }
+
+        std::set<int> odd;
+        for (int i = 0; i < 20000; i++) {
+            int key = static_cast<int>(rng() % keys) | 1;
+            if (rng() % 2) {
+                CHECK(tree.insert(key) == odd.insert(key).second);
+            }
+            else {
+                CHECK(tree.remove(key) == (odd.erase(key) != 0));
+            }
+        }
+        writing = false;
+        for (std::thread& reader : readers) {
+            reader.join();
+        }
+        CHECK(readerFailures == 0);
+        CHECK(tree.size() == keys / 2 + odd.size());
+        std::vector<int> all = rangeOf(tree, 0, keys);
+        CHECK(all.size() == tree.size() && std::is_sorted(all.begin(), all.end()));
+    }
+    section("concurrent rbt, one writer and three readers", before);
+
+    // Nodes retired while a reader is pinned outlive the reader's guard and
+    // are freed by a later reclaim; nothing stays pending for good.
+    before = g_failures;
+    {
+        struct Tracked {
+            std::atomic<int>* alive;
+            explicit Tracked(std::atomic<int>* alive) : alive(alive) { ++*alive; }
+            ~Tracked() { --*alive; }
+        };
+        std::atomic<int> alive{ 0 };
+        {
+            EpochDomain domain;
+            std::size_t retired = 0;
+            {
+                EpochDomain::Guard guard(domain);
+                for (int i = 0; i < 200; i++) {
+                    domain.retire(new Tracked(&alive));
+                    retired++;
+                }
+                domain.reclaim();
+                domain.reclaim();
+                CHECK(domain.pendingCount() == retired && alive == 200);
+            }
+            for (int i = 0; i < 3 && domain.pendingCount() > 0; i++) {
+                domain.reclaim();
+            }
+            CHECK(domain.pendingCount() == 0 && alive == 0);
+
+            for (int i = 0; i < 100; i++) {
+                domain.retire(new Tracked(&alive));
+            }
+        }
+        CHECK(alive == 0);
+    }
+    section("epoch reclamation", before);
+}
+
+template <typename Snapshot>
+bool sameSnapshot(const Snapshot& snapshot, const std::set<int>& expected, int lo, int hi) {
+    return snapshot.size() == expected.size() && snapshot.isEmpty() == expected.empty()
+        && std::equal(snapshot.begin(), snapshot.end(), expected.begin(), expected.end())
+        && sameRange(snapshot, expected, lo, hi);
+}
+
+// Snapshots taken along a random stream of writes must keep showing the
+// contents of their moment after later writes, a clear() and the
+// destruction of the tree.
+void testPersistent(std::uint64_t seed) {
+    int before = g_failures;
+    std::mt19937_64 rng(seed);
+    using Tree = PersistentAVLTree<int>;
+    std::vector<std::pair<Tree::Snapshot, std::set<int>>> taken;
+    {
+        Tree tree;
+        std::set<int> expected;
+        for (int round = 0; round < 60; round++) {
+            for (int i = 0; i < 100; i++) {
+                int key = static_cast<int>(rng() % 2000);
+                if (rng() % 3) {
+                    CHECK(tree.insert(key) == expected.insert(key).second);
+                }
+                else {
+                    CHECK(tree.remove(key) == (expected.erase(key) != 0));
+                }
+            }
+            if (round % 3 == 0) {
+                taken.emplace_back(tree.snapshot(), expected);
+            }
+
+            double n = static_cast<double>(tree.size());
+            CHECK(tree.getTreeHeight() <= static_cast<int>(1.4405 * std::log2(n + 2) - 0.3277));
+            CHECK(tree.size() == expected.size() && std::equal(tree.begin(), tree.end(), expected.begin(), expected.end()));
+            int key = static_cast<int>(rng() % 2000);
+            CHECK(tree.search(key) == (expected.count(key) != 0));
+            for (const auto& entry : taken) {
+                int lo = static_cast<int>(rng() % 2000);
+                CHECK(sameSnapshot(entry.first, entry.second, lo, lo + static_cast<int>(rng() % 300)));
+                CHECK(entry.first.search(key) == (entry.second.count(key) != 0));
+            }
+        }
+
+        tree.clear();
+        CHECK(tree.isEmpty() && tree.size() == 0 && tree.begin() == tree.end());
+        taken.emplace_back(tree.snapshot(), std::set<int>());
+        for (int key = 0; key < 300; key++) {
+            tree.insert(key * 7 % 300);
+        }
+        CHECK(tree.getTreeHeight() <= static_cast<int>(1.4405 * std::log2(302.0) - 0.3277));
+        std::set<int> last;
+        for (int key = 0; key < 300; key++) {
+            last.insert(key);
+        }
+        taken.emplace_back(tree.snapshot(), last);
+    }
+    for (const auto& entry : taken) {
+        Tree::Snapshot copy = entry.first;
+        CHECK(sameSnapshot(copy, entry.second, -1, 2000));
+    }
+    taken.clear();
+    section("persistent avl snapshots", before);
+}
+
+// FrozenSet on its own, over sizes around one block (16 ints, 8 64-bit
+// keys) and a few levels of blocks, with and without the type's maximum
+// as a real key, which is also what pads the last block. Queries are the
+// keys, their neighbours and random values, one at a time and batched.
+template <typename T, typename Draw>
+void testFrozen(const char* name, std::uint64_t seed, Draw draw) {
+    int before = g_failures;
+    std::mt19937_64 rng(seed);
+    const std::size_t sizes[] = { 0, 1, 7, 8, 9, 15, 16, 17, 31, 33, 300, 2000 };
+    for (std::size_t n : sizes) {
+        for (int withMax = 0; withMax < 2; withMax++) {
+            std::set<T> unique;
+            while (unique.size() < n) {
+                unique.insert(draw(rng));
+            }
+            if constexpr (std::numeric_limits<T>::is_specialized) {
+                if (withMax && n > 0) {
+                    unique.erase(std::prev(unique.end()));
+                    unique.insert(std::numeric_limits<T>::max());
+                }
+            }
+            std::vector<T> values(unique.begin(), unique.end());
+            FrozenSet<T> built(sortedUnique, values.begin(), values.end());
+            FrozenSet<T> frozen;
+            frozen = std::move(built);
+            CHECK(frozen.size() == n && frozen.empty() == (n == 0) && built.size() == 0);
+
+            std::vector<T> queries(values);
+            for (int i = 0; i < 200; i++) {
+                queries.push_back(draw(rng));
+            }
+            if constexpr (std::numeric_limits<T>::is_specialized) {
+                queries.push_back(std::numeric_limits<T>::max());
+                queries.push_back(std::numeric_limits<T>::lowest());
+                if constexpr (std::is_integral<T>::value) {
+                    for (T v : values) {
+                        if (v != std::numeric_limits<T>::max()) {
+                            queries.push_back(static_cast<T>(v + 1));
+                        }
+                        if (v != std::numeric_limits<T>::lowest()) {
+                            queries.push_back(static_cast<T>(v - 1));
+                        }
+                    }
+                }
+            }
+
+            std::vector<const T*> bounds(queries.size());
+            std::unique_ptr<bool[]> found(new bool[queries.size()]);
+            frozen.lower_bound_batch(queries.data(), queries.size(), bounds.data());
+            frozen.contains_batch(queries.data(), queries.size(), found.get());
+            bool same = true;
+            for (std::size_t i = 0; i < queries.size(); i++) {
+                const T& key = queries[i];
+                auto at = std::lower_bound(values.begin(), values.end(), key);
+                const T* single = frozen.lower_bound(key);
+                bool present = at != values.end() && !(key < *at);
+                same = same && (at == values.end() ? single == nullptr : single != nullptr && *single == *at);
+                same = same && (at == values.end() ? bounds[i] == nullptr : bounds[i] != nullptr && *bounds[i] == *at);
+                same = same && frozen.contains(key) == present && found[i] == present;
+            }
+            CHECK(same);
+        }
+    }
+    section(name, before);
+}
+
+int main(int argc, char** argv) {
+    std::uint64_t seed = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 42;
+
+    testSet<AVLTree<int>>("avl", seed);
+    testSet<AVLTree<int, Silent, SlabNodes<>, SubtreeSize>>("avl slab + subtree size", seed);
+    testSet<AVLTree<int, Silent, IndexedNodes<>>>("avl indexed", seed);
+    testSet<RBTree<int>>("rbt", seed);
+    testSet<RBTree<int, Silent, SlabNodes<>, SubtreeSize>>("rbt slab + subtree size", seed);
+    testSet<RBTree<int, Silent, IndexedNodes<>>>("rbt indexed", seed);
+    testJoinSplit<AVLTree<int>>("avl join / split", seed);
+    testJoinSplit<AVLTree<int, Silent, HeapNodes, SubtreeSize>>("avl join / split + subtree size", seed);
+    testJoinSplit<AVLTree<int, Silent, SlabNodes<>>>("avl slab join / split", seed);
+    testJoinSplit<RBTree<int>>("rbt join / split", seed);
+    testJoinSplit<RBTree<int, Silent, HeapNodes, SubtreeSize>>("rbt join / split + subtree size", seed);
+    testJoinSplit<RBTree<int, Silent, SlabNodes<>>>("rbt slab join / split", seed);
+    testSetAlgebra<AVLTree<int>>("avl set algebra", seed);
+    testSetAlgebra<AVLTree<int, Silent, SlabNodes<>, SubtreeSize>>("avl slab set algebra + subtree size", seed);
+    testSetAlgebra<RBTree<int>>("rbt set algebra", seed);
+    testSetAlgebra<RBTree<int, Silent, HeapNodes, SubtreeSize>>("rbt set algebra + subtree size", seed);
+    testSetAlgebra<RBTree<int, Silent, SlabNodes<>>>("rbt slab set algebra", seed);
+    testLookupStats<AVLTree<int, Counting>>("avl lookup stats", seed);
+    testLookupStats<RBTree<int, Counting, HeapNodes, SubtreeSize>>("rbt lookup stats + subtree size", seed);
+    testBatch<AVLTree<int>>("avl batch", seed);
+    testBatch<AVLTree<int, Silent, SlabNodes<>, SubtreeSize>>("avl slab batch + subtree size", seed);
+    testBatch<RBTree<int>>("rbt batch", seed);
+    testBatch<RBTree<int, Silent, IndexedNodes<>>>("rbt indexed batch", seed);
+    testParallel<AVLTree<int>>("avl parallel", seed);
+    testParallel<AVLTree<int, Silent, SlabNodes<>, SubtreeSize>>("avl slab parallel + subtree size", seed);
+    testParallel<RBTree<int>>("rbt parallel", seed);
+    testParallel<RBTree<int, Silent, SlabNodes<>>>("rbt slab parallel", seed);
+    testSet<TopDownRBTree<int>>("top-down rbt", seed);
+    testSet<TopDownRBTree<int, SlabNodes<>>>("top-down rbt slab", seed);
+    testSet<TopDownRBTree<int, IndexedNodes<>>>("top-down rbt indexed", seed);
+    testSet<WAVLTree<int>>("wavl", seed);
+    testSet<WAVLTree<int, Silent, IndexedNodes<>>>("wavl indexed", seed);
+    testWAVL<WAVLTree<int, Counting>>("wavl rotations and addresses", seed);
+    testWAVL<WAVLTree<int, Counting, SlabNodes<>>>("wavl slab rotations and addresses", seed);
+    testMapped<AVLTree<int>>("avl snapshot files", seed);
+    testMapped<RBTree<int, Silent, SlabNodes<>, SubtreeSize>>("rbt slab snapshot files + subtree size", seed);
+    testConcurrent(seed);
+    testPersistent(seed);
+    testFrozen<int>("frozen int", seed, [](std::mt19937_64& rng) { return static_cast<int>(rng() % 100000) - 50000; });
+    testFrozen<unsigned>("frozen unsigned", seed, [](std::mt19937_64& rng) { return static_cast<unsigned>(rng() >> 32); });
+    testFrozen<std::uint64_t>("frozen uint64", seed, [](std::mt19937_64& rng) { return rng(); });
+    testFrozen<double>("frozen double", seed, [](std::mt19937_64& rng) { return static_cast<double>(rng() % 100000) / 8 - 5000; });
+    testFrozen<std::string>("frozen string", seed, [](std::mt19937_64& rng) { return std::to_string(rng() % 100000); });
+    testSplay<SplayTree<int>>("splay", seed);
+    testSplay<SplayTree<int, SplayEveryNth<4>>>("splay every 4th lookup", seed);
+    testSplay<SplayTree<int, SplayDeeperThan<8>, SlabNodes<>>>("splay slab deeper than 8", seed);
+    testScapegoat<HeapNodes>("bst scapegoat", seed);
+    testScapegoat<SlabNodes<>>("bst slab scapegoat", seed);
+    testMapReferences<AVLMap<int, std::string>>("avl map references", seed);
+    testMapReferences<AVLMap<int, std::string, std::less<int>, HeapNodes, SubtreeSize>>("avl map references + subtree size", seed);
+    testMapReferences<RBMap<int, std::string>>("rbt map references", seed);
+    testMapReferences<RBMap<int, std::string, std::less<int>, SlabNodes<>, SubtreeSize>>("rbt slab map references + subtree size", seed);
+    testMultiset<AVLMultiset<int>>("avl multiset", seed);
+    testMultiset<AVLMultiset<int, std::less<int>, SlabNodes<>, SubtreeSize>>("avl slab multiset + subtree size", seed);
+    testMultiset<RBMultiset<int>>("rbt multiset", seed);
+    testMultiset<RBMultiset<int, std::less<int>, IndexedNodes<>>>("rbt indexed multiset", seed);
+
+    if (g_failures) {
+        std::cout << g_failures << " checks failed" << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,399 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "Laba2_Alloc.h"
+
+// Red-black tree balanced top-down, in the same pass as the descent.
+//
+// insert() splits 4-nodes (a black node with two red children) by color
+// flips on the way down and fixes a red parent with one or two rotations
+// right there, so the new leaf can be attached without walking back up.
+// remove() pushes a red node down ahead of itself, borrowing from the
+// sibling with rotations where needed, so the node it finally unlinks is
+// red and removing it changes no black height. Neither needs a parent
+// link, and the color rides in the spare bit of the left link, so a node
+// is just the element and two links.
+//
+// Besides the tree's nodes the algorithms use the slot above the root as a
+// stand-in parent; nullptr as a parent below means that slot.
+template <typename T, typename Alloc = HeapNodes>
+class TopDownRBTree {
+private:
+    struct Node {
+        using Link = typename Alloc::template Link<Node>;
+
+        T data;
+        Link right;
+
+        template <typename... Args>
+        explicit Node(Args&&... args) : data(std::forward<Args>(args)...), right(nullptr) {}
+
+        Node* child(int dir) const { return dir ? static_cast<Node*>(right) : leftAndColor.get(); }
+        void setChild(int dir, Node* node) {
+            if (dir) {
+                right = node;
+            }
+            else {
+                leftAndColor.set(node);
+            }
+        }
+        // Tag 0 is red, so a fresh node starts red.
+        bool red() const { return leftAndColor.tag() == 0; }
+        void setRed(bool red) { leftAndColor.setTag(red ? 0 : 1); }
+
+    private:
+        typename Alloc::template TaggedLink<Node> leftAndColor;
+    };
+
+    // Height stays below 2 * log2(n + 1).
+    static constexpr int kMaxHeight = 128;
+
+    using NodePool = typename Alloc::template Pool<Node>;
+    static constexpr bool bulkClear = NodePool::bulkRelease && std::is_trivially_destructible<T>::value;
+
+    Node* root;
+    std::size_t nodeCount;
+    NodePool pool;
+
+public:
+    class const_iterator;
+
+    TopDownRBTree() : root(nullptr), nodeCount(0) {}
+    ~TopDownRBTree() { clear(); }
+
+    TopDownRBTree(const TopDownRBTree&) = delete;
+    TopDownRBTree& operator=(const TopDownRBTree&) = delete;
+
+    // Bytes allocated per element, before allocator overhead.
+    static constexpr std::size_t nodeBytes = sizeof(Node);
+
+    // Return whether the element was added / removed.
+    bool insert(const T& value) { return insertValue(value); }
+    bool insert(T&& value) { return insertValue(std::move(value)); }
+    template <typename Key>
+    bool remove(const Key& value);
+    void clear();
+
+    template <typename Key>
+    bool search(const Key& value) const;
+    std::size_t size() const { return nodeCount; }
+    bool isEmpty() const { return root == nullptr; }
+    int getTreeHeight() const { return getHeight(root); }
+    int getBlackHeight() const;
+    // Checks order, the red-black rules (no red child of a red node, a
+    // black root, the same black height on every path) and size(), in
+    // O(n); for tests.
+    bool isValid() const;
+
+    const_iterator begin() const { return const_iterator(root); }
+    const_iterator end() const { return const_iterator(); }
+
+private:
+    static bool isRed(const Node* node) { return node != nullptr && node->red(); }
+    static int getHeight(const Node* node);
+    static int checkNode(const Node* node, const Node*& prev, std::size_t& count);
+
+    Node* childOf(Node* parent, int dir) const { return parent ? parent->child(dir) : (dir ? root : nullptr); }
+    void setChildOf(Node* parent, int dir, Node* node) {
+        if (parent) {
+            parent->setChild(dir, node);
+        }
+        else {
+            root = node;
+        }
+    }
+
+    static Node* rotate(Node* node, int dir);
+    static Node* rotateTwice(Node* node, int dir);
+
+    template <typename V>
+    bool insertValue(V&& value);
+};
+
+
+// In-order iterator holding a path stack, since nodes have no parent link.
+template <typename T, typename Alloc>
+class TopDownRBTree<T, Alloc>::const_iterator {
+public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = T;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const T*;
+    using reference = const T&;
+
+    const_iterator() = default;
+
+    reference operator*() const { return path.back()->data; }
+    pointer operator->() const { return &path.back()->data; }
+
+    const_iterator& operator++() {
+        const Node* node = path.back();
+        path.pop_back();
+        pushLeft(node->child(1));
+        return *this;
+    }
+    const_iterator operator++(int) { const_iterator old = *this; ++*this; return old; }
+
+    bool operator==(const const_iterator& other) const {
+        return path.empty() ? other.path.empty() : !other.path.empty() && path.back() == other.path.back();
+    }
+    bool operator!=(const const_iterator& other) const { return !(*this == other); }
+
+private:
+    friend class TopDownRBTree;
+    explicit const_iterator(const Node* root) {
+        path.reserve(kMaxHeight);
+        pushLeft(root);
+    }
+
+    void pushLeft(const Node* node) {
+        for (; node; node = node->child(0)) {
+            path.push_back(node);
+        }
+    }
+
+    std::vector<const Node*> path;
+};
+
+
+// Rotates node's child on side !dir up into its place and makes that child
+// black and node red; returns the new subtree root.
+template <typename T, typename Alloc>
+typename TopDownRBTree<T, Alloc>::Node* TopDownRBTree<T, Alloc>::rotate(Node* node, int dir) {
+    Node* up = node->child(!dir);
+    node->setChild(!dir, up->child(dir));
+    up->setChild(dir, node);
+    node->setRed(true);
+    up->setRed(false);
+    return up;
+}
+
+template <typename T, typename Alloc>
+typename TopDownRBTree<T, Alloc>::Node* TopDownRBTree<T, Alloc>::rotateTwice(Node* node, int dir) {
+    node->setChild(!dir, rotate(node->child(!dir), !dir));
+    return rotate(node, dir);
+}
+
+
+template <typename T, typename Alloc>
+template <typename V>
+bool TopDownRBTree<T, Alloc>::insertValue(V&& value) {
+    if (!root) {
+        root = pool.create(std::forward<V>(value));
+        root->setRed(false);
+        nodeCount++;
+        return true;
+    }
+
+    // great-grandparent, grandparent, parent and current node
+    Node* top = nullptr;
+    Node* grand = nullptr;
+    Node* parent = nullptr;
+    Node* node = root;
+    int dir = 0;
+    int last = 0;
+    bool inserted = false;
+
+    for (;;) {
+        if (!node) {
+            node = pool.create(std::forward<V>(value));
+            parent->setChild(dir, node);
+            nodeCount++;
+            inserted = true;
+        }
+        else if (isRed(node->child(0)) && isRed(node->child(1))) {
+            node->setRed(true);
+            node->child(0)->setRed(false);
+            node->child(1)->setRed(false);
+        }
+
+        // Two reds in a row: the parent is red, so it is not the root and
+        // grand exists.
+        if (isRed(node) && isRed(parent)) {
+            int side = childOf(top, 1) == grand;
+            if (node == parent->child(last)) {
+                setChildOf(top, side, rotate(grand, !last));
+            }
+            else {
+                setChildOf(top, side, rotateTwice(grand, !last));
+            }
+        }
+
+        if (inserted) {
+            break;
+        }
+        bool less = value < node->data;
+        if (!less && !(node->data < value)) {
+            break;
+        }
+
+        last = dir;
+        dir = !less;
+        if (grand) {
+            top = grand;
+        }
+        grand = parent;
+        parent = node;
+        node = node->child(dir);
+    }
+
+    root->setRed(false);
+    return inserted;
+}
+
+template <typename T, typename Alloc>
+template <typename Key>
+bool TopDownRBTree<T, Alloc>::remove(const Key& value) {
+    if (!root) {
+        return false;
+    }
+
+    Node* grand = nullptr;
+    Node* parent = nullptr;
+    Node* node = nullptr;
+    Node* found = nullptr;
+    int dir = 1;
+
+    // Past found the descent keeps going left once and then right, ending
+    // at found's in-order predecessor, whose element replaces found's.
+    while (childOf(node, dir)) {
+        int last = dir;
+        grand = parent;
+        parent = node;
+        node = childOf(node, dir);
+
+        dir = node->data < value;
+        if (!dir && !(value < node->data)) {
+            found = node;
+        }
+
+        // Make node red before stepping below it.
+        if (isRed(node) || isRed(node->child(dir))) {
+            continue;
+        }
+        if (isRed(node->child(!dir))) {
+            Node* up = rotate(node, dir);
+            setChildOf(parent, last, up);
+            parent = up;
+            continue;
+        }
+
+        Node* sibling = childOf(parent, !last);
+        if (!sibling) {
+            continue;
+        }
+        if (!isRed(sibling->child(!last)) && !isRed(sibling->child(last))) {
+            parent->setRed(false);
+            sibling->setRed(true);
+            node->setRed(true);
+        }
+        else {
+            int side = childOf(grand, 1) == parent;
+            Node* up = isRed(sibling->child(last)) ? rotateTwice(parent, last) : rotate(parent, last);
+            setChildOf(grand, side, up);
+            node->setRed(true);
+            up->setRed(true);
+            up->child(0)->setRed(false);
+            up->child(1)->setRed(false);
+        }
+    }
+
+    if (found) {
+        if (found != node) {
+            found->data = std::move(node->data);
+        }
+        setChildOf(parent, childOf(parent, 1) == node, node->child(node->child(0) == nullptr));
+        pool.destroy(node);
+        nodeCount--;
+    }
+
+    if (root) {
+        root->setRed(false);
+    }
+    return found != nullptr;
+}
+
+template <typename T, typename Alloc>
+void TopDownRBTree<T, Alloc>::clear() {
+    if constexpr (bulkClear) {
+        pool.releaseAll();
+    }
+    else {
+        destroyNodes(pool, root,
+            [](Node* node, int dir) { return node->child(dir); },
+            [](Node* node, int dir, Node* child) { node->setChild(dir, child); });
+    }
+    root = nullptr;
+    nodeCount = 0;
+}
+
+
+template <typename T, typename Alloc>
+template <typename Key>
+bool TopDownRBTree<T, Alloc>::search(const Key& value) const {
+    const Node* node = root;
+    while (node) {
+        if (value < node->data) {
+            node = node->child(0);
+        }
+        else if (node->data < value) {
+            node = node->child(1);
+        }
+        else {
+            return true;
+        }
+    }
+    return false;
+}
+
+template <typename T, typename Alloc>
+int TopDownRBTree<T, Alloc>::getHeight(const Node* node) {
+    return node ? std::max(getHeight(node->child(0)), getHeight(node->child(1))) + 1 : 0;
+}
+
+template <typename T, typename Alloc>
+int TopDownRBTree<T, Alloc>::getBlackHeight() const {
+    int blackHeight = 0;
+    for (const Node* node = root; node; node = node->child(0)) {
+        if (!node->red()) {
+            blackHeight++;
+        }
+    }
+    return blackHeight;
+}
+
+// Returns the black height of the subtree, or -1 if it breaks a rule; prev
+// is the last node visited in order.
+template <typename T, typename Alloc>
+int TopDownRBTree<T, Alloc>::checkNode(const Node* node, const Node*& prev, std::size_t& count) {
+    if (!node) {
+        return 0;
+    }
+    if (node->red() && (isRed(node->child(0)) || isRed(node->child(1)))) {
+        return -1;
+    }
+    int left = checkNode(node->child(0), prev, count);
+    if (left < 0 || (prev && !(prev->data < node->data))) {
+        return -1;
+    }
+    prev = node;
+    count++;
+    int right = checkNode(node->child(1), prev, count);
+    if (right != left) {
+        return -1;
+    }
+    return left + (node->red() ? 0 : 1);
+}
+
+template <typename T, typename Alloc>
+bool TopDownRBTree<T, Alloc>::isValid() const {
+    const Node* prev = nullptr;
+    std::size_t count = 0;
+    return !isRed(root) && checkNode(root, prev, count) >= 0 && count == nodeCount;
+}
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Trace policies for AVLTree and RBTree. Tracing keeps the teaching output
+// (per-operation messages and rotation cases), Silent compiles it out.
+// Counting prints nothing and keeps a TreeStats in the tree instead, read
+// through stats(); lookups then write to the tree, so a counted tree must
+// not be read from several threads at once.
+struct Silent {
+    static constexpr bool enabled = false;
+    static constexpr bool counting = false;
+};
+
+struct Tracing {
+    static constexpr bool enabled = true;
+    static constexpr bool counting = false;
+};
+
+struct Counting {
+    static constexpr bool enabled = false;
+    static constexpr bool counting = true;
+};
+
+// Operation counters of one tree. Fields that do not apply to a tree stay
+// zero: the rotation cases are AVLTree's and WAVLTree's, the fix-up steps
+// RBTree's.
+struct TreeStats {
+    static constexpr std::size_t kPathBuckets = 64;
+
+    // Key comparisons made by lookups, inserts and removes.
+    std::uint64_t comparisons = 0;
+    // pathLength[k]: descents that visited k nodes (the last bucket also
+    // counts longer ones).
+    std::uint64_t pathLength[kPathBuckets] = {};
+
+    // AVL rebalancing cases, named after the side that is too deep.
+    std::uint64_t rotationsLL = 0;
+    std::uint64_t rotationsLR = 0;
+    std::uint64_t rotationsRR = 0;
+    std::uint64_t rotationsRL = 0;
+
+    // Red-black fix-up: steps that only recolor and move up, and rotations.
+    std::uint64_t insertRecolors = 0;
+    std::uint64_t insertRotations = 0;
+    std::uint64_t deleteRecolors = 0;
+    std::uint64_t deleteRotations = 0;
+
+    std::uint64_t nodesAllocated = 0;
+
+    // Filled in by stats() when it is read.
+    int height = 0;
+    int blackHeight = 0;
+
+    void descent(std::size_t nodes, std::size_t compares) {
+        comparisons += compares;
+        pathLength[nodes < kPathBuckets ? nodes : kPathBuckets - 1]++;
+    }
+
+    // One JSON object; pathLength lists buckets up to the last nonzero one.
+    std::string toJson() const;
+};
+
+// Placeholder for the counters of a tree that does not count.
+struct NoStats {};
+
+
+inline std::string TreeStats::toJson() const {
+    std::string json = "{";
+    auto field = [&json](const char* name, std::uint64_t value) {
+        json += '"';
+        json += name;
+        json += "\": ";
+        json += std::to_string(value);
+        json += ", ";
+    };
+
+    field("comparisons", comparisons);
+    field("rotations_ll", rotationsLL);
+    field("rotations_lr", rotationsLR);
+    field("rotations_rr", rotationsRR);
+    field("rotations_rl", rotationsRL);
+    field("insert_recolors", insertRecolors);
+    field("insert_rotations", insertRotations);
+    field("delete_recolors", deleteRecolors);
+    field("delete_rotations", deleteRotations);
+    field("nodes_allocated", nodesAllocated);
+    field("height", static_cast<std::uint64_t>(height));
+    field("black_height", static_cast<std::uint64_t>(blackHeight));
+
+    std::size_t used = kPathBuckets;
+    while (used > 0 && pathLength[used - 1] == 0) {
+        used--;
+    }
+    json += "\"path_length\": [";
+    for (std::size_t i = 0; i < used; i++) {
+        if (i > 0) {
+            json += ", ";
+        }
+        json += std::to_string(pathLength[i]);
+    }
+    json += "]}";
+    return json;
+}
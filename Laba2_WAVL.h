@@ -0,0 +1,611 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <type_traits>
+#include <utility>
+
+#include "Laba2_Trace.h"
+#include "Laba2_Alloc.h"
+#include "Laba2_Bulk.h"
+#include "Laba2_Frozen.h"
+
+// Weak AVL tree (Haeupler, Sen, Tarjan, "Rank-Balanced Trees").
+//
+// Every node has a rank, a missing child counts as rank -1, and the rank
+// difference between a node and each child is 1 or 2, with leaves at
+// rank 0. Without deletions this is exactly an AVL tree, so the height
+// stays below 1.45 log2 n; with them it stays below 2 log2 n. Rebalancing
+// after an insert takes at most two rotations, as in AVLTree, and after a
+// remove also at most two rotations, where AVLTree may rotate at every
+// level; the rest is rank promotions and demotions walking up.
+//
+// The public API matches AVLTree's core set operations. With the Counting
+// trace policy the rotation cases are counted in TreeStats::rotationsLL..RL.
+template <typename T, typename Trace = Silent, typename Alloc = HeapNodes>
+class WAVLTree {
+private:
+    struct Node {
+        using Link = typename Alloc::template Link<Node>;
+
+        T data;
+        std::int8_t rank;
+        Link left;
+        Link right;
+        Link parent;
+
+        template <typename... Args>
+        explicit Node(Args&&... args)
+            : data(std::forward<Args>(args)...), rank(0), left(nullptr), right(nullptr), parent(nullptr) {
+        }
+    };
+
+    using NodePool = typename Alloc::template Pool<Node>;
+    static constexpr bool bulkClear = NodePool::bulkRelease && std::is_trivially_destructible<T>::value;
+
+    using Link = typename Node::Link;
+
+    Link root;
+    std::size_t nodeCount;
+    NodePool pool;
+    mutable std::conditional_t<Trace::counting, TreeStats, NoStats> counters;
+
+public:
+    WAVLTree() : root(nullptr), nodeCount(0) {}
+    ~WAVLTree() { clear(); }
+
+    WAVLTree(const WAVLTree&) = delete;
+    WAVLTree& operator=(const WAVLTree&) = delete;
+
+    // Bytes allocated per element, before allocator overhead.
+    static constexpr std::size_t nodeBytes = sizeof(Node);
+
+    // Bidirectional in-order iterator; elements are keys, so it is always const.
+    class const_iterator {
+    public:
+        using iterator_category = std::bidirectional_iterator_tag;
+        using value_type = T;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const T*;
+        using reference = const T&;
+
+        const_iterator() : node(nullptr), tree(nullptr) {}
+
+        reference operator*() const { return node->data; }
+        pointer operator->() const { return &node->data; }
+
+        const_iterator& operator++() { node = nextNode(node); return *this; }
+        const_iterator operator++(int) { const_iterator old = *this; ++*this; return old; }
+        const_iterator& operator--() { node = node ? prevNode(node) : maxNode(tree->root); return *this; }
+        const_iterator operator--(int) { const_iterator old = *this; --*this; return old; }
+
+        bool operator==(const const_iterator& other) const { return node == other.node; }
+        bool operator!=(const const_iterator& other) const { return node != other.node; }
+
+    private:
+        friend class WAVLTree;
+        const_iterator(const Node* node, const WAVLTree* tree) : node(node), tree(tree) {}
+
+        const Node* node;
+        const WAVLTree* tree;
+    };
+
+    using iterator = const_iterator;
+    using reverse_iterator = std::reverse_iterator<const_iterator>;
+    using const_reverse_iterator = reverse_iterator;
+
+    void insert(const T& value) { try_emplace(value, value); }
+    void insert(T&& value) { try_emplace(value, std::move(value)); }
+    template <typename Key>
+    void remove(const Key& value);
+    template <typename Key>
+    bool search(const Key& value) const { return find(value) != end(); }
+
+    // emplace() builds the element first and drops it if an equivalent one
+    // exists; try_emplace() looks key up first and builds the element from
+    // args only when it is absent.
+    template <typename... Args>
+    std::pair<const_iterator, bool> emplace(Args&&... args);
+    template <typename Key, typename... Args>
+    std::pair<const_iterator, bool> try_emplace(const Key& key, Args&&... args);
+    bool isEmpty() const { return root == nullptr; }
+    std::size_t size() const { return nodeCount; }
+    void clear();
+
+    const_iterator begin() const { return const_iterator(minNode(root), this); }
+    const_iterator end() const { return const_iterator(nullptr, this); }
+    const_reverse_iterator rbegin() const { return const_reverse_iterator(end()); }
+    const_reverse_iterator rend() const { return const_reverse_iterator(begin()); }
+
+    template <typename Key>
+    const_iterator find(const Key& value) const;
+    template <typename Key>
+    const_iterator lower_bound(const Key& value) const;
+    template <typename Key>
+    const_iterator upper_bound(const Key& value) const;
+
+    // Read-only copy of the current contents in a cache-friendly layout.
+    FrozenSet<T> freeze() const { return FrozenSet<T>(sortedUnique, begin(), nodeCount); }
+
+    int getTreeHeight() const;
+    // Checks order, parent links, rank rules (rank differences 1 or 2,
+    // leaves at rank 0) and size(), in O(n); for tests.
+    bool isValid() const;
+
+    // Counters of a tree with the Counting trace policy, plus its height.
+    TreeStats stats() const;
+    void resetStats() { counters = {}; }
+
+private:
+    static int rank(const Node* node) { return node ? node->rank : -1; }
+    static Node* child(const Node* node, int dir) { return dir ? node->right : node->left; }
+
+    template <typename Key>
+    Node* descend(const Key& key, Node*& parent, int& dir) const;
+    Node* attach(Node* node, Node* parent, int dir);
+    void replaceChild(Node* parent, Node* old, Node* node);
+    void rotateUp(Node* node);
+    void rebalanceInsert(Node* node);
+    void rebalanceRemove(Node* parent, int dir);
+    void countRotation(int heavy, bool twice);
+
+    static const Node* minNode(const Node* node);
+    static const Node* maxNode(const Node* node);
+    static const Node* nextNode(const Node* node);
+    static const Node* prevNode(const Node* node);
+    static bool checkNode(const Node* node, const Node* parent, const Node*& prev, std::size_t& count);
+};
+
+
+// Returns the node equal to key, or nullptr with parent and dir set to the
+// place key would be attached (parent nullptr for an empty tree).
+template <typename T, typename Trace, typename Alloc>
+template <typename Key>
+typename WAVLTree<T, Trace, Alloc>::Node* WAVLTree<T, Trace, Alloc>::descend(const Key& key, Node*& parent, int& dir) const {
+    parent = nullptr;
+    dir = 0;
+    Node* node = root;
+    std::size_t nodes = 0;
+    std::size_t compares = 0;
+    while (node) {
+        nodes++;
+        if (key < node->data) {
+            compares += 1;
+            dir = 0;
+        }
+        else if (node->data < key) {
+            compares += 2;
+            dir = 1;
+        }
+        else {
+            compares += 2;
+            break;
+        }
+        parent = node;
+        node = child(node, dir);
+    }
+    if constexpr (Trace::counting) {
+        counters.descent(nodes, compares);
+    }
+    return node;
+}
+
+template <typename T, typename Trace, typename Alloc>
+typename WAVLTree<T, Trace, Alloc>::Node* WAVLTree<T, Trace, Alloc>::attach(Node* node, Node* parent, int dir) {
+    node->parent = parent;
+    if (!parent) {
+        root = node;
+    }
+    else if (dir) {
+        parent->right = node;
+    }
+    else {
+        parent->left = node;
+    }
+    nodeCount++;
+    if constexpr (Trace::counting) {
+        counters.nodesAllocated++;
+    }
+    rebalanceInsert(node);
+    return node;
+}
+
+template <typename T, typename Trace, typename Alloc>
+template <typename... Args>
+std::pair<typename WAVLTree<T, Trace, Alloc>::const_iterator, bool> WAVLTree<T, Trace, Alloc>::emplace(Args&&... args) {
+    Node* node = pool.create(std::forward<Args>(args)...);
+
+    Node* parent;
+    int dir;
+    Node* existing = descend(node->data, parent, dir);
+    if (existing) {
+        pool.destroy(node);
+        return { const_iterator(existing, this), false };
+    }
+    return { const_iterator(attach(node, parent, dir), this), true };
+}
+
+template <typename T, typename Trace, typename Alloc>
+template <typename Key, typename... Args>
+std::pair<typename WAVLTree<T, Trace, Alloc>::const_iterator, bool> WAVLTree<T, Trace, Alloc>::try_emplace(const Key& key, Args&&... args) {
+    Node* parent;
+    int dir;
+    Node* existing = descend(key, parent, dir);
+    if (existing) {
+        return { const_iterator(existing, this), false };
+    }
+    return { const_iterator(attach(pool.create(std::forward<Args>(args)...), parent, dir), this), true };
+}
+
+
+// Puts node where old hangs under parent (the root when parent is nullptr).
+template <typename T, typename Trace, typename Alloc>
+void WAVLTree<T, Trace, Alloc>::replaceChild(Node* parent, Node* old, Node* node) {
+    if (!parent) {
+        root = node;
+    }
+    else if (parent->left == old) {
+        parent->left = node;
+    }
+    else {
+        parent->right = node;
+    }
+    if (node) {
+        node->parent = parent;
+    }
+}
+
+// Rotates node up over its parent; ranks are left to the caller.
+template <typename T, typename Trace, typename Alloc>
+void WAVLTree<T, Trace, Alloc>::rotateUp(Node* node) {
+    Node* parent = node->parent;
+    Node* grand = parent->parent;
+    if (parent->left == node) {
+        parent->left = node->right;
+        if (node->right) {
+            node->right->parent = parent;
+        }
+        node->right = parent;
+    }
+    else {
+        parent->right = node->left;
+        if (node->left) {
+            node->left->parent = parent;
+        }
+        node->left = parent;
+    }
+    parent->parent = node;
+    replaceChild(grand, parent, node);
+}
+
+// heavy is the side that was too deep: 0 counts as LL / LR, 1 as RR / RL.
+template <typename T, typename Trace, typename Alloc>
+void WAVLTree<T, Trace, Alloc>::countRotation(int heavy, bool twice) {
+    if constexpr (Trace::counting) {
+        if (heavy == 0) {
+            (twice ? counters.rotationsLR : counters.rotationsLL)++;
+        }
+        else {
+            (twice ? counters.rotationsRL : counters.rotationsRR)++;
+        }
+    }
+}
+
+
+// node is a new leaf of rank 0. While it is a 0-child (same rank as its
+// parent) whose sibling is a 1-child, promoting the parent moves the
+// problem up; a 0-child with a 2-child sibling is fixed by one or two
+// rotations, which end the walk.
+template <typename T, typename Trace, typename Alloc>
+void WAVLTree<T, Trace, Alloc>::rebalanceInsert(Node* node) {
+    Node* parent = node->parent;
+    while (parent && parent->rank == node->rank) {
+        int dir = parent->right == node;
+        if (parent->rank - rank(child(parent, !dir)) == 1) {
+            parent->rank++;
+            node = parent;
+            parent = node->parent;
+            continue;
+        }
+
+        Node* inner = child(node, !dir);
+        if (!inner || node->rank - inner->rank == 2) {
+            rotateUp(node);
+            parent->rank--;
+            countRotation(dir, false);
+        }
+        else {
+            rotateUp(inner);
+            rotateUp(inner);
+            inner->rank++;
+            node->rank--;
+            parent->rank--;
+            countRotation(dir, true);
+        }
+        break;
+    }
+}
+
+// parent lost a node on side dir. A leaf left with rank 1 is demoted
+// first; then, while that side is a 3-child, demoting parent (and the
+// sibling when it is 2,2) moves the problem up, and otherwise one or two
+// rotations end the walk.
+template <typename T, typename Trace, typename Alloc>
+void WAVLTree<T, Trace, Alloc>::rebalanceRemove(Node* parent, int dir) {
+    if (!parent) {
+        return;
+    }
+    if (!parent->left && !parent->right && parent->rank == 1) {
+        parent->rank = 0;
+        Node* up = parent->parent;
+        if (!up) {
+            return;
+        }
+        dir = up->right == parent;
+        parent = up;
+    }
+
+    while (parent->rank - rank(child(parent, dir)) == 3) {
+        Node* sibling = child(parent, !dir);
+        if (parent->rank - sibling->rank == 2) {
+            parent->rank--;
+        }
+        else if (sibling->rank - rank(sibling->left) == 2 && sibling->rank - rank(sibling->right) == 2) {
+            parent->rank--;
+            sibling->rank--;
+        }
+        else {
+            Node* outer = child(sibling, !dir);
+            if (sibling->rank - rank(outer) == 1) {
+                rotateUp(sibling);
+                sibling->rank++;
+                parent->rank--;
+                if (!parent->left && !parent->right) {
+                    parent->rank--;
+                }
+                countRotation(!dir, false);
+            }
+            else {
+                Node* inner = child(sibling, dir);
+                rotateUp(inner);
+                rotateUp(inner);
+                inner->rank += 2;
+                sibling->rank--;
+                parent->rank -= 2;
+                countRotation(!dir, true);
+            }
+            return;
+        }
+
+        Node* up = parent->parent;
+        if (!up) {
+            return;
+        }
+        dir = up->right == parent;
+        parent = up;
+    }
+}
+
+template <typename T, typename Trace, typename Alloc>
+template <typename Key>
+void WAVLTree<T, Trace, Alloc>::remove(const Key& value) {
+    Node* parent;
+    int dir;
+    Node* node = descend(value, parent, dir);
+    if (!node) {
+        return;
+    }
+
+    if (node->left && node->right) {
+        // The successor's node is unlinked and takes the removed node's
+        // place, so other elements keep their addresses.
+        Node* next = node->right;
+        while (next->left) {
+            next = next->left;
+        }
+        parent = next->parent;
+        dir = parent->right == next;
+        replaceChild(parent, next, next->right);
+        if (parent == node) {
+            parent = next;
+        }
+
+        next->rank = node->rank;
+        next->left = node->left;
+        next->right = node->right;
+        if (next->left) {
+            next->left->parent = next;
+        }
+        if (next->right) {
+            next->right->parent = next;
+        }
+        replaceChild(node->parent, node, next);
+    }
+    else {
+        parent = node->parent;
+        dir = parent && parent->right == node;
+        replaceChild(parent, node, node->left ? node->left : node->right);
+    }
+    pool.destroy(node);
+    nodeCount--;
+    rebalanceRemove(parent, dir);
+}
+
+// Rotates left children up until the node has none, then frees it and
+// moves right, so no stack is needed.
+template <typename T, typename Trace, typename Alloc>
+void WAVLTree<T, Trace, Alloc>::clear() {
+    if constexpr (bulkClear) {
+        pool.releaseAll();
+    }
+    else {
+        Node* node = root;
+        while (node) {
+            Node* left = node->left;
+            if (left) {
+                node->left = left->right;
+                left->right = node;
+                node = left;
+            }
+            else {
+                Node* right = node->right;
+                pool.destroy(node);
+                node = right;
+            }
+        }
+    }
+    root = nullptr;
+    nodeCount = 0;
+}
+
+
+template <typename T, typename Trace, typename Alloc>
+template <typename Key>
+typename WAVLTree<T, Trace, Alloc>::const_iterator WAVLTree<T, Trace, Alloc>::find(const Key& value) const {
+    Node* parent;
+    int dir;
+    return const_iterator(descend(value, parent, dir), this);
+}
+
+template <typename T, typename Trace, typename Alloc>
+template <typename Key>
+typename WAVLTree<T, Trace, Alloc>::const_iterator WAVLTree<T, Trace, Alloc>::lower_bound(const Key& value) const {
+    const Node* node = root;
+    const Node* result = nullptr;
+    while (node) {
+        if (node->data < value) {
+            node = node->right;
+        }
+        else {
+            result = node;
+            node = node->left;
+        }
+    }
+    return const_iterator(result, this);
+}
+
+template <typename T, typename Trace, typename Alloc>
+template <typename Key>
+typename WAVLTree<T, Trace, Alloc>::const_iterator WAVLTree<T, Trace, Alloc>::upper_bound(const Key& value) const {
+    const Node* node = root;
+    const Node* result = nullptr;
+    while (node) {
+        if (value < node->data) {
+            result = node;
+            node = node->left;
+        }
+        else {
+            node = node->right;
+        }
+    }
+    return const_iterator(result, this);
+}
+
+
+template <typename T, typename Trace, typename Alloc>
+const typename WAVLTree<T, Trace, Alloc>::Node* WAVLTree<T, Trace, Alloc>::minNode(const Node* node) {
+    while (node && node->left) {
+        node = node->left;
+    }
+    return node;
+}
+
+template <typename T, typename Trace, typename Alloc>
+const typename WAVLTree<T, Trace, Alloc>::Node* WAVLTree<T, Trace, Alloc>::maxNode(const Node* node) {
+    while (node && node->right) {
+        node = node->right;
+    }
+    return node;
+}
+
+template <typename T, typename Trace, typename Alloc>
+const typename WAVLTree<T, Trace, Alloc>::Node* WAVLTree<T, Trace, Alloc>::nextNode(const Node* node) {
+    if (node->right) {
+        return minNode(node->right);
+    }
+    while (node->parent && node == node->parent->right) {
+        node = node->parent;
+    }
+    return node->parent;
+}
+
+template <typename T, typename Trace, typename Alloc>
+const typename WAVLTree<T, Trace, Alloc>::Node* WAVLTree<T, Trace, Alloc>::prevNode(const Node* node) {
+    if (node->left) {
+        return maxNode(node->left);
+    }
+    while (node->parent && node == node->parent->left) {
+        node = node->parent;
+    }
+    return node->parent;
+}
+
+
+// Ranks bound the height but do not give it, so this walks the tree.
+template <typename T, typename Trace, typename Alloc>
+int WAVLTree<T, Trace, Alloc>::getTreeHeight() const {
+    int height = 0;
+    int depth = 0;
+    const Node* node = root;
+    const Node* from = nullptr;
+    while (node) {
+        if (from == node->parent) {
+            depth++;
+            height = depth > height ? depth : height;
+            if (node->left) {
+                from = node;
+                node = node->left;
+                continue;
+            }
+            from = nullptr;
+        }
+        if (from == node->left && node->right) {
+            from = node;
+            node = node->right;
+            continue;
+        }
+        from = node;
+        node = node->parent;
+        depth--;
+    }
+    return height;
+}
+
+// prev is the last node visited in order.
+template <typename T, typename Trace, typename Alloc>
+bool WAVLTree<T, Trace, Alloc>::checkNode(const Node* node, const Node* parent, const Node*& prev, std::size_t& count) {
+    if (!node) {
+        return true;
+    }
+    if (node->parent != parent || !checkNode(node->left, node, prev, count)) {
+        return false;
+    }
+    if (prev && !(prev->data < node->data)) {
+        return false;
+    }
+    prev = node;
+    count++;
+    if (!checkNode(node->right, node, prev, count)) {
+        return false;
+    }
+    int left = node->rank - rank(node->left);
+    int right = node->rank - rank(node->right);
+    bool leaf = !node->left && !node->right;
+    return (left == 1 || left == 2) && (right == 1 || right == 2) && (!leaf || node->rank == 0);
+}
+
+template <typename T, typename Trace, typename Alloc>
+bool WAVLTree<T, Trace, Alloc>::isValid() const {
+    const Node* prev = nullptr;
+    std::size_t count = 0;
+    return checkNode(root, nullptr, prev, count) && count == nodeCount;
+}
+
+template <typename T, typename Trace, typename Alloc>
+TreeStats WAVLTree<T, Trace, Alloc>::stats() const {
+    static_assert(Trace::counting, "stats() needs the Counting trace policy");
+    TreeStats result = counters;
+    result.height = getTreeHeight();
+    return result;
+}